@@ -0,0 +1,253 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "buffer_arena.h"
+
+/* Size classes are spaced four per power of two, starting at 4 KiB, so that
+ * at most 25% of a buffer is wasted on rounding up. */
+#define CLASS_MIN_SHIFT 12
+#define CLASS_PER_OCTAVE 4
+#define NB_CLASSES      (CLASS_PER_OCTAVE * (31 - CLASS_MIN_SHIFT))
+
+typedef struct ArenaBuffer {
+    BufferArena        *arena;
+    struct ArenaBuffer *next;
+    uint8_t            *data;
+    int                 class_idx;
+} ArenaBuffer;
+
+typedef struct SizeClass {
+    // buffers that were returned to the arena and are not in use
+    ArenaBuffer *idle;
+    size_t       size;
+} SizeClass;
+
+struct BufferArena {
+    pthread_mutex_t  lock;
+
+    SizeClass        classes[NB_CLASSES];
+    // buffers that were handed out and not yet returned
+    unsigned         nb_used;
+    // arena_free() was called, the arena is freed with the last buffer
+    int              closed;
+
+    size_t           max_size;
+    BufferArenaStats stats;
+};
+
+static size_t class_size(int idx)
+{
+    return (size_t)(CLASS_PER_OCTAVE + idx % CLASS_PER_OCTAVE) <<
+           (idx / CLASS_PER_OCTAVE + CLASS_MIN_SHIFT - 2);
+}
+
+static void arena_destroy(BufferArena *arena)
+{
+    pthread_mutex_destroy(&arena->lock);
+    av_free(arena);
+}
+
+// bytes left below the size target, must be called with the lock held
+static size_t arena_room(const BufferArena *arena)
+{
+    return arena->stats.allocated < arena->max_size ?
+           arena->max_size - arena->stats.allocated : 0;
+}
+
+// must be called with the lock held
+static void entry_free(BufferArena *arena, ArenaBuffer *entry)
+{
+    arena->stats.allocated -= arena->classes[entry->class_idx].size;
+    av_free(entry->data);
+    av_free(entry);
+}
+
+/* Free idle buffers of any class, largest first, until size more bytes fit
+ * below the limit. Must be called with the lock held. */
+static void trim_idle(BufferArena *arena, size_t size)
+{
+    for (int i = NB_CLASSES - 1; i >= 0; i--) {
+        SizeClass *sc = &arena->classes[i];
+
+        while (sc->idle && size > arena_room(arena)) {
+            ArenaBuffer *entry = sc->idle;
+
+            sc->idle = entry->next;
+            entry_free(arena, entry);
+            arena->stats.nb_trimmed++;
+        }
+    }
+}
+
+static void buffer_release(void *opaque, uint8_t *data)
+{
+    ArenaBuffer *entry = opaque;
+    BufferArena *arena = entry->arena;
+    int destroy = 0;
+
+    pthread_mutex_lock(&arena->lock);
+    if (arena->closed) {
+        entry_free(arena, entry);
+        destroy = !--arena->nb_used;
+    } else if (arena->stats.allocated > arena->max_size) {
+        // above the target, shrink back instead of keeping the buffer
+        entry_free(arena, entry);
+        arena->nb_used--;
+        arena->stats.nb_trimmed++;
+    } else {
+        SizeClass *sc = &arena->classes[entry->class_idx];
+
+        entry->next = sc->idle;
+        sc->idle    = entry;
+        arena->nb_used--;
+    }
+    pthread_mutex_unlock(&arena->lock);
+
+    if (destroy)
+        arena_destroy(arena);
+}
+
+BufferArena *arena_alloc(size_t max_size)
+{
+    BufferArena *arena;
+
+    arena = av_mallocz(sizeof(*arena));
+    if (!arena)
+        return NULL;
+
+    if (pthread_mutex_init(&arena->lock, NULL)) {
+        av_free(arena);
+        return NULL;
+    }
+
+    for (int i = 0; i < NB_CLASSES; i++)
+        arena->classes[i].size = class_size(i);
+    arena->max_size = max_size;
+
+    return arena;
+}
+
+void arena_free(BufferArena **parena)
+{
+    BufferArena *arena = *parena;
+    int destroy;
+
+    if (!arena)
+        return;
+    *parena = NULL;
+
+    /* buffers still in use are freed when they are returned, the last one
+     * destroys the arena from buffer_release() */
+    pthread_mutex_lock(&arena->lock);
+    arena->closed = 1;
+    for (int i = 0; i < NB_CLASSES; i++) {
+        SizeClass *sc = &arena->classes[i];
+
+        while (sc->idle) {
+            ArenaBuffer *entry = sc->idle;
+
+            sc->idle = entry->next;
+            entry_free(arena, entry);
+        }
+    }
+    destroy = !arena->nb_used;
+    pthread_mutex_unlock(&arena->lock);
+
+    if (destroy)
+        arena_destroy(arena);
+}
+
+AVBufferRef *arena_get(BufferArena *arena, size_t size)
+{
+    SizeClass   *sc    = NULL;
+    ArenaBuffer *entry;
+    AVBufferRef *buf;
+    int idx;
+
+    for (idx = 0; idx < NB_CLASSES; idx++) {
+        if (arena->classes[idx].size >= size) {
+            sc = &arena->classes[idx];
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&arena->lock);
+    arena->stats.nb_requests++;
+
+    // larger than any class, allocate it outside of the arena
+    if (!sc) {
+        arena->stats.nb_allocs++;
+        pthread_mutex_unlock(&arena->lock);
+        return av_buffer_alloc(size);
+    }
+
+    entry = sc->idle;
+    if (entry) {
+        sc->idle = entry->next;
+    } else {
+        // make room by dropping idle buffers of other sizes
+        if (sc->size > arena_room(arena))
+            trim_idle(arena, sc->size);
+        // the limit is only a target, a decoder may need more buffers for its
+        // reference frames than it allows, and cannot wait for them
+        if (sc->size > arena_room(arena))
+            arena->stats.nb_overflows++;
+        arena->stats.allocated += sc->size;
+        arena->stats.peak       = FFMAX(arena->stats.peak, arena->stats.allocated);
+        arena->stats.nb_allocs++;
+    }
+    arena->nb_used++;
+    pthread_mutex_unlock(&arena->lock);
+
+    if (!entry) {
+        entry = av_mallocz(sizeof(*entry));
+        if (entry)
+            entry->data = av_mallocz(sc->size);
+        if (!entry || !entry->data) {
+            av_free(entry);
+            pthread_mutex_lock(&arena->lock);
+            arena->stats.allocated -= sc->size;
+            arena->nb_used--;
+            pthread_mutex_unlock(&arena->lock);
+            return NULL;
+        }
+        entry->arena     = arena;
+        entry->class_idx = idx;
+    }
+
+    buf = av_buffer_create(entry->data, sc->size, buffer_release, entry, 0);
+    if (!buf)
+        buffer_release(entry, entry->data);
+
+    return buf;
+}
+
+void arena_get_stats(BufferArena *arena, BufferArenaStats *stats)
+{
+    pthread_mutex_lock(&arena->lock);
+    *stats = arena->stats;
+    pthread_mutex_unlock(&arena->lock);
+}
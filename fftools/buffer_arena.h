@@ -0,0 +1,80 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef FFTOOLS_BUFFER_ARENA_H
+#define FFTOOLS_BUFFER_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libavutil/buffer.h"
+
+/**
+ * A thread-safe set of buffer pools bucketed by size class, shared by all
+ * users in the process. Buffers returned to the arena are kept for reuse, so
+ * that a steady-state workload does not allocate memory at all.
+ *
+ * The size limit is a target, not a hard cap: when it is reached, idle
+ * buffers of other size classes are freed to make room, and if that is not
+ * enough, the request is still served. Buffers returned while the arena is
+ * above its target are freed instead of being kept, so that it shrinks back
+ * once the load goes down. Requests never block.
+ */
+typedef struct BufferArena BufferArena;
+
+typedef struct BufferArenaStats {
+    // bytes currently allocated by the arena, both in use and pooled
+    size_t   allocated;
+    // highest value of allocated so far
+    size_t   peak;
+
+    // number of buffers requested from the arena
+    uint64_t nb_requests;
+    // number of requests that had to allocate new memory
+    uint64_t nb_allocs;
+    // number of allocations that took the arena above its size target
+    uint64_t nb_overflows;
+    // number of buffers freed to make room for other size classes or to get
+    // back below the size target
+    uint64_t nb_trimmed;
+} BufferArenaStats;
+
+/**
+ * Allocate a buffer arena.
+ *
+ * @param max_size number of bytes the arena should not allocate more than
+ */
+BufferArena *arena_alloc(size_t max_size);
+
+/**
+ * Free the arena. Buffers that are still referenced stay valid, the memory
+ * is released once they are all unreferenced.
+ */
+void arena_free(BufferArena **arena);
+
+/**
+ * Get a buffer of at least size bytes from the arena. Sizes above the largest
+ * size class are allocated directly and do not count towards the limit.
+ *
+ * @return the buffer, or NULL on allocation failure
+ */
+AVBufferRef *arena_get(BufferArena *arena, size_t size);
+
+void arena_get_stats(BufferArena *arena, BufferArenaStats *stats);
+
+#endif // FFTOOLS_BUFFER_ARENA_H
@@ -121,6 +121,7 @@ atomic_uint nb_output_dumped = 0;
 
 static BenchmarkTimeStamps current_time;
 AVIOContext *progress_avio = NULL;
+AVIOContext *sched_stats_avio = NULL;
 
 InputFile   **input_files   = NULL;
 int        nb_input_files   = 0;
@@ -347,6 +348,18 @@ static void ffmpeg_cleanup(int ret)
         dec_free(&decoders[i]);
     av_freep(&decoders);
 
+    if (buffer_arena) {
+        BufferArenaStats stats;
+
+        arena_get_stats(buffer_arena, &stats);
+        av_log(NULL, do_benchmark ? AV_LOG_INFO : AV_LOG_VERBOSE,
+               "buffer arena: peak=%zuKiB requests=%"PRIu64" allocs=%"PRIu64
+               " overflows=%"PRIu64" trimmed=%"PRIu64"\n",
+               stats.peak / 1024, stats.nb_requests, stats.nb_allocs,
+               stats.nb_overflows, stats.nb_trimmed);
+        arena_free(&buffer_arena);
+    }
+
     if (vstats_file) {
         if (fclose(vstats_file))
             av_log(NULL, AV_LOG_ERROR,
@@ -360,6 +373,8 @@ static void ffmpeg_cleanup(int ret)
 
     av_freep(&filter_nbthreads);
 
+    avio_closep(&sched_stats_avio);
+
     av_freep(&input_files);
     av_freep(&output_files);
 
@@ -832,6 +847,22 @@ static int check_keyboard_interaction(int64_t cur_time)
     return 0;
 }
 
+static void print_sched_stats(Scheduler *sch)
+{
+    AVBPrint bp;
+
+    if (!sched_stats_avio)
+        return;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    sch_stats_print(sch, &bp);
+    if (av_bprint_is_complete(&bp)) {
+        avio_write(sched_stats_avio, bp.str, bp.len);
+        avio_flush(sched_stats_avio);
+    }
+    av_bprint_finalize(&bp, NULL);
+}
+
 /*
  * The following code is the main loop of the file converter
  */
@@ -864,9 +895,11 @@ static int transcode(Scheduler *sch)
 
         /* dump report by using the output first video and audio streams */
         print_report(0, timer_start, cur_time, transcode_ts);
+        print_sched_stats(sch);
     }
 
     ret = sch_stop(sch, &transcode_ts);
+    print_sched_stats(sch);
 
     /* write the trailer if needed */
     for (int i = 0; i < nb_output_files; i++) {
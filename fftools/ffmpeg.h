@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <signal.h>
 
+#include "buffer_arena.h"
 #include "cmdutils.h"
 #include "ffmpeg_sched.h"
 #include "sync_queue.h"
@@ -646,10 +647,13 @@ extern int print_stats;
 extern int64_t stats_period;
 extern int stdin_interaction;
 extern AVIOContext *progress_avio;
+extern AVIOContext *sched_stats_avio;
 extern float max_error_rate;
 
 extern char *filter_nbthreads;
+extern BufferArena *buffer_arena;
 extern int filter_complex_nbthreads;
+extern int filter_frame_threads;
 extern int vstats_version;
 extern int auto_conversion_filters;
 
@@ -20,6 +20,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/dict.h"
 #include "libavutil/error.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/log.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
@@ -959,6 +960,59 @@ finish:
     return ret;
 }
 
+// allocate video frames from the shared buffer arena,
+// following the layout rules of avcodec_default_get_buffer2()
+static int get_buffer_arena(AVCodecContext *s, AVFrame *frame, int flags)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    int linesize[4];
+    ptrdiff_t linesize1[4];
+    size_t size[4];
+    int w = frame->width;
+    int h = frame->height;
+    int unaligned, ret;
+
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL)))
+        return avcodec_default_get_buffer2(s, frame, flags);
+
+    avcodec_align_dimensions2(s, &w, &h, linesize_align);
+
+    do {
+        ret = av_image_fill_linesizes(linesize, frame->format, w);
+        if (ret < 0)
+            return ret;
+        w += w & ~(w - 1);
+
+        unaligned = 0;
+        for (int i = 0; i < 4; i++)
+            unaligned |= linesize[i] % linesize_align[i];
+    } while (unaligned);
+
+    for (int i = 0; i < 4; i++)
+        linesize1[i] = linesize[i];
+    ret = av_image_fill_plane_sizes(size, frame->format, h, linesize1);
+    if (ret < 0)
+        return ret;
+
+    memset(frame->data, 0, sizeof(frame->data));
+    frame->extended_data = frame->data;
+
+    for (int i = 0; i < 4 && size[i]; i++) {
+        // same padding as the libavcodec internal pools
+        frame->buf[i] = arena_get(buffer_arena, size[i] + 16 + 64 - 1);
+        if (!frame->buf[i]) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+
+        frame->data[i]     = frame->buf[i]->data;
+        frame->linesize[i] = linesize[i];
+    }
+
+    return 0;
+}
+
 static enum AVPixelFormat get_format(AVCodecContext *s, const enum AVPixelFormat *pix_fmts)
 {
     DecoderPriv  *dp = s->opaque;
@@ -1188,6 +1242,10 @@ static int dec_open(DecoderPriv *dp, AVDictionary **dec_opts,
     dp->dec_ctx->get_format            = get_format;
     dp->dec_ctx->pkt_timebase          = o->time_base;
 
+    if (buffer_arena && codec->type == AVMEDIA_TYPE_VIDEO &&
+        (codec->capabilities & AV_CODEC_CAP_DR1))
+        dp->dec_ctx->get_buffer2 = get_buffer_arena;
+
     if (!av_dict_get(*dec_opts, "threads", NULL, 0))
         av_dict_set(dec_opts, "threads", "auto", 0);
 
@@ -18,6 +18,7 @@
 
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "ffmpeg.h"
 #include "ffmpeg_utils.h"
@@ -165,6 +166,22 @@ static int set_encoder_id(OutputFile *of, OutputStream *ost)
     return 0;
 }
 
+// allocate encoded packets from the shared buffer arena,
+// like avcodec_default_get_encode_buffer()
+static int get_encode_buffer_arena(AVCodecContext *s, AVPacket *pkt, int flags)
+{
+    if (pkt->size < 0 || pkt->size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR(EINVAL);
+
+    pkt->buf = arena_get(buffer_arena, pkt->size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!pkt->buf)
+        return AVERROR(ENOMEM);
+    pkt->data = pkt->buf->data;
+    memset(pkt->data + pkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    return 0;
+}
+
 int enc_open(void *opaque, const AVFrame *frame)
 {
     OutputStream *ost = opaque;
@@ -325,6 +342,9 @@ int enc_open(void *opaque, const AVFrame *frame)
 
     av_dict_set(&ost->encoder_opts, "flags", "+frame_duration", AV_DICT_MULTIKEY);
 
+    if (buffer_arena && (enc->capabilities & AV_CODEC_CAP_DR1))
+        enc_ctx->get_encode_buffer = get_encode_buffer_arena;
+
     ret = hw_device_setup_for_encode(ost, frame ? frame->hw_frames_ctx : NULL);
     if (ret < 0) {
         av_log(ost, AV_LOG_ERROR,
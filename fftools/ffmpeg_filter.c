@@ -1653,8 +1653,24 @@ static int configure_input_filter(FilterGraph *fg, AVFilterGraph *graph,
     }
 }
 
+/* report the input frames the graph copied before it is freed, so that the
+ * scheduler can attribute them to the edges that delivered them */
+static void report_input_copies(FilterGraph *fg)
+{
+    FilterGraphPriv *fgp = fgp_from_fg(fg);
+
+    for (int i = 0; i < fg->nb_inputs; i++) {
+        InputFilterPriv *ifp = ifp_from_ifilter(fg->inputs[i]);
+
+        if (ifp->filter)
+            sch_filter_in_add_copies(fgp->sch, fgp->sch_idx, ifp->index,
+                                     av_buffersrc_get_nb_copies(ifp->filter));
+    }
+}
+
 static void cleanup_filtergraph(FilterGraph *fg, FilterGraphThread *fgt)
 {
+    report_input_copies(fg);
     for (int i = 0; i < fg->nb_outputs; i++)
         ofp_from_ofilter(fg->outputs[i])->filter = NULL;
     for (int i = 0; i < fg->nb_inputs; i++)
@@ -1736,6 +1752,9 @@ static int configure_filtergraph(FilterGraph *fg, FilterGraphThread *fgt)
         fgt->graph->nb_threads = filter_complex_nbthreads;
     }
 
+    if (filter_frame_threads)
+        fgt->graph->thread_type |= AVFILTER_THREAD_FRAME;
+
     hw_device = hw_device_for_filter();
 
     if ((ret = graph_parse(fgt->graph, graph_desc, &inputs, &outputs, hw_device)) < 0)
@@ -2870,6 +2889,7 @@ finish:
     if (ret == AVERROR_EOF)
         ret = 0;
 
+    report_input_copies(fg);
     fg_thread_uninit(&fgt);
 
     return ret;
@@ -46,6 +46,7 @@
 #include "libavutil/bprint.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/display.h"
+#include "libavutil/executor.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/fifo.h"
 #include "libavutil/mathematics.h"
@@ -81,7 +82,9 @@ int print_stats       = -1;
 int stdin_interaction = 1;
 float max_error_rate  = 2.0/3;
 char *filter_nbthreads;
+BufferArena *buffer_arena;
 int filter_complex_nbthreads = 0;
+int filter_frame_threads = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
 int64_t stats_period = 500000;
@@ -323,6 +326,45 @@ static int opt_filter_threads(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_shared_threads(void *optctx, const char *opt, const char *arg)
+{
+    double nb_threads;
+    int ret;
+
+    ret = parse_number(opt, arg, OPT_TYPE_INT, 0, INT_MAX, &nb_threads);
+    if (ret < 0)
+        return ret;
+
+    ret = av_executor_set_shared_thread_count(nb_threads);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Error setting up %s shared threads: %s\n",
+               arg, av_err2str(ret));
+        return ret;
+    }
+
+    return 0;
+}
+
+static int opt_buffer_arena_size(void *optctx, const char *opt, const char *arg)
+{
+    double max_size;
+    int ret;
+
+    ret = parse_number(opt, arg, OPT_TYPE_INT64, 0, SIZE_MAX, &max_size);
+    if (ret < 0)
+        return ret;
+
+    arena_free(&buffer_arena);
+    if (!max_size)
+        return 0;
+
+    buffer_arena = arena_alloc(max_size);
+    if (!buffer_arena)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
 static int opt_abort_on(void *optctx, const char *opt, const char *arg)
 {
     static const AVOption opts[] = {
@@ -490,6 +532,20 @@ static int opt_attach(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_sched_mem_budget(void *optctx, const char *opt, const char *arg)
+{
+    Scheduler *sch = optctx;
+    double bytes;
+    int ret;
+
+    ret = parse_number(opt, arg, OPT_TYPE_INT64, 0, SIZE_MAX, &bytes);
+    if (ret < 0)
+        return ret;
+
+    sch_set_mem_budget(sch, bytes);
+    return 0;
+}
+
 static int opt_sdp_file(void *optctx, const char *opt, const char *arg)
 {
     Scheduler *sch = optctx;
@@ -1317,6 +1373,22 @@ static int opt_progress(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_sched_stats(void *optctx, const char *opt, const char *arg)
+{
+    int ret;
+
+    if (!strcmp(arg, "-"))
+        arg = "pipe:";
+    avio_closep(&sched_stats_avio);
+    ret = avio_open2(&sched_stats_avio, arg, AVIO_FLAG_WRITE, &int_cb, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to open scheduler stats URL \"%s\": %s\n",
+               arg, av_err2str(ret));
+        return ret;
+    }
+    return 0;
+}
+
 int opt_timelimit(void *optctx, const char *opt, const char *arg)
 {
 #if HAVE_SETRLIMIT
@@ -1464,6 +1536,12 @@ const OptionDef options[] = {
     { "progress",               OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
         { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
+    { "sched_mem_budget",       OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
+        { .func_arg = opt_sched_mem_budget },
+      "throttle inputs when queued packets and frames exceed this many bytes", "size" },
+    { "sched_stats",            OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
+        { .func_arg = opt_sched_stats },
+      "write per-node timing and queue statistics as JSON lines", "url" },
     { "stdin",                  OPT_TYPE_BOOL, OPT_EXPERT,
         { &stdin_interaction },
       "enable or disable interaction on standard input" },
@@ -1571,6 +1649,15 @@ const OptionDef options[] = {
     { "filter_complex_threads", OPT_TYPE_INT, OPT_EXPERT,
         { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "filter_frame_threads",   OPT_TYPE_BOOL, OPT_EXPERT,
+        { &filter_frame_threads },
+        "process different frames concurrently in filtergraphs" },
+    { "buffer_arena_size",      OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
+        { .func_arg = opt_buffer_arena_size },
+        "allocate decoded video frames and encoded packets from a shared arena targeting this many bytes", "size" },
+    { "shared_threads",         OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
+        { .func_arg = opt_shared_threads },
+        "number of worker threads shared by all codec and filter slice threading", "nb_threads" },
     { "lavfi",               OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
         { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
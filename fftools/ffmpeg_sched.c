@@ -32,6 +32,7 @@
 #include "libavcodec/packet.h"
 
 #include "libavutil/avassert.h"
+#include "libavutil/bprint.h"
 #include "libavutil/error.h"
 #include "libavutil/fifo.h"
 #include "libavutil/frame.h"
@@ -58,8 +59,20 @@ typedef struct SchWaiter {
     // be accessed outside of it
     int                 choked_prev;
     int                 choked_next;
+    // bytes queued downstream of this source
+    size_t              backlog;
 } SchWaiter;
 
+typedef struct SchTaskStats {
+    // start and end of the task thread, 0 if not started/finished yet
+    atomic_int_least64_t time_start;
+    atomic_int_least64_t time_end;
+
+    // time spent blocked waiting for input and on sending output
+    atomic_int_least64_t wait_in;
+    atomic_int_least64_t wait_out;
+} SchTaskStats;
+
 typedef struct SchTask {
     Scheduler          *parent;
     SchedulerNode       node;
@@ -69,8 +82,16 @@ typedef struct SchTask {
 
     pthread_t           thread;
     int                 thread_running;
+
+    // all times in microseconds, as returned by av_gettime_relative()
+    SchTaskStats        stats;
 } SchTask;
 
+typedef struct SchEdgeStats {
+    // number of frames sent over this edge
+    uint64_t            nb_frames;
+} SchEdgeStats;
+
 typedef struct SchDec {
     const AVClass      *class;
 
@@ -79,6 +100,10 @@ typedef struct SchDec {
     uint8_t            *dst_finished;
     unsigned         nb_dst;
 
+    // per-destination statistics, only accessed from the decoder thread
+    // while it runs
+    SchEdgeStats       *dst_stats;
+
     SchTask             task;
     // Queue for receiving input packets, one stream.
     ThreadQueue        *queue;
@@ -232,6 +257,11 @@ typedef struct SchFilterIn {
     SchedulerNode       src_sched;
     int                 send_finished;
     int                 receive_finished;
+
+    /* number of frames received on this input whose data the filtergraph had
+     * to copy in order to write to it, only accessed from the filtergraph
+     * thread while it runs */
+    uint64_t            nb_frames_copied;
 } SchFilterIn;
 
 typedef struct SchFilterOut {
@@ -305,6 +335,17 @@ struct Scheduler {
     pthread_mutex_t     schedule_lock;
 
     atomic_int_least64_t last_dts;
+
+    // time at which sch_start() was called
+    int64_t             start_time;
+
+    // maximum amount of queued data in bytes, 0 for no limit
+    size_t              mem_budget;
+    // a source is currently choked because the memory budget is exceeded
+    atomic_int          mem_choked;
+    // bytes that remain to be consumed before the total drops below the
+    // budget and the choked source is reconsidered
+    atomic_int_least64_t mem_excess;
 };
 
 /**
@@ -365,6 +406,25 @@ static void waiter_uninit(SchWaiter *w)
     pthread_cond_destroy(&w->cond);
 }
 
+static size_t pkt_size(const void *obj)
+{
+    const AVPacket *pkt = obj;
+    return pkt->buf ? pkt->buf->size : pkt->size;
+}
+
+static size_t frame_size(const void *obj)
+{
+    const AVFrame *frame = obj;
+    size_t size = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        size += frame->buf[i]->size;
+    for (int i = 0; i < frame->nb_extended_buf; i++)
+        size += frame->extended_buf[i]->size;
+
+    return size;
+}
+
 static int queue_alloc(ThreadQueue **ptq, unsigned nb_streams, unsigned queue_size,
                        enum QueueType type)
 {
@@ -393,7 +453,8 @@ static int queue_alloc(ThreadQueue **ptq, unsigned nb_streams, unsigned queue_si
         return AVERROR(ENOMEM);
 
     tq = tq_alloc(nb_streams, queue_size, op,
-                  (type == QUEUE_PACKETS) ? pkt_move : frame_move);
+                  (type == QUEUE_PACKETS) ? pkt_move  : frame_move,
+                  (type == QUEUE_PACKETS) ? pkt_size  : frame_size);
     if (!tq) {
         objpool_free(&op);
         return AVERROR(ENOMEM);
@@ -405,6 +466,12 @@ static int queue_alloc(ThreadQueue **ptq, unsigned nb_streams, unsigned queue_si
 
 static void *task_wrapper(void *arg);
 
+static void task_stats_add(atomic_int_least64_t *dst, int64_t start)
+{
+    atomic_fetch_add_explicit(dst, av_gettime_relative() - start,
+                              memory_order_relaxed);
+}
+
 static int task_start(SchTask *task)
 {
     int ret;
@@ -515,6 +582,7 @@ void sch_free(Scheduler **psch)
 
         av_freep(&dec->dst);
         av_freep(&dec->dst_finished);
+        av_freep(&dec->dst_stats);
 
         av_frame_free(&dec->send_frame);
     }
@@ -604,6 +672,11 @@ fail:
     return NULL;
 }
 
+void sch_set_mem_budget(Scheduler *sch, size_t bytes)
+{
+    sch->mem_budget = bytes;
+}
+
 int sch_sdp_filename(Scheduler *sch, const char *sdp_filename)
 {
     av_freep(&sch->sdp_filename);
@@ -1213,8 +1286,129 @@ static void unchoke_for_stream(Scheduler *sch, SchedulerNode src)
     }
 }
 
+// resolve the scheduled source that data for the given stream comes from
+static SchWaiter *waiter_for_stream(Scheduler *sch, SchedulerNode src)
+{
+    if (src.type == SCH_NODE_TYPE_DEC)
+        src = sch->dec[src.idx].src;
+
+    while (1) {
+        SchFilterGraph *fg;
+
+        if (src.type == SCH_NODE_TYPE_DEMUX)
+            return &sch->demux[src.idx].waiter;
+        // loopback decoders are fed by encoders
+        if (src.type != SCH_NODE_TYPE_FILTER_OUT)
+            return NULL;
+
+        fg = &sch->filters[src.idx];
+        if (fg->best_input == fg->nb_inputs)
+            return &fg->waiter;
+
+        src = fg->inputs[fg->best_input].src_sched;
+    }
+}
+
+static void backlog_add(Scheduler *sch, SchedulerNode src, size_t bytes)
+{
+    SchWaiter *w = waiter_for_stream(sch, src);
+    if (w)
+        w->backlog += bytes;
+}
+
+/**
+ * Attribute the data queued in all queues to the sources feeding them and,
+ * if the total exceeds the memory budget, choke the source with the largest
+ * backlog. The queued sizes are read without taking the queue locks, so that
+ * no thread queue lock is ever taken with schedule_lock held.
+ *
+ * @return the choked source or NULL
+ */
+static SchWaiter *mem_budget_choke_locked(Scheduler *sch)
+{
+    SchWaiter *largest = NULL;
+    size_t total = 0;
+
+    for (unsigned type = 0; type < 2; type++)
+        for (unsigned i = 0; i < (type ? sch->nb_filters : sch->nb_demux); i++) {
+            SchWaiter *w = type ? &sch->filters[i].waiter : &sch->demux[i].waiter;
+            w->backlog = 0;
+        }
+
+    for (unsigned i = 0; i < sch->nb_dec; i++) {
+        SchDec *dec = &sch->dec[i];
+        SchedulerNode src = dec->src.type == SCH_NODE_TYPE_ENC ?
+                            sch->enc[dec->src.idx].src : dec->src;
+        size_t queued = 0;
+
+        backlog_add(sch, src, tq_stream_bytes(dec->queue, 0));
+
+        /* every destination of a decoder is sent a reference to the same
+         * frames, and each of their queues holds the most recent ones, so
+         * the longest queue holds all the data queued for any of them */
+        for (unsigned j = 0; j < dec->nb_dst; j++) {
+            SchedulerNode dst = dec->dst[j];
+            ThreadQueue *tq = dst.type == SCH_NODE_TYPE_FILTER_IN ?
+                              sch->filters[dst.idx].queue : sch->enc[dst.idx].queue;
+
+            queued = FFMAX(queued, tq_stream_bytes(tq, dst.type == SCH_NODE_TYPE_FILTER_IN ?
+                                                       dst.idx_stream : 0));
+        }
+        backlog_add(sch, src, queued);
+    }
+
+    for (unsigned i = 0; i < sch->nb_filters; i++) {
+        SchFilterGraph *fg = &sch->filters[i];
+        for (unsigned j = 0; j < fg->nb_inputs; j++) {
+            // accounted for with the decoder above
+            if (fg->inputs[j].src.type == SCH_NODE_TYPE_DEC)
+                continue;
+            backlog_add(sch, fg->inputs[j].src_sched, tq_stream_bytes(fg->queue, j));
+        }
+    }
+
+    for (unsigned i = 0; i < sch->nb_enc; i++) {
+        SchEnc *enc = &sch->enc[i];
+        if (enc->src.type == SCH_NODE_TYPE_DEC)
+            continue;
+        backlog_add(sch, enc->src, tq_stream_bytes(enc->queue, 0));
+    }
+
+    for (unsigned i = 0; i < sch->nb_mux; i++) {
+        SchMux *mux = &sch->mux[i];
+
+        // the muxer queue is only created when the muxer is started
+        if (!mux->queue)
+            continue;
+
+        for (unsigned j = 0; j < mux->nb_streams; j++)
+            backlog_add(sch, mux->streams[j].src_sched, tq_stream_bytes(mux->queue, j));
+    }
+
+    for (unsigned type = 0; type < 2; type++)
+        for (unsigned i = 0; i < (type ? sch->nb_filters : sch->nb_demux); i++) {
+            SchWaiter *w = type ? &sch->filters[i].waiter : &sch->demux[i].waiter;
+
+            total += w->backlog;
+            if (!largest || w->backlog > largest->backlog)
+                largest = w;
+        }
+
+    if (total <= sch->mem_budget || !largest) {
+        atomic_store(&sch->mem_choked, 0);
+        return NULL;
+    }
+
+    largest->choked_next = 1;
+    atomic_store(&sch->mem_excess, total - sch->mem_budget);
+    atomic_store(&sch->mem_choked, 1);
+
+    return largest;
+}
+
 static void schedule_update_locked(Scheduler *sch)
 {
+    SchWaiter *mem_choked = NULL;
     int64_t dts;
     int have_unchoked = 0;
 
@@ -1257,12 +1451,27 @@ static void schedule_update_locked(Scheduler *sch)
         }
     }
 
-    // make sure to unchoke at least one source, if still available
+    if (sch->mem_budget) {
+        mem_choked = mem_budget_choke_locked(sch);
+
+        if (mem_choked) {
+            have_unchoked = 0;
+            for (unsigned type = 0; type < 2; type++)
+                for (unsigned i = 0; i < (type ? sch->nb_filters : sch->nb_demux); i++) {
+                    SchWaiter *w = type ? &sch->filters[i].waiter : &sch->demux[i].waiter;
+                    have_unchoked |= !w->choked_next;
+                }
+        }
+    }
+
+    // make sure to unchoke at least one source, if still available;
+    // the one throttled for exceeding the memory budget stays choked, its
+    // queued data is always consumed and it is woken once that is done
     for (unsigned type = 0; !have_unchoked && type < 2; type++)
         for (unsigned i = 0; i < (type ? sch->nb_filters : sch->nb_demux); i++) {
             int exited = type ? sch->filters[i].task_exited : sch->demux[i].task_exited;
             SchWaiter *w = type ? &sch->filters[i].waiter : &sch->demux[i].waiter;
-            if (!exited) {
+            if (!exited && w != mem_choked) {
                 w->choked_next = 0;
                 have_unchoked  = 1;
                 break;
@@ -1417,6 +1626,10 @@ static int start_prepare(Scheduler *sch)
         dec->dst_finished = av_calloc(dec->nb_dst, sizeof(*dec->dst_finished));
         if (!dec->dst_finished)
             return AVERROR(ENOMEM);
+
+        dec->dst_stats = av_calloc(dec->nb_dst, sizeof(*dec->dst_stats));
+        if (!dec->dst_stats)
+            return AVERROR(ENOMEM);
     }
 
     for (unsigned i = 0; i < sch->nb_enc; i++) {
@@ -1522,7 +1735,8 @@ int sch_start(Scheduler *sch)
         return ret;
 
     av_assert0(sch->state == SCH_STATE_UNINIT);
-    sch->state = SCH_STATE_STARTED;
+    sch->state      = SCH_STATE_STARTED;
+    sch->start_time = av_gettime_relative();
 
     for (unsigned i = 0; i < sch->nb_mux; i++) {
         SchMux *mux = &sch->mux[i];
@@ -1953,14 +2167,34 @@ static int demux_flush(Scheduler *sch, SchDemux *d, AVPacket *pkt)
     return 0;
 }
 
-int sch_demux_send(Scheduler *sch, unsigned demux_idx, AVPacket *pkt,
-                   unsigned flags)
+/* While a source is choked for exceeding the memory budget, it must be
+ * unchoked as soon as enough queued data is consumed, which would not
+ * necessarily cause a scheduling update otherwise. Called by consumers with
+ * the size of the items they just removed from their queue, including
+ * discarded ones; the scheduling is only updated by the one that brings the
+ * total below the budget. Frames shared between the destinations of a
+ * decoder are reported by each of them, so the update may come early; it
+ * then recomputes the excess and keeps the source choked. */
+static void mem_budget_update(Scheduler *sch, size_t consumed)
 {
-    SchDemux *d;
-    int terminate;
+    int64_t excess;
 
-    av_assert0(demux_idx < sch->nb_demux);
-    d = &sch->demux[demux_idx];
+    if (!consumed || !atomic_load_explicit(&sch->mem_choked, memory_order_relaxed))
+        return;
+
+    excess = atomic_fetch_sub(&sch->mem_excess, consumed);
+    if (excess <= 0 || (uint64_t)excess > consumed)
+        return;
+
+    pthread_mutex_lock(&sch->schedule_lock);
+    schedule_update_locked(sch);
+    pthread_mutex_unlock(&sch->schedule_lock);
+}
+
+static int demux_send(Scheduler *sch, SchDemux *d, AVPacket *pkt,
+                      unsigned flags)
+{
+    int terminate;
 
     terminate = waiter_wait(sch, &d->waiter);
     if (terminate)
@@ -1975,6 +2209,23 @@ int sch_demux_send(Scheduler *sch, unsigned demux_idx, AVPacket *pkt,
     return demux_send_for_stream(sch, d, &d->streams[pkt->stream_index], pkt, flags);
 }
 
+int sch_demux_send(Scheduler *sch, unsigned demux_idx, AVPacket *pkt,
+                   unsigned flags)
+{
+    SchDemux *d;
+    int64_t t;
+    int ret;
+
+    av_assert0(demux_idx < sch->nb_demux);
+    d = &sch->demux[demux_idx];
+
+    t   = av_gettime_relative();
+    ret = demux_send(sch, d, pkt, flags);
+    task_stats_add(&d->task.stats.wait_out, t);
+
+    return ret;
+}
+
 static int demux_done(Scheduler *sch, unsigned demux_idx)
 {
     SchDemux *d = &sch->demux[demux_idx];
@@ -2000,12 +2251,18 @@ static int demux_done(Scheduler *sch, unsigned demux_idx)
 int sch_mux_receive(Scheduler *sch, unsigned mux_idx, AVPacket *pkt)
 {
     SchMux *mux;
+    int64_t t;
     int ret, stream_idx;
 
     av_assert0(mux_idx < sch->nb_mux);
     mux = &sch->mux[mux_idx];
 
+    t   = av_gettime_relative();
     ret = tq_receive(mux->queue, &stream_idx, pkt);
+    task_stats_add(&mux->task.stats.wait_in, t);
+
+    mem_budget_update(sch, tq_received_bytes(mux->queue));
+
     pkt->stream_index = stream_idx;
     return ret;
 }
@@ -2084,6 +2341,7 @@ static int mux_done(Scheduler *sch, unsigned mux_idx)
 int sch_dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
 {
     SchDec *dec;
+    int64_t t;
     int ret, dummy;
 
     av_assert0(dec_idx < sch->nb_dec);
@@ -2099,9 +2357,13 @@ int sch_dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
         dec->expect_end_ts = 0;
     }
 
+    t   = av_gettime_relative();
     ret = tq_receive(dec->queue, &dummy, pkt);
+    task_stats_add(&dec->task.stats.wait_in, t);
     av_assert0(dummy <= 0);
 
+    mem_budget_update(sch, tq_received_bytes(dec->queue));
+
     // got a flush packet, on the next call to this function the decoder
     // will give us post-flush end timestamp
     if (ret >= 0 && !pkt->data && !pkt->side_data_elems && dec->queue_end_ts)
@@ -2157,14 +2419,11 @@ finish:
     return AVERROR_EOF;
 }
 
-int sch_dec_send(Scheduler *sch, unsigned dec_idx, AVFrame *frame)
+static int dec_send(Scheduler *sch, SchDec *dec, AVFrame *frame)
 {
-    SchDec *dec;
     int ret = 0;
     unsigned nb_done = 0;
-
-    av_assert0(dec_idx < sch->nb_dec);
-    dec = &sch->dec[dec_idx];
+    int has_data = !!frame->buf[0];
 
     for (unsigned i = 0; i < dec->nb_dst; i++) {
         uint8_t *finished = &dec->dst_finished[i];
@@ -2182,6 +2441,8 @@ int sch_dec_send(Scheduler *sch, unsigned dec_idx, AVFrame *frame)
                 return ret;
         }
 
+        // all destinations share the same data buffers, any copy is deferred
+        // to consumers that actually need to write into the frame
         ret = dec_send_to_dst(sch, dec->dst[i], finished, to_send);
         if (ret < 0) {
             av_frame_unref(to_send);
@@ -2192,11 +2453,30 @@ int sch_dec_send(Scheduler *sch, unsigned dec_idx, AVFrame *frame)
             }
             return ret;
         }
+
+        if (has_data)
+            dec->dst_stats[i].nb_frames++;
     }
 
     return (nb_done == dec->nb_dst) ? AVERROR_EOF : 0;
 }
 
+int sch_dec_send(Scheduler *sch, unsigned dec_idx, AVFrame *frame)
+{
+    SchDec *dec;
+    int64_t t;
+    int ret;
+
+    av_assert0(dec_idx < sch->nb_dec);
+    dec = &sch->dec[dec_idx];
+
+    t   = av_gettime_relative();
+    ret = dec_send(sch, dec, frame);
+    task_stats_add(&dec->task.stats.wait_out, t);
+
+    return ret;
+}
+
 static int dec_done(Scheduler *sch, unsigned dec_idx)
 {
     SchDec *dec = &sch->dec[dec_idx];
@@ -2221,12 +2501,17 @@ static int dec_done(Scheduler *sch, unsigned dec_idx)
 int sch_enc_receive(Scheduler *sch, unsigned enc_idx, AVFrame *frame)
 {
     SchEnc *enc;
+    int64_t t;
     int ret, dummy;
 
     av_assert0(enc_idx < sch->nb_enc);
     enc = &sch->enc[enc_idx];
 
+    t   = av_gettime_relative();
     ret = tq_receive(enc->queue, &dummy, frame);
+    task_stats_add(&enc->task.stats.wait_in, t);
+
+    mem_budget_update(sch, tq_received_bytes(enc->queue));
     av_assert0(dummy <= 0);
 
     return ret;
@@ -2262,14 +2547,10 @@ finish:
     return AVERROR_EOF;
 }
 
-int sch_enc_send(Scheduler *sch, unsigned enc_idx, AVPacket *pkt)
+static int enc_send(Scheduler *sch, SchEnc *enc, AVPacket *pkt)
 {
-    SchEnc *enc;
     int ret;
 
-    av_assert0(enc_idx < sch->nb_enc);
-    enc = &sch->enc[enc_idx];
-
     for (unsigned i = 0; i < enc->nb_dst; i++) {
         uint8_t *finished = &enc->dst_finished[i];
         AVPacket *to_send = pkt;
@@ -2297,6 +2578,22 @@ int sch_enc_send(Scheduler *sch, unsigned enc_idx, AVPacket *pkt)
     return ret;
 }
 
+int sch_enc_send(Scheduler *sch, unsigned enc_idx, AVPacket *pkt)
+{
+    SchEnc *enc;
+    int64_t t;
+    int ret;
+
+    av_assert0(enc_idx < sch->nb_enc);
+    enc = &sch->enc[enc_idx];
+
+    t   = av_gettime_relative();
+    ret = enc_send(sch, enc, pkt);
+    task_stats_add(&enc->task.stats.wait_out, t);
+
+    return ret;
+}
+
 static int enc_done(Scheduler *sch, unsigned enc_idx)
 {
     SchEnc *enc = &sch->enc[enc_idx];
@@ -2337,14 +2634,20 @@ int sch_filter_receive(Scheduler *sch, unsigned fg_idx,
     }
 
     if (*in_idx == fg->nb_inputs) {
+        int64_t t = av_gettime_relative();
         int terminate = waiter_wait(sch, &fg->waiter);
+        task_stats_add(&fg->task.stats.wait_out, t);
         return terminate ? AVERROR_EOF : AVERROR(EAGAIN);
     }
 
     while (1) {
+        int64_t t = av_gettime_relative();
         int ret, idx;
 
         ret = tq_receive(fg->queue, &idx, frame);
+        task_stats_add(&fg->task.stats.wait_in, t);
+
+        mem_budget_update(sch, tq_received_bytes(fg->queue));
         if (idx < 0)
             return AVERROR_EOF;
         else if (ret >= 0) {
@@ -2378,15 +2681,34 @@ void sch_filter_receive_finish(Scheduler *sch, unsigned fg_idx, unsigned in_idx)
     }
 }
 
+void sch_filter_in_add_copies(Scheduler *sch, unsigned fg_idx, unsigned in_idx,
+                              uint64_t nb_copies)
+{
+    SchFilterGraph *fg;
+
+    av_assert0(fg_idx < sch->nb_filters);
+    fg = &sch->filters[fg_idx];
+
+    av_assert0(in_idx < fg->nb_inputs);
+    fg->inputs[in_idx].nb_frames_copied += nb_copies;
+}
+
 int sch_filter_send(Scheduler *sch, unsigned fg_idx, unsigned out_idx, AVFrame *frame)
 {
     SchFilterGraph *fg;
+    int64_t t;
+    int ret;
 
     av_assert0(fg_idx < sch->nb_filters);
     fg = &sch->filters[fg_idx];
 
     av_assert0(out_idx < fg->nb_outputs);
-    return send_to_enc(sch, &sch->enc[fg->outputs[out_idx].dst.idx], frame);
+
+    t   = av_gettime_relative();
+    ret = send_to_enc(sch, &sch->enc[fg->outputs[out_idx].dst.idx], frame);
+    task_stats_add(&fg->task.stats.wait_out, t);
+
+    return ret;
 }
 
 static int filter_done(Scheduler *sch, unsigned fg_idx)
@@ -2444,6 +2766,8 @@ static void *task_wrapper(void *arg)
     int ret;
     int err = 0;
 
+    atomic_store(&task->stats.time_start, av_gettime_relative());
+
     ret = task->func(task->func_arg);
     if (ret < 0)
         av_log(task->func_arg, AV_LOG_ERROR,
@@ -2452,6 +2776,8 @@ static void *task_wrapper(void *arg)
     err = task_cleanup(sch, task->node);
     ret = err_merge(ret, err);
 
+    atomic_store(&task->stats.time_end, av_gettime_relative());
+
     // EOF is considered normal termination
     if (ret == AVERROR_EOF)
         ret = 0;
@@ -2481,6 +2807,80 @@ static int task_stop(Scheduler *sch, SchTask *task)
     return (intptr_t)thread_ret;
 }
 
+static void task_stats_print(AVBPrint *bp, unsigned *nb_printed,
+                             const char *type, unsigned idx,
+                             SchTask *task, ThreadQueue *tq, int64_t now)
+{
+    int64_t start    = atomic_load(&task->stats.time_start);
+    int64_t end      = atomic_load(&task->stats.time_end);
+    int64_t wait_in  = atomic_load_explicit(&task->stats.wait_in,  memory_order_relaxed);
+    int64_t wait_out = atomic_load_explicit(&task->stats.wait_out, memory_order_relaxed);
+    int64_t busy     = start ? (end ? end : now) - start - wait_in - wait_out : 0;
+
+    av_bprintf(bp, "%s{\"type\":\"%s\",\"index\":%u,\"running\":%d,"
+               "\"busy_us\":%"PRId64",\"wait_in_us\":%"PRId64",\"wait_out_us\":%"PRId64,
+               (*nb_printed)++ ? "," : "",
+               type, idx, start && !end, FFMAX(busy, 0), wait_in, wait_out);
+
+    /* the queues are allocated before the threads start and only freed in
+     * sch_free(), tq_get_stats() takes the queue lock */
+    if (tq) {
+        ThreadQueueStats qs;
+
+        tq_get_stats(tq, &qs);
+        av_bprintf(bp, ",\"queue\":{\"capacity\":%zu,\"fill\":%zu,\"bytes\":%zu,"
+                   "\"send_blocked\":%"PRIu64",\"recv_blocked\":%"PRIu64",\"fill_hist\":[",
+                   qs.capacity, qs.fill, qs.bytes, qs.nb_send_blocked, qs.nb_recv_blocked);
+        for (int i = 0; i < TQ_FILL_HIST_SIZE; i++)
+            av_bprintf(bp, "%s%"PRIu64, i ? "," : "", qs.fill_hist[i]);
+        av_bprintf(bp, "]}");
+    }
+
+    av_bprintf(bp, "}");
+}
+
+void sch_stats_print(Scheduler *sch, AVBPrint *bp)
+{
+    int64_t now = av_gettime_relative();
+    unsigned nb_printed = 0;
+
+    av_bprintf(bp, "{\"time_us\":%"PRId64",\"nodes\":[",
+               sch->start_time ? now - sch->start_time : 0);
+
+    for (unsigned i = 0; i < sch->nb_demux; i++)
+        task_stats_print(bp, &nb_printed, "demux", i, &sch->demux[i].task, NULL, now);
+    for (unsigned i = 0; i < sch->nb_dec; i++)
+        task_stats_print(bp, &nb_printed, "dec", i, &sch->dec[i].task, sch->dec[i].queue, now);
+    for (unsigned i = 0; i < sch->nb_filters; i++)
+        task_stats_print(bp, &nb_printed, "filter", i, &sch->filters[i].task, sch->filters[i].queue, now);
+    for (unsigned i = 0; i < sch->nb_enc; i++)
+        task_stats_print(bp, &nb_printed, "enc", i, &sch->enc[i].task, sch->enc[i].queue, now);
+    for (unsigned i = 0; i < sch->nb_mux; i++)
+        task_stats_print(bp, &nb_printed, "mux", i, &sch->mux[i].task, sch->mux[i].queue, now);
+
+    av_bprintf(bp, "]}\n");
+}
+
+static void dec_log_stats(Scheduler *sch, SchDec *dec)
+{
+    if (!dec->dst_stats)
+        return;
+
+    for (unsigned i = 0; i < dec->nb_dst; i++) {
+        const SchedulerNode *dst   = &dec->dst[i];
+        const SchEdgeStats  *stats = &dec->dst_stats[i];
+        // encoders never write to their input frames
+        uint64_t nb_copied = dst->type == SCH_NODE_TYPE_FILTER_IN ?
+            sch->filters[dst->idx].inputs[dst->idx_stream].nb_frames_copied : 0;
+
+        av_log(dec, AV_LOG_VERBOSE,
+               "Output %u (%s %u:%u): %"PRIu64" frames sent, %"PRIu64" copied "
+               "by the destination\n", i,
+               dst->type == SCH_NODE_TYPE_FILTER_IN ? "filtergraph" : "encoder",
+               dst->idx, dst->idx_stream, stats->nb_frames, nb_copied);
+    }
+}
+
 int sch_stop(Scheduler *sch, int64_t *finish_ts)
 {
     int ret = 0, err;
@@ -2534,6 +2934,9 @@ int sch_stop(Scheduler *sch, int64_t *finish_ts)
     if (finish_ts)
         *finish_ts = trailing_dts(sch, 1);
 
+    for (unsigned i = 0; i < sch->nb_dec; i++)
+        dec_log_stats(sch, &sch->dec[i]);
+
     sch->state = SCH_STATE_STOPPED;
 
     return ret;
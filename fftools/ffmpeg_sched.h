@@ -81,6 +81,7 @@
  * knowledge about the whole transcoding pipeline.
  */
 
+struct AVBPrint;
 struct AVFrame;
 struct AVPacket;
 
@@ -142,6 +143,22 @@ int sch_stop(Scheduler *sch, int64_t *finish_ts);
  */
 int sch_wait(Scheduler *sch, uint64_t timeout_us, int64_t *transcode_ts);
 
+/**
+ * Print a snapshot of per-node timing and queue statistics as a single line
+ * of JSON.
+ *
+ * For every node the time its thread spent busy, blocked waiting for input
+ * and blocked on sending output (including being choked) is given in
+ * microseconds. Nodes with an input queue also report the queue capacity,
+ * current fill level, how often sending/receiving blocked and a histogram of
+ * fill levels, see ThreadQueueStats.
+ *
+ * May be called from the main thread while the scheduler is running, and
+ * after sch_stop(). The values of one node are a consistent snapshot, see
+ * tq_get_stats(), but different nodes are read at different times.
+ */
+void sch_stats_print(Scheduler *sch, struct AVBPrint *bp);
+
 /**
  * Add a demuxer to the scheduler.
  *
@@ -284,6 +301,19 @@ int sch_mux_stream_ready(Scheduler *sch, unsigned mux_idx, unsigned stream_idx);
  */
 int sch_sdp_filename(Scheduler *sch, const char *sdp_filename);
 
+/**
+ * Set a budget for the total size of the packets and frames queued between
+ * the scheduler nodes.
+ *
+ * Whenever the budget is exceeded, the source (demuxer or filtergraph with
+ * internal sources) feeding the largest part of the queued data is choked
+ * until the total is back below the budget. The queues are always drained by
+ * their consumers, so this cannot stall the pipeline.
+ *
+ * @param bytes the budget in bytes, 0 disables it (the default)
+ */
+void sch_set_mem_budget(Scheduler *sch, size_t bytes);
+
 /**
  * Add an encoder to the scheduler.
  *
@@ -410,6 +440,18 @@ int sch_filter_receive(Scheduler *sch, unsigned fg_idx,
  */
 void sch_filter_receive_finish(Scheduler *sch, unsigned fg_idx, unsigned in_idx);
 
+/**
+ * Called by filtergraph tasks to report frames received on an input whose
+ * data had to be copied because it was still referenced elsewhere, e.g. by the
+ * decoder or by other destinations of the same frame.
+ *
+ * @param fg_idx Filtergraph index previously returned by sch_add_filtergraph().
+ * @param in_idx Index of the input that received the frames.
+ * @param nb_copies Number of frames copied since the last call.
+ */
+void sch_filter_in_add_copies(Scheduler *sch, unsigned fg_idx, unsigned in_idx,
+                              uint64_t nb_copies);
+
 /**
  * Called by filtergraph tasks to send a filtered frame or EOF to consumers.
  *
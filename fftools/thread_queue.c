@@ -16,10 +16,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <string.h>
 
 #include "libavutil/avassert.h"
+#include "libavutil/common.h"
 #include "libavutil/error.h"
 #include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
@@ -37,19 +39,38 @@ enum {
 typedef struct FifoElem {
     void        *obj;
     unsigned int stream_idx;
+    size_t       size;
 } FifoElem;
 
 struct ThreadQueue {
     int              *finished;
+    /* size of the queued items for each stream, modified with the lock held
+     * but readable without it */
+    atomic_size_t    *bytes;
     unsigned int    nb_streams;
 
     AVFifo  *fifo;
 
     ObjPool *obj_pool;
     void   (*obj_move)(void *dst, void *src);
+    size_t (*obj_size)(const void *obj);
 
     pthread_mutex_t lock;
-    pthread_cond_t  cond;
+    /* signalled when space in the FIFO becomes available or the receiving
+     * side finishes a stream */
+    pthread_cond_t  cond_send;
+    /* signalled when data or an EOF becomes available for the receiver */
+    pthread_cond_t  cond_recv;
+
+    /* number of threads blocked in tq_send()/tq_receive(), used to avoid
+     * waking up threads when nobody is waiting */
+    unsigned int    nb_send_waiting;
+    unsigned int    nb_recv_waiting;
+
+    // size of the items removed from the queue by the last tq_receive() call
+    size_t          bytes_received;
+
+    ThreadQueueStats stats;
 };
 
 void tq_free(ThreadQueue **ptq)
@@ -69,15 +90,18 @@ void tq_free(ThreadQueue **ptq)
     objpool_free(&tq->obj_pool);
 
     av_freep(&tq->finished);
+    av_freep(&tq->bytes);
 
-    pthread_cond_destroy(&tq->cond);
+    pthread_cond_destroy(&tq->cond_recv);
+    pthread_cond_destroy(&tq->cond_send);
     pthread_mutex_destroy(&tq->lock);
 
     av_freep(ptq);
 }
 
 ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
-                      ObjPool *obj_pool, void (*obj_move)(void *dst, void *src))
+                      ObjPool *obj_pool, void (*obj_move)(void *dst, void *src),
+                      size_t (*obj_size)(const void *obj))
 {
     ThreadQueue *tq;
     int ret;
@@ -86,15 +110,23 @@ ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
     if (!tq)
         return NULL;
 
-    ret = pthread_cond_init(&tq->cond, NULL);
+    ret = pthread_cond_init(&tq->cond_send, NULL);
+    if (ret) {
+        av_freep(&tq);
+        return NULL;
+    }
+
+    ret = pthread_cond_init(&tq->cond_recv, NULL);
     if (ret) {
+        pthread_cond_destroy(&tq->cond_send);
         av_freep(&tq);
         return NULL;
     }
 
     ret = pthread_mutex_init(&tq->lock, NULL);
     if (ret) {
-        pthread_cond_destroy(&tq->cond);
+        pthread_cond_destroy(&tq->cond_recv);
+        pthread_cond_destroy(&tq->cond_send);
         av_freep(&tq);
         return NULL;
     }
@@ -104,12 +136,19 @@ ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
         goto fail;
     tq->nb_streams = nb_streams;
 
+    tq->bytes = av_calloc(nb_streams, sizeof(*tq->bytes));
+    if (!tq->bytes)
+        goto fail;
+    for (unsigned int i = 0; i < nb_streams; i++)
+        atomic_init(&tq->bytes[i], 0);
+
     tq->fifo = av_fifo_alloc2(queue_size, sizeof(FifoElem), 0);
     if (!tq->fifo)
         goto fail;
 
     tq->obj_pool = obj_pool;
     tq->obj_move = obj_move;
+    tq->obj_size = obj_size;
 
     return tq;
 fail:
@@ -132,8 +171,14 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
         goto finish;
     }
 
-    while (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo))
-        pthread_cond_wait(&tq->cond, &tq->lock);
+    if (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo))
+        tq->stats.nb_send_blocked++;
+
+    while (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo)) {
+        tq->nb_send_waiting++;
+        pthread_cond_wait(&tq->cond_send, &tq->lock);
+        tq->nb_send_waiting--;
+    }
 
     if (*finished & FINISHED_RECV) {
         ret = AVERROR_EOF;
@@ -146,10 +191,22 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
             goto finish;
 
         tq->obj_move(elem.obj, data);
+        if (tq->obj_size)
+            elem.size = tq->obj_size(elem.obj);
 
         ret = av_fifo_write(tq->fifo, &elem, 1);
         av_assert0(ret >= 0);
-        pthread_cond_broadcast(&tq->cond);
+
+        atomic_fetch_add_explicit(&tq->bytes[stream_idx], elem.size,
+                                  memory_order_relaxed);
+        tq->stats.bytes += elem.size;
+
+        tq->stats.fill_hist[FFMIN(av_log2(av_fifo_can_read(tq->fifo)),
+                                  TQ_FILL_HIST_SIZE - 1)]++;
+
+        /* there is only ever one receiving thread */
+        if (tq->nb_recv_waiting)
+            pthread_cond_signal(&tq->cond_recv);
     }
 
 finish:
@@ -165,6 +222,11 @@ static int receive_locked(ThreadQueue *tq, int *stream_idx,
     unsigned int nb_finished = 0;
 
     while (av_fifo_read(tq->fifo, &elem, 1) >= 0) {
+        atomic_fetch_sub_explicit(&tq->bytes[elem.stream_idx], elem.size,
+                                  memory_order_relaxed);
+        tq->stats.bytes    -= elem.size;
+        tq->bytes_received += elem.size;
+
         if (tq->finished[elem.stream_idx] & FINISHED_RECV) {
             objpool_release(tq->obj_pool, &elem.obj);
             continue;
@@ -195,23 +257,34 @@ static int receive_locked(ThreadQueue *tq, int *stream_idx,
 
 int tq_receive(ThreadQueue *tq, int *stream_idx, void *data)
 {
-    int ret;
+    int ret, blocked = 0;
 
     *stream_idx = -1;
 
     pthread_mutex_lock(&tq->lock);
 
+    tq->bytes_received = 0;
+
     while (1) {
         size_t can_read = av_fifo_can_read(tq->fifo);
 
         ret = receive_locked(tq, stream_idx, data);
 
-        // signal other threads if the fifo state changed
-        if (can_read != av_fifo_can_read(tq->fifo))
-            pthread_cond_broadcast(&tq->cond);
+        // wake up as many blocked senders as there are freed slots
+        if (tq->nb_send_waiting) {
+            size_t freed = can_read - av_fifo_can_read(tq->fifo);
+            if (freed > 1)
+                pthread_cond_broadcast(&tq->cond_send);
+            else if (freed)
+                pthread_cond_signal(&tq->cond_send);
+        }
 
         if (ret == AVERROR(EAGAIN)) {
-            pthread_cond_wait(&tq->cond, &tq->lock);
+            if (!blocked++)
+                tq->stats.nb_recv_blocked++;
+            tq->nb_recv_waiting++;
+            pthread_cond_wait(&tq->cond_recv, &tq->lock);
+            tq->nb_recv_waiting--;
             continue;
         }
 
@@ -233,7 +306,8 @@ void tq_send_finish(ThreadQueue *tq, unsigned int stream_idx)
      * next time the consumer thread tries to read this stream it will get
      * an EOF and recv-finished flag will be set */
     tq->finished[stream_idx] |= FINISHED_SEND;
-    pthread_cond_broadcast(&tq->cond);
+    if (tq->nb_recv_waiting)
+        pthread_cond_signal(&tq->cond_recv);
 
     pthread_mutex_unlock(&tq->lock);
 }
@@ -248,7 +322,41 @@ void tq_receive_finish(ThreadQueue *tq, unsigned int stream_idx)
      * next time the producer thread tries to send for this stream, it will
      * get an EOF and send-finished flag will be set */
     tq->finished[stream_idx] |= FINISHED_RECV;
-    pthread_cond_broadcast(&tq->cond);
+    /* senders of any stream may be blocked, wake them all up so that the
+     * ones sending to this stream can return EOF */
+    if (tq->nb_send_waiting)
+        pthread_cond_broadcast(&tq->cond_send);
+    if (tq->nb_recv_waiting)
+        pthread_cond_signal(&tq->cond_recv);
 
     pthread_mutex_unlock(&tq->lock);
 }
+
+void tq_get_stats(ThreadQueue *tq, ThreadQueueStats *stats)
+{
+    pthread_mutex_lock(&tq->lock);
+
+    *stats          = tq->stats;
+    stats->fill     = av_fifo_can_read(tq->fifo);
+    stats->capacity = stats->fill + av_fifo_can_write(tq->fifo);
+
+    pthread_mutex_unlock(&tq->lock);
+}
+
+size_t tq_received_bytes(ThreadQueue *tq)
+{
+    size_t bytes;
+
+    pthread_mutex_lock(&tq->lock);
+    bytes = tq->bytes_received;
+    pthread_mutex_unlock(&tq->lock);
+
+    return bytes;
+}
+
+size_t tq_stream_bytes(ThreadQueue *tq, unsigned int stream_idx)
+{
+    av_assert0(stream_idx < tq->nb_streams);
+
+    return atomic_load_explicit(&tq->bytes[stream_idx], memory_order_relaxed);
+}
@@ -19,12 +19,34 @@
 #ifndef FFTOOLS_THREAD_QUEUE_H
 #define FFTOOLS_THREAD_QUEUE_H
 
+#include <stdint.h>
 #include <string.h>
 
 #include "objpool.h"
 
 typedef struct ThreadQueue ThreadQueue;
 
+#define TQ_FILL_HIST_SIZE 8
+
+typedef struct ThreadQueueStats {
+    // maximum number of items in the queue
+    size_t      capacity;
+    // number of items currently in the queue
+    size_t      fill;
+    // total size of the items currently in the queue, as reported by the
+    // obj_size callback
+    size_t      bytes;
+
+    // number of tq_send()/tq_receive() calls that had to block
+    uint64_t    nb_send_blocked;
+    uint64_t    nb_recv_blocked;
+
+    /* histogram of the number of queued items seen after each sent item;
+     * bucket i counts fill levels in [2^i, 2^(i+1)), the last bucket also
+     * counts all larger ones */
+    uint64_t    fill_hist[TQ_FILL_HIST_SIZE];
+} ThreadQueueStats;
+
 /**
  * Allocate a queue for sending data between threads.
  *
@@ -35,9 +57,12 @@ typedef struct ThreadQueue ThreadQueue;
  * @param obj_pool object pool that will be used to allocate items stored in the
  *                 queue; the pool becomes owned by the queue
  * @param callback that moves the contents between two data pointers
+ * @param obj_size callback that returns the memory size of an item, used for
+ *                 accounting the amount of queued data; may be NULL
  */
 ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
-                      ObjPool *obj_pool, void (*obj_move)(void *dst, void *src));
+                      ObjPool *obj_pool, void (*obj_move)(void *dst, void *src),
+                      size_t (*obj_size)(const void *obj));
 void         tq_free(ThreadQueue **tq);
 
 /**
@@ -78,4 +103,22 @@ int tq_receive(ThreadQueue *tq, int *stream_idx, void *data);
  */
 void tq_receive_finish(ThreadQueue *tq, unsigned int stream_idx);
 
+/**
+ * Get a snapshot of the queue statistics.
+ */
+void tq_get_stats(ThreadQueue *tq, ThreadQueueStats *stats);
+
+/**
+ * Get the total size of the items removed from the queue by the last
+ * tq_receive() call. This includes the items that were discarded because
+ * the receiving side finished their stream.
+ */
+size_t tq_received_bytes(ThreadQueue *tq);
+
+/**
+ * Get the total size of the items currently queued for the given stream.
+ * Does not take the queue lock, so it may be called while holding other locks.
+ */
+size_t tq_stream_bytes(ThreadQueue *tq, unsigned int stream_idx);
+
 #endif // FFTOOLS_THREAD_QUEUE_H
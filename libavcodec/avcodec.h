@@ -2075,6 +2075,51 @@ typedef struct AVCodecContext {
      */
     AVFrameSideData  **decoded_side_data;
     int             nb_decoded_side_data;
+
+    /**
+     * Maximum number of frames of delay frame threading may add.
+     * At most thread_max_delay + 1 frames are decoded in parallel; decoders
+     * that can run slice threads inside frame threads use the remaining
+     * threads for those, others use fewer threads. 0 means no limit, i.e.
+     * thread_count - 1 frames of delay.
+     *
+     * - encoding: unused
+     * - decoding: Set by user before avcodec_open2().
+     */
+    int thread_max_delay;
+
+    /**
+     * Latency budget for frame threading, in microseconds. Once the oldest
+     * packet in flight has been in the decoder for longer than this, no more
+     * frames are started without returning one, which bounds the delay to
+     * what was reached within the budget. 0 means no limit.
+     *
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int64_t thread_max_delay_time;
+
+    /**
+     * Time in microseconds between the packet of the last returned frame
+     * being submitted to the decoder and the frame being returned. The
+     * packet is found by the frame's pts; for frames without one, the last
+     * packet decoded by the thread that output the frame is used, which
+     * differs from the frame's own packet if the decoder reorders frames.
+     *
+     * - encoding: unused
+     * - decoding: Set by libavcodec when frame threading is active.
+     */
+    int64_t frame_thread_latency;
+
+    /**
+     * Largest and mean frame_thread_latency over all frames returned since
+     * the decoder was opened, in microseconds.
+     *
+     * - encoding: unused
+     * - decoding: Set by libavcodec when frame threading is active.
+     */
+    int64_t frame_thread_latency_max;
+    int64_t frame_thread_latency_avg;
 } AVCodecContext;
 
 /**
@@ -88,6 +88,12 @@
  * encoders do.
  */
 #define FF_CODEC_CAP_EOF_FLUSH              (1 << 10)
+/**
+ * The decoder supports slice threading within each frame thread. When
+ * frame threading is used with more threads than are useful for it, the
+ * remaining threads are given to each frame thread as slice threads.
+ */
+#define FF_CODEC_CAP_FRAME_SLICE_THREADS    (1 << 11)
 
 /**
  * FFCodec.codec_tags termination value
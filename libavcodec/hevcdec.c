@@ -3576,7 +3576,6 @@ static int hevc_update_thread_context(AVCodecContext *dst,
     s->is_nalff        = s0->is_nalff;
     s->nal_length_size = s0->nal_length_size;
 
-    s->threads_number      = s0->threads_number;
     s->threads_type        = s0->threads_type;
 
     s->film_grain_warning_shown = s0->film_grain_warning_shown;
@@ -3634,7 +3633,10 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
     } else
         s->threads_number = 1;
 
-    if((avctx->active_thread_type & FF_THREAD_FRAME) && avctx->thread_count > 1)
+    /* With FF_CODEC_CAP_FRAME_SLICE_THREADS, each frame thread may also run
+     * WPP rows on its own slice threads; thread_count is then the number
+     * of those slice threads. */
+    if (avctx->active_thread_type & FF_THREAD_FRAME)
         s->threads_type = FF_THREAD_FRAME;
     else
         s->threads_type = FF_THREAD_SLICE;
@@ -3714,7 +3716,8 @@ const FFCodec ff_hevc_decoder = {
     .p.capabilities        = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
                              AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal         = FF_CODEC_CAP_EXPORTS_CROPPING |
-                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP,
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP |
+                             FF_CODEC_CAP_FRAME_SLICE_THREADS,
     .p.profiles            = NULL_IF_CONFIG_SMALL(ff_hevc_profiles),
     .hw_configs            = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_HEVC_DXVA2_HWACCEL
@@ -63,6 +63,12 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * Slice threading context. This is separate from thread_ctx so that
+     * the per-thread contexts of frame threading can run slice threads too.
+     */
+    void *slice_thread_ctx;
+
     /**
      * This packet is used to hold the packet given to decoders
      * implementing the .decode API; it is unused by the generic
@@ -62,7 +62,10 @@ static void validate_thread_parameters(AVCodecContext *avctx)
         avctx->active_thread_type = 0;
     }
 
-    if (avctx->thread_count > MAX_AUTO_THREADS)
+    if (avctx->thread_count > MAX_AUTO_THREADS &&
+        !(avctx->active_thread_type == FF_THREAD_FRAME &&
+          ffcodec(avctx->codec)->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS &&
+          avctx->thread_type & FF_THREAD_SLICE))
         av_log(avctx, AV_LOG_WARNING,
                "Application has requested %d threads. Using a thread count greater than %d is not recommended.\n",
                avctx->thread_count, MAX_AUTO_THREADS);
@@ -73,7 +76,7 @@ int ff_thread_init(AVCodecContext *avctx)
     validate_thread_parameters(avctx);
 
     if (avctx->active_thread_type&FF_THREAD_SLICE)
-        return ff_slice_thread_init(avctx);
+        return ff_slice_thread_init(avctx, NULL);
     else if (avctx->active_thread_type&FF_THREAD_FRAME)
         return ff_frame_thread_init(avctx);
 
@@ -44,12 +44,14 @@
 #include "libavutil/buffer.h"
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
+#include "libavutil/executor_internal.h"
 #include "libavutil/frame.h"
 #include "libavutil/internal.h"
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 enum {
     /// Set when the thread is awaiting a packet.
@@ -66,10 +68,35 @@ enum {
     INITIALIZED,    ///< Thread has been properly set up
 };
 
+/**
+ * Number of packet submit times remembered for measuring frame latency,
+ * enough for the frames in flight plus the decoder reordering delay.
+ * Must be a power of 2.
+ */
+#define MAX_SUBMIT_TIMES 64
+
 typedef struct ThreadFrameProgress {
     atomic_int progress[2];
+
+    /* Statistics on threads blocked waiting for this frame, protected
+     * by the owner's progress_mutex. */
+    unsigned nb_waits[2];
+    int64_t  wait_time[2];
 } ThreadFrameProgress;
 
+/**
+ * A thread blocked in ff_thread_await_progress(). It is linked into the
+ * list of the frame owner and only woken once the awaited value is reached.
+ */
+typedef struct ProgressWaiter {
+    struct ProgressWaiter *next;
+    pthread_cond_t cond;
+    ThreadFrameProgress *progress;  ///< Awaited frame, NULL if the waiter is unused.
+    int field;
+    int n;
+    int64_t start;                  ///< Time at which the thread started waiting.
+} ProgressWaiter;
+
 /**
  * Context used by codec threads and stored in their AVCodecInternal thread_ctx.
  */
@@ -80,15 +107,32 @@ typedef struct PerThreadContext {
     int            thread_init;
     unsigned       pthread_init_cnt;///< Number of successfully initialized mutexes/conditions
     pthread_cond_t input_cond;      ///< Used to wait for a new packet from the main thread.
-    pthread_cond_t progress_cond;   ///< Used by child threads to wait for progress to change.
+    pthread_cond_t progress_cond;   ///< Used by child threads to wait for state to change.
     pthread_cond_t output_cond;     ///< Used by the main thread to wait for frames to finish.
 
     pthread_mutex_t mutex;          ///< Mutex used to protect the contents of the PerThreadContext.
     pthread_mutex_t progress_mutex; ///< Mutex used to protect frame progress values and progress_cond.
 
+    /**
+     * Threads waiting for progress on frames owned by this thread,
+     * protected by progress_mutex.
+     */
+    ProgressWaiter *waiters;
+    /**
+     * Waiters that threads blocking on frames owned by this thread pick
+     * from, one for each thread that may decode concurrently, so that each
+     * of them can wait at the same time. Allocated with their condition
+     * variables at init, protected by progress_mutex.
+     */
+    ProgressWaiter *waiter_pool;
+    unsigned nb_waiter_pool;        ///< Number of waiters in waiter_pool with an initialized cond.
+    unsigned nb_waits;              ///< Number of blocking waits on frames owned by this thread.
+    int64_t  wait_time;             ///< Total time spent in those waits, in microseconds.
+
     AVCodecContext *avctx;          ///< Context used to decode packets passed to this thread.
 
     AVPacket       *avpkt;          ///< Input packet (for decoding) or output (for encoding).
+    int64_t   submit_time;          ///< Time at which the last non-empty packet was submitted to this thread.
 
     AVFrame *frame;                 ///< Output frame (for decoding) or input (for encoding).
     int     got_frame;              ///< The output of got_picture_ptr from the last avcodec_decode_video() call.
@@ -128,6 +172,8 @@ typedef struct FrameThreadContext {
     pthread_cond_t async_cond;
     int async_lock;
 
+    struct FFSharedExecutor *slice_pool; ///< Slice threads shared by all frame threads.
+
     int next_decoding;             ///< The next context to submit a packet to.
     int next_finished;             ///< The next context to return output from.
 
@@ -136,6 +182,19 @@ typedef struct FrameThreadContext {
                                     * While it is set, ff_thread_en/decode_frame won't return any results.
                                     */
 
+    /**
+     * Submit times of the most recent packets, keyed by pts, so that the
+     * latency of a returned frame is measured from its own packet even if
+     * the decoder reorders frames.
+     */
+    struct {
+        int64_t pts;
+        int64_t time;
+    } submit_times[MAX_SUBMIT_TIMES];
+    unsigned next_submit_time;     ///< Next entry of submit_times to be overwritten.
+    int64_t  latency_total;        ///< Sum of the latencies of all returned frames.
+    uint64_t nb_latencies;         ///< Number of frames in latency_total.
+
     /* hwaccel state for thread-unsafe hwaccels is temporarily stored here in
      * order to transfer its ownership to the next decoding thread without the
      * need for extra synchronization */
@@ -475,6 +534,14 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
         return ret;
     }
 
+    if (avpkt->size) {
+        unsigned idx = fctx->next_submit_time++ % MAX_SUBMIT_TIMES;
+
+        p->submit_time = av_gettime_relative();
+        fctx->submit_times[idx].pts  = avpkt->pts;
+        fctx->submit_times[idx].time = p->submit_time;
+    }
+
     atomic_store(&p->state, STATE_SETTING_UP);
     pthread_cond_signal(&p->input_cond);
     pthread_mutex_unlock(&p->mutex);
@@ -485,6 +552,39 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
     return 0;
 }
 
+/**
+ * Update the latency statistics for a returned frame. The submit time of
+ * the packet the frame's pts came from is used; without a match, that of
+ * the last packet the returning thread decoded.
+ */
+static void update_latency(FrameThreadContext *fctx, AVCodecContext *avctx,
+                           const AVFrame *frame, int64_t fallback_time)
+{
+    int64_t submit_time = fallback_time, latency;
+
+    if (frame->pts != AV_NOPTS_VALUE) {
+        unsigned nb = FFMIN(fctx->next_submit_time, MAX_SUBMIT_TIMES);
+
+        /* oldest first, so that frames sharing a pts match in order */
+        for (unsigned i = fctx->next_submit_time - nb; i != fctx->next_submit_time; i++) {
+            unsigned idx = i % MAX_SUBMIT_TIMES;
+            if (fctx->submit_times[idx].pts == frame->pts) {
+                submit_time = fctx->submit_times[idx].time;
+                fctx->submit_times[idx].pts = AV_NOPTS_VALUE;
+                break;
+            }
+        }
+    }
+
+    latency = av_gettime_relative() - submit_time;
+    fctx->latency_total += latency;
+    fctx->nb_latencies++;
+
+    avctx->frame_thread_latency     = latency;
+    avctx->frame_thread_latency_max = FFMAX(avctx->frame_thread_latency_max, latency);
+    avctx->frame_thread_latency_avg = fctx->latency_total / fctx->nb_latencies;
+}
+
 int ff_thread_decode_frame(AVCodecContext *avctx,
                            AVFrame *picture, int *got_picture_ptr,
                            AVPacket *avpkt)
@@ -513,6 +613,12 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
 
     if (fctx->next_decoding > (avctx->thread_count-1-(avctx->codec_id == AV_CODEC_ID_FFV1)))
         fctx->delaying = 0;
+    /* Stop filling the remaining threads once the oldest packet has been
+     * waiting for longer than the latency budget; the number of frames in
+     * flight then stays at what has been reached so far. */
+    else if (fctx->delaying && avctx->thread_max_delay_time > 0 &&
+             av_gettime_relative() - fctx->threads[finished].submit_time > avctx->thread_max_delay_time)
+        fctx->delaying = 0;
 
     if (fctx->delaying) {
         *got_picture_ptr=0;
@@ -558,6 +664,9 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
 
     update_context_from_thread(avctx, p->avctx, 1);
 
+    if (*got_picture_ptr)
+        update_latency(fctx, avctx, picture, p->submit_time);
+
     if (fctx->next_decoding >= avctx->thread_count) fctx->next_decoding = 0;
 
     fctx->next_finished = finished;
@@ -573,7 +682,10 @@ finish:
 void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 {
     PerThreadContext *p;
-    atomic_int *progress = f->progress ? f->progress->progress : NULL;
+    ThreadFrameProgress *fp = f->progress;
+    atomic_int *progress = fp ? fp->progress : NULL;
+    ProgressWaiter **wp;
+    int64_t now = 0;
 
     if (!progress ||
         atomic_load_explicit(&progress[field], memory_order_relaxed) >= n)
@@ -587,9 +699,39 @@ void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 
     pthread_mutex_lock(&p->progress_mutex);
 
-    atomic_store_explicit(&progress[field], n, memory_order_release);
+    /* with slice threads inside a frame thread, several threads may report
+     * progress on the same frame; never move it backwards */
+    if (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
+        atomic_store_explicit(&progress[field], n, memory_order_release);
+    n = atomic_load_explicit(&progress[field], memory_order_relaxed);
+
+    /* only wake the threads whose awaited value has been reached */
+    wp = &p->waiters;
+    while (*wp) {
+        ProgressWaiter *w = *wp;
+
+        if (w->progress != fp || w->field != field || w->n > n) {
+            wp = &w->next;
+            continue;
+        }
+        if (!now)
+            now = av_gettime_relative();
+        fp->nb_waits[field]++;
+        fp->wait_time[field] += now - w->start;
+        *wp = w->next;
+        pthread_cond_signal(&w->cond);
+    }
+
+    if (n == INT_MAX) {
+        p->nb_waits  += fp->nb_waits[field];
+        p->wait_time += fp->wait_time[field];
+        if (fp->nb_waits[field] &&
+            atomic_load_explicit(&p->debug_threads, memory_order_relaxed))
+            av_log(f->owner[field], AV_LOG_DEBUG,
+                   "%p field %d: %u waits, %"PRId64" us blocked on it\n",
+                   progress, field, fp->nb_waits[field], fp->wait_time[field]);
+    }
 
-    pthread_cond_broadcast(&p->progress_cond);
     pthread_mutex_unlock(&p->progress_mutex);
 }
 
@@ -597,6 +739,7 @@ void ff_thread_await_progress(const ThreadFrame *f, int n, int field)
 {
     PerThreadContext *p;
     atomic_int *progress = f->progress ? f->progress->progress : NULL;
+    ProgressWaiter *w = NULL;
 
     if (!progress ||
         atomic_load_explicit(&progress[field], memory_order_acquire) >= n)
@@ -609,8 +752,28 @@ void ff_thread_await_progress(const ThreadFrame *f, int n, int field)
                "thread awaiting %d field %d from %p\n", n, field, progress);
 
     pthread_mutex_lock(&p->progress_mutex);
-    while (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
-        pthread_cond_wait(&p->progress_cond, &p->progress_mutex);
+    if (atomic_load_explicit(&progress[field], memory_order_relaxed) < n) {
+        /* there is one waiter per thread, and a thread waits on one frame
+         * at a time, so one of them is always free */
+        for (unsigned i = 0; i < p->nb_waiter_pool; i++) {
+            if (!p->waiter_pool[i].progress) {
+                w = &p->waiter_pool[i];
+                break;
+            }
+        }
+        av_assert0(w);
+
+        w->progress = f->progress;
+        w->field    = field;
+        w->n        = n;
+        w->start    = av_gettime_relative();
+        w->next     = p->waiters;
+        p->waiters  = w;
+        /* we are unlinked by the report that reaches n */
+        while (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
+            pthread_cond_wait(&w->cond, &p->progress_mutex);
+        w->progress = NULL;
+    }
     pthread_mutex_unlock(&p->progress_mutex);
 }
 
@@ -697,10 +860,20 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 {
     FrameThreadContext *fctx = avctx->internal->thread_ctx;
     const FFCodec *codec = ffcodec(avctx->codec);
+    unsigned nb_waits = 0;
+    int64_t wait_time = 0;
     int i;
 
     park_frame_worker_threads(fctx, thread_count);
 
+    for (i = 0; i < thread_count; i++) {
+        nb_waits  += fctx->threads[i].nb_waits;
+        wait_time += fctx->threads[i].wait_time;
+    }
+    if (nb_waits && avctx->debug & FF_DEBUG_THREADS)
+        av_log(avctx, AV_LOG_DEBUG, "%u waits on reference progress, "
+               "%"PRId64" us blocked in total\n", nb_waits, wait_time);
+
     for (i = 0; i < thread_count; i++) {
         PerThreadContext *p = &fctx->threads[i];
         AVCodecContext *ctx = p->avctx;
@@ -714,6 +887,8 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 
                 pthread_join(p->thread, NULL);
             }
+            if (ctx->internal->slice_thread_ctx)
+                ff_slice_thread_free(ctx);
             if (codec->close && p->thread_init != UNINITIALIZED)
                 codec->close(ctx);
 
@@ -735,6 +910,10 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 
         av_frame_free(&p->frame);
 
+        for (unsigned j = 0; j < p->nb_waiter_pool; j++)
+            pthread_cond_destroy(&p->waiter_pool[j].cond);
+        av_freep(&p->waiter_pool);
+
         ff_pthread_free(p, per_thread_offsets);
         av_packet_free(&p->avpkt);
 
@@ -742,6 +921,7 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
     }
 
     av_freep(&fctx->threads);
+    avpriv_executor_shared_unref(&fctx->slice_pool);
     ff_pthread_free(fctx, thread_ctx_offsets);
 
     /* if we have stashed hwaccel state, move it to the user-facing context,
@@ -756,7 +936,8 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 
 static av_cold int init_thread(PerThreadContext *p, int *threads_to_free,
                                FrameThreadContext *fctx, AVCodecContext *avctx,
-                               const FFCodec *codec, int first)
+                               const FFCodec *codec, int first, int slice_threads,
+                               int nb_waiters)
 {
     AVCodecContext *copy;
     int err;
@@ -782,6 +963,16 @@ static av_cold int init_thread(PerThreadContext *p, int *threads_to_free,
 
     copy->delay = avctx->delay;
 
+    if (slice_threads > 1) {
+        copy->thread_count       = slice_threads;
+        copy->active_thread_type = FF_THREAD_SLICE;
+        err = ff_slice_thread_init(copy, fctx->slice_pool);
+        if (err < 0)
+            return err;
+        /* slice threading may have been disabled if creating threads failed */
+        copy->active_thread_type |= FF_THREAD_FRAME;
+    }
+
     if (codec->priv_data_size) {
         copy->priv_data = av_mallocz(codec->priv_data_size);
         if (!copy->priv_data)
@@ -799,6 +990,15 @@ static av_cold int init_thread(PerThreadContext *p, int *threads_to_free,
     if (err < 0)
         return err;
 
+    p->waiter_pool = av_calloc(nb_waiters, sizeof(*p->waiter_pool));
+    if (!p->waiter_pool)
+        return AVERROR(ENOMEM);
+    for (; p->nb_waiter_pool < nb_waiters; p->nb_waiter_pool++) {
+        err = pthread_cond_init(&p->waiter_pool[p->nb_waiter_pool].cond, NULL);
+        if (err)
+            return AVERROR(err);
+    }
+
     if (!(p->frame = av_frame_alloc()) ||
         !(p->avpkt = av_packet_alloc()))
         return AVERROR(ENOMEM);
@@ -838,15 +1038,46 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     int thread_count = avctx->thread_count;
     const FFCodec *codec = ffcodec(avctx->codec);
     FrameThreadContext *fctx;
+    int frame_slice = (codec->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS) &&
+                      (avctx->thread_type & FF_THREAD_SLICE);
+    int frame_threads, pool_threads = 0, slice_threads = 1;
+    int auto_threads = !thread_count;
     int err, i = 0;
 
-    if (!thread_count) {
+    if (auto_threads) {
         int nb_cpus = av_cpu_count();
         // use number of cores + 1 as thread count if there is more than one
         if (nb_cpus > 1)
-            thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
+            thread_count = avctx->thread_count = nb_cpus + 1;
         else
             thread_count = avctx->thread_count = 1;
+        /* codecs combining frame and slice threads use all cores, split
+         * between frame threads and the slice pool below */
+        if (!frame_slice)
+            thread_count = avctx->thread_count = FFMIN(thread_count, MAX_AUTO_THREADS);
+    }
+
+    /* More frame threads than MAX_AUTO_THREADS mostly wait on references,
+     * and each frame thread adds one frame of delay; past either limit, the
+     * remaining threads form a pool of slice threads shared by all frame
+     * threads, for codecs that support it. */
+    frame_threads = thread_count;
+    if (frame_slice) {
+        /* without an explicit count, give about half of the cores to each,
+         * slice threads cut the latency that frame threads add */
+        if (auto_threads)
+            frame_threads = (thread_count + 1) / 2;
+        frame_threads = FFMIN(frame_threads, MAX_AUTO_THREADS);
+    }
+    if (avctx->thread_max_delay > 0)
+        frame_threads = FFMIN(frame_threads, avctx->thread_max_delay + 1);
+    if (frame_threads < thread_count) {
+        if (frame_slice) {
+            pool_threads  = thread_count - frame_threads;
+            // the frame thread itself runs slice jobs as well
+            slice_threads = FFMIN(pool_threads + 1, MAX_AUTO_THREADS);
+        }
+        thread_count = avctx->thread_count = frame_threads;
     }
 
     if (thread_count <= 1) {
@@ -877,11 +1108,20 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         goto error;
     }
 
+    if (pool_threads) {
+        fctx->slice_pool = avpriv_executor_shared_alloc(pool_threads);
+        if (!fctx->slice_pool) {
+            err = AVERROR(ENOMEM);
+            goto error;
+        }
+    }
+
     for (; i < thread_count; ) {
         PerThreadContext *p  = &fctx->threads[i];
         int first = !i;
 
-        err = init_thread(p, &i, fctx, avctx, codec, first);
+        err = init_thread(p, &i, fctx, avctx, codec, first, slice_threads,
+                          thread_count * slice_threads);
         if (err < 0)
             goto error;
     }
@@ -25,7 +25,13 @@
  * limit the number of threads to 16 for automatic detection */
 #define MAX_AUTO_THREADS 16
 
-int ff_slice_thread_init(AVCodecContext *avctx);
+struct FFSharedExecutor;
+
+/**
+ * @param pool if non-NULL, run the slice jobs on the worker threads of this
+ *             executor, which may be shared with other contexts
+ */
+int ff_slice_thread_init(AVCodecContext *avctx, struct FFSharedExecutor *pool);
 void ff_slice_thread_free(AVCodecContext *avctx);
 
 int ff_frame_thread_init(AVCodecContext *avctx);
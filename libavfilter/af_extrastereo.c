@@ -23,6 +23,7 @@
 #include "avfilter.h"
 #include "audio.h"
 #include "formats.h"
+#include "internal.h"
 
 typedef struct ExtraStereoContext {
     const AVClass *class;
@@ -119,5 +120,6 @@ const AVFilter ff_af_extrastereo = {
     FILTER_OUTPUTS(ff_audio_default_filterpad),
     FILTER_QUERY_FUNC(query_formats),
     .flags          = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags_internal = FF_FILTER_FLAG_FRAME_THREADS,
     .process_command = ff_filter_process_command,
 };
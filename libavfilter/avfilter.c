@@ -289,6 +289,11 @@ int avfilter_insert_filter(AVFilterLink *link, AVFilterContext *filt,
     int ret;
     unsigned dstpad_idx = link->dstpad - link->dst->input_pads;
 
+    if (HAVE_THREADS) {
+        ff_frame_thread_wait(link->src);
+        ff_frame_thread_wait(link->dst);
+    }
+
     av_log(link->dst, AV_LOG_VERBOSE, "auto-inserting filter '%s' "
            "between the filter '%s' and the filter '%s'\n",
            filt->name, link->src->name, link->dst->name);
@@ -332,6 +337,15 @@ int ff_filter_config_links(AVFilterContext *filter)
     unsigned i;
     int ret;
 
+    /* the input links are about to be reconfigured, which the workers of
+     * this filter and of the ones feeding it must not observe */
+    if (HAVE_THREADS) {
+        ff_frame_thread_wait(filter);
+        for (i = 0; i < filter->nb_inputs; i++)
+            if (filter->inputs[i] && filter->inputs[i]->src)
+                ff_frame_thread_wait(filter->inputs[i]->src);
+    }
+
     for (i = 0; i < filter->nb_inputs; i ++) {
         AVFilterLink *link = filter->inputs[i];
         AVFilterLink *inlink;
@@ -591,8 +605,20 @@ static int set_enable_expr(AVFilterContext *ctx, const char *expr)
     return 0;
 }
 
+#if HAVE_THREADS
+static int frame_thread_forward(AVFilterContext *filter, int drain);
+#endif
+
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
+#if HAVE_THREADS
+    if (fffilterctx(filter)->frame_thread) {
+        int ret = frame_thread_forward(filter, 1);
+        if (ret < 0)
+            return ret;
+    }
+#endif
+
     if(!strcmp(cmd, "ping")){
         char local_res[256] = {0};
 
@@ -647,8 +673,9 @@ static const AVClass *filter_child_class_iterate(void **iter)
 #define TFLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_RUNTIME_PARAM
 static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, .unit = "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME }, 0, INT_MAX, FLAGS, .unit = "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = TFLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS },
@@ -757,6 +784,15 @@ static void free_link(AVFilterLink *link)
     if (!link)
         return;
 
+    /* the workers of the filters on either side may still use the link,
+     * e.g. allocate from its frame pool */
+    if (HAVE_THREADS) {
+        if (link->src)
+            ff_frame_thread_wait(link->src);
+        if (link->dst)
+            ff_frame_thread_wait(link->dst);
+    }
+
     if (link->src)
         link->src->outputs[link->srcpad - link->src->output_pads] = NULL;
     if (link->dst)
@@ -787,6 +823,9 @@ void avfilter_free(AVFilterContext *filter)
     if (filter->graph)
         ff_filter_graph_remove_filter(filter->graph, filter);
 
+    if (HAVE_THREADS)
+        ff_frame_thread_uninit(filter);
+
     if (filter->filter->uninit)
         filter->filter->uninit(filter);
 
@@ -903,7 +942,7 @@ int ff_filter_process_command(AVFilterContext *ctx, const char *cmd,
 int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
 {
     FFFilterContext *ctxi = fffilterctx(ctx);
-    int ret = 0;
+    int frame_threads, ret = 0;
 
     if (ctxi->initialized) {
         av_log(ctx, AV_LOG_ERROR, "Filter already initialized\n");
@@ -916,6 +955,9 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
+    frame_threads = ctx->filter->flags_internal & FF_FILTER_FLAG_FRAME_THREADS &&
+                    ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_FRAME;
+
     if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
         ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
         fffiltergraph(ctx->graph)->thread_execute) {
@@ -925,6 +967,11 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         ctx->thread_type = 0;
     }
 
+    /* whether the filter actually runs on frame threads is only known once
+       the graph is configured, see ff_graph_frame_thread_init() */
+    if (frame_threads)
+        ctx->thread_type |= AVFILTER_THREAD_FRAME;
+
     if (ctx->filter->init)
         ret = ctx->filter->init(ctx);
     if (ret < 0)
@@ -1015,7 +1062,7 @@ fail:
     return ret;
 }
 
-int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
+static int filter_frame_to_link(AVFilterLink *link, AVFrame *frame)
 {
     FilterLinkInternal * const li = ff_link_internal(link);
     int ret;
@@ -1069,6 +1116,18 @@ error:
     return AVERROR_PATCHWELCOME;
 }
 
+int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
+{
+    /* A frame-threaded filter does not touch the graph from its worker: its
+       output is forwarded on the link by the graph thread, in
+       frame_thread_forward(). Output produced on the graph thread takes the
+       same way, so that it stays in order with the worker's. */
+    if (HAVE_THREADS && fffilterctx(link->src)->frame_thread)
+        return ff_frame_thread_output(link->src, frame);
+
+    return filter_frame_to_link(link, frame);
+}
+
 static int samples_ready(FilterLinkInternal *link, unsigned min)
 {
     return ff_framequeue_queued_frames(&link->fifo) &&
@@ -1155,10 +1214,15 @@ static int ff_filter_frame_to_filter(AVFilterLink *link)
     /* The filter will soon have received a new frame, that may allow it to
        produce one or more: unblock its outputs. */
     filter_unblock(dst);
-    /* AVFilterPad.filter_frame() expect frame_count_out to have the value
-       before the frame; ff_filter_frame_framed() will re-increment it. */
-    link->frame_count_out--;
-    ret = ff_filter_frame_framed(link, frame);
+    if (HAVE_THREADS && fffilterctx(dst)->frame_thread &&
+        !dst->command_queue && !dst->enable) {
+        ret = ff_frame_thread_submit(dst, frame);
+    } else {
+        /* AVFilterPad.filter_frame() expect frame_count_out to have the value
+           before the frame; ff_filter_frame_framed() will re-increment it. */
+        link->frame_count_out--;
+        ret = ff_filter_frame_framed(link, frame);
+    }
     if (ret < 0 && ret != li->status_out) {
         link_set_out_status(link, ret, AV_NOPTS_VALUE);
     } else {
@@ -1242,6 +1306,69 @@ static int ff_filter_activate_default(AVFilterContext *filter)
     return FFERROR_NOT_READY;
 }
 
+#if HAVE_THREADS
+/**
+ * Forward the frames output by a frame-threaded filter on its worker.
+ * If drain is set, wait for the worker to be done first.
+ */
+static int frame_thread_forward(AVFilterContext *filter, int drain)
+{
+    AVFilterLink *inlink = filter->inputs[0];
+    AVFrame *frame;
+    int ret;
+
+    while ((ret = ff_frame_thread_receive(filter, &frame, drain)) > 0) {
+        ret = filter_frame_to_link(filter->outputs[0], frame);
+        if (ret < 0)
+            break;
+    }
+    if (ret < 0 && ret != ff_link_internal(inlink)->status_out)
+        link_set_out_status(inlink, ret, AV_NOPTS_VALUE);
+    return ret;
+}
+
+static int filter_activate_frame_thread(AVFilterContext *filter)
+{
+    AVFilterLink *inlink  = filter->inputs[0];
+    AVFilterLink *outlink = filter->outputs[0];
+    FilterLinkInternal * const li_in  = ff_link_internal(inlink);
+    FilterLinkInternal * const li_out = ff_link_internal(outlink);
+    int ret, pending;
+
+    ret = frame_thread_forward(filter, 0);
+    if (ret < 0)
+        return ret;
+
+    /* While the worker is busy, only hand it more frames or forward requests
+       upstream. Anything else is done once it is finished with its frames. */
+    pending = ff_frame_thread_pending(filter);
+    if (pending && !filter->command_queue && !filter->enable &&
+        !li_out->status_in) {
+        if (samples_ready(li_in, inlink->min_samples)) {
+            if (pending >= FF_FRAME_THREAD_MAX_PENDING)
+                return FFERROR_NOT_READY;
+            return ff_filter_frame_to_filter(inlink);
+        }
+        if (!li_in->status_in) {
+            if (outlink->frame_wanted_out && !li_out->frame_blocked_in &&
+                !outlink->srcpad->request_frame)
+                return ff_request_frame_to_filter(outlink);
+            return FFERROR_NOT_READY;
+        }
+    }
+
+    ret = frame_thread_forward(filter, 1);
+    if (ret < 0)
+        return ret;
+    ret = ff_filter_activate_default(filter);
+    if (ret < 0)
+        return ret;
+    /* forward what the filter output on this thread, e.g. when flushing */
+    ret = frame_thread_forward(filter, 0);
+    return ret < 0 ? ret : 0;
+}
+#endif
+
 /*
    Filter scheduling and activation
 
@@ -1382,6 +1509,11 @@ int ff_filter_activate(AVFilterContext *filter)
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
     filter->ready = 0;
+#if HAVE_THREADS
+    if (fffilterctx(filter)->frame_thread)
+        ret = filter_activate_frame_thread(filter);
+    else
+#endif
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
     if (ret == FFERROR_NOT_READY)
@@ -1498,6 +1630,7 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
     if (av_frame_is_writable(frame))
         return 0;
     av_log(link->dst, AV_LOG_DEBUG, "Copying data in avfilter.\n");
+    ff_buffersrc_count_copy(frame);
 
     switch (link->type) {
     case AVMEDIA_TYPE_VIDEO:
@@ -403,6 +403,13 @@ unsigned avfilter_filter_pad_count(const AVFilter *filter, int is_output);
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
 
+/**
+ * Process different frames concurrently, each supported filter running on
+ * its own frame while the other filters of the graph work on other frames.
+ * Output frames may be delayed by a few frames compared to the input.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 1)
+
 /** An instance of a filter */
 struct AVFilterContext {
     const AVClass *av_class;        ///< needed for av_log() and filters common options
@@ -149,8 +149,84 @@ int ff_filter_activate(AVFilterContext *filter);
 int ff_filter_opt_parse(void *logctx, const AVClass *priv_class,
                         AVDictionary **options, const char *args);
 
+/**
+ * Account a copy of the frame's data made in order to write to it on the
+ * buffer source the frame was added to, if the data is still the one the
+ * frame was added with. Does nothing for frames from other sources.
+ */
+void ff_buffersrc_count_copy(const AVFrame *frame);
+
 int ff_graph_thread_init(FFFilterGraph *graph);
 
 void ff_graph_thread_free(FFFilterGraph *graph);
 
+/**
+ * Maximum number of frames queued for or being processed by a frame-threaded
+ * filter at any time.
+ */
+#define FF_FRAME_THREAD_MAX_PENDING 2
+
+/**
+ * Set up frame threading for the filters of a configured graph that support
+ * it. Does nothing unless AVFILTER_THREAD_FRAME is enabled for the graph.
+ */
+int ff_graph_frame_thread_init(FFFilterGraph *graph);
+
+/**
+ * Mark the frame-threaded filters that made progress on their worker since
+ * the last call as ready.
+ *
+ * @param wait if no filter made progress and a worker is still processing
+ *             frames, block until some progress is made, but only when the
+ *             graph cannot go on without it: the worker's input reached EOF
+ *             or has more frames queued than it accepts, or no source of the
+ *             graph waits for input from the caller, e.g. when the graph is
+ *             being flushed. Otherwise return at once, so that the caller
+ *             can push the next frames while the workers process the
+ *             previous ones.
+ */
+void ff_graph_frame_thread_poll(FFFilterGraph *graph, int wait);
+
+/**
+ * Queue a frame for processing on the filter's worker. Takes ownership of
+ * the frame in all cases.
+ */
+int ff_frame_thread_submit(AVFilterContext *ctx, AVFrame *frame);
+
+/**
+ * @return number of frames queued for or being processed by the worker
+ */
+int ff_frame_thread_pending(AVFilterContext *ctx);
+
+/**
+ * Store a frame output by the filter, to be forwarded on the output link by
+ * the graph thread. All the output of a frame-threaded filter goes through
+ * here, whether it runs on its worker or on the graph thread, so that it is
+ * forwarded in order. Takes ownership of the frame.
+ */
+int ff_frame_thread_output(AVFilterContext *ctx, AVFrame *frame);
+
+/**
+ * Retrieve the next frame output by the filter on its worker.
+ *
+ * @param wait if nothing is available, block until the worker outputs a frame
+ *             or has processed all the frames submitted to it
+ * @return 1 if a frame was returned, 0 if nothing is available, or the
+ *         error returned by filter_frame() on the worker, once
+ */
+int ff_frame_thread_receive(AVFilterContext *ctx, AVFrame **frame, int wait);
+
+/**
+ * Wait until the filter's worker has processed all the frames submitted to
+ * it. Must be called before the graph thread modifies or frees a link the
+ * worker may access, i.e. the filter's input and output links. Does nothing
+ * if the filter is not frame-threaded.
+ */
+void ff_frame_thread_wait(AVFilterContext *ctx);
+
+/**
+ * Wait for the filter's worker to finish and free the frame threading state.
+ */
+void ff_frame_thread_uninit(AVFilterContext *ctx);
+
 #endif /* AVFILTER_AVFILTER_INTERNAL_H */
@@ -48,6 +48,7 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, .unit = "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, F|V|A, .unit = "threads"},
         {"auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = F|V|A, .unit = "threads"},
@@ -121,6 +122,12 @@ void avfilter_graph_free(AVFilterGraph **graphp)
     if (!graph)
         return;
 
+    /* stop the frame threads first, they may still use any link */
+    if (HAVE_THREADS) {
+        for (int i = 0; i < graph->nb_filters; i++)
+            ff_frame_thread_uninit(graph->filters[i]);
+    }
+
     while (graph->nb_filters)
         avfilter_free(graph->filters[0]);
 
@@ -1244,6 +1251,12 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
 {
     int ret;
 
+    /* when reconfiguring, no worker may use the links being modified */
+    if (HAVE_THREADS) {
+        for (int i = 0; i < graphctx->nb_filters; i++)
+            ff_frame_thread_wait(graphctx->filters[i]);
+    }
+
     if ((ret = graph_check_validity(graphctx, log_ctx)))
         return ret;
     if ((ret = graph_config_formats(graphctx, log_ctx)))
@@ -1254,6 +1267,9 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if (HAVE_THREADS &&
+        (ret = ff_graph_frame_thread_init(fffiltergraph(graphctx))) < 0)
+        return ret;
 
     return 0;
 }
@@ -1417,16 +1433,31 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+static AVFilterContext *graph_next_filter(AVFilterGraph *graph)
+{
+    AVFilterContext *filter = graph->filters[0];
+
+    for (unsigned i = 1; i < graph->nb_filters; i++)
+        if (graph->filters[i]->ready > filter->ready)
+            filter = graph->filters[i];
+    return filter;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
+    FFFilterGraph *graphi = fffiltergraph(graph);
     AVFilterContext *filter;
-    unsigned i;
 
     av_assert0(graph->nb_filters);
-    filter = graph->filters[0];
-    for (i = 1; i < graph->nb_filters; i++)
-        if (graph->filters[i]->ready > filter->ready)
-            filter = graph->filters[i];
+    if (HAVE_THREADS)
+        ff_graph_frame_thread_poll(graphi, 0);
+    filter = graph_next_filter(graph);
+    if (!filter->ready && HAVE_THREADS) {
+        /* nothing to do until a frame thread catches up; this only blocks
+           at EOF, on flush or when a worker holds up its input */
+        ff_graph_frame_thread_poll(graphi, 1);
+        filter = graph_next_filter(graph);
+    }
     if (!filter->ready)
         return AVERROR(EAGAIN);
     return ff_filter_activate(filter);
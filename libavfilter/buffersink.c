@@ -72,6 +72,8 @@ int attribute_align_arg av_buffersink_get_frame(AVFilterContext *ctx, AVFrame *f
 
 static int return_or_keep_frame(BufferSinkContext *buf, AVFrame *out, AVFrame *in, int flags)
 {
+    /* the buffer source tag is only valid inside the graph */
+    av_buffer_unref(&in->private_ref);
     if ((flags & AV_BUFFERSINK_FLAG_PEEK)) {
         buf->peeked_frame = in;
         return out ? av_frame_ref(out, in) : 0;
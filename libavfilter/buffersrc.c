@@ -24,6 +24,7 @@
  */
 
 #include <float.h>
+#include <stdatomic.h>
 
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
@@ -36,6 +37,7 @@
 #include "libavutil/timestamp.h"
 #include "audio.h"
 #include "avfilter.h"
+#include "avfilter_internal.h"
 #include "buffersrc.h"
 #include "filters.h"
 #include "formats.h"
@@ -67,8 +69,18 @@ typedef struct BufferSourceContext {
     int eof;
     int64_t last_pts;
     int link_delta, prev_delta;
+
+    /* tags attached to the frames as private_ref, see ff_buffersrc_count_copy() */
+    AVBufferPool *tag_pool;
+    atomic_uint_least64_t nb_copies;
 } BufferSourceContext;
 
+typedef struct BufferSrcTag {
+    /* the data the frame was added with */
+    const AVBuffer        *data;
+    atomic_uint_least64_t *nb_copies;
+} BufferSrcTag;
+
 #define CHECK_VIDEO_PARAM_CHANGE(s, c, width, height, format, csp, range, pts)\
     c->link_delta = c->w != width || c->h != height || c->pix_fmt != format ||\
                     c->color_space != csp || c->color_range != range;\
@@ -262,6 +274,27 @@ FF_ENABLE_DEPRECATION_WARNINGS
     if (copy->color_range == AVCOL_RANGE_UNSPECIFIED)
         copy->color_range = ctx->outputs[0]->color_range;
 
+    av_buffer_unref(&copy->private_ref);
+    if (copy->buf[0]) {
+        BufferSrcTag *tag;
+
+        if (!s->tag_pool) {
+            s->tag_pool = av_buffer_pool_init(sizeof(*tag), NULL);
+            if (!s->tag_pool) {
+                av_frame_free(&copy);
+                return AVERROR(ENOMEM);
+            }
+        }
+        copy->private_ref = av_buffer_pool_get(s->tag_pool);
+        if (!copy->private_ref) {
+            av_frame_free(&copy);
+            return AVERROR(ENOMEM);
+        }
+        tag            = (BufferSrcTag *)copy->private_ref->data;
+        tag->data      = copy->buf[0]->buffer;
+        tag->nb_copies = &s->nb_copies;
+    }
+
     ret = ff_filter_frame(ctx->outputs[0], copy);
     if (ret < 0)
         return ret;
@@ -315,6 +348,23 @@ unsigned av_buffersrc_get_nb_failed_requests(AVFilterContext *buffer_src)
     return ((BufferSourceContext *)buffer_src->priv)->nb_failed_requests;
 }
 
+uint64_t av_buffersrc_get_nb_copies(AVFilterContext *buffer_src)
+{
+    return atomic_load(&((BufferSourceContext *)buffer_src->priv)->nb_copies);
+}
+
+void ff_buffersrc_count_copy(const AVFrame *frame)
+{
+    const BufferSrcTag *tag;
+
+    if (!frame->private_ref || frame->private_ref->size != sizeof(*tag))
+        return;
+    tag = (const BufferSrcTag *)frame->private_ref->data;
+    /* copies of copies were not caused by the caller sharing the frame */
+    if (frame->buf[0] && frame->buf[0]->buffer == tag->data)
+        atomic_fetch_add_explicit(tag->nb_copies, 1, memory_order_relaxed);
+}
+
 #define OFFSET(x) offsetof(BufferSourceContext, x)
 #define A AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_AUDIO_PARAM
 #define V AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
@@ -427,6 +477,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     BufferSourceContext *s = ctx->priv;
     av_buffer_unref(&s->hw_frames_ctx);
+    av_buffer_pool_uninit(&s->tag_pool);
     av_channel_layout_uninit(&s->ch_layout);
 }
 
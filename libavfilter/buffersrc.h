@@ -63,6 +63,15 @@ enum {
  */
 unsigned av_buffersrc_get_nb_failed_requests(AVFilterContext *buffer_src);
 
+/**
+ * Get the number of frames added to this source whose data had to be copied
+ * inside the filtergraph, because a filter writes to it and the data was
+ * still referenced elsewhere, e.g. by the caller or by another graph.
+ *
+ * This function is thread-safe.
+ */
+uint64_t av_buffersrc_get_nb_copies(AVFilterContext *buffer_src);
+
 /**
  * This structure contains the parameters describing the frames that will be
  * passed to this filter.
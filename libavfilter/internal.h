@@ -124,6 +124,9 @@ typedef struct FFFilterContext {
     // 1 when avfilter_init_*() was successfully called on this filter
     // 0 otherwise
     int initialized;
+
+    // non-NULL when the filter runs on the graph's frame threads
+    struct FrameThreadFilter *frame_thread;
 } FFFilterContext;
 
 static inline FFFilterContext *fffilterctx(AVFilterContext *ctx)
@@ -350,6 +353,20 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame);
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter supports frame threading: its filter_frame() callback may run
+ * on a worker thread while the rest of the graph processes other frames.
+ *
+ * Such a filter must have a single input and a single output, and its
+ * filter_frame() must only access its private context, the frame and the
+ * output link through ff_get_video_buffer()/ff_get_audio_buffer() and
+ * ff_filter_frame(). In particular it must not use the input link counters
+ * (frame_count_out, current_pts, ...), which keep moving as further frames
+ * are queued for it. Frames are passed to filter_frame() in order and never
+ * concurrently for the same filter instance.
+ */
+#define FF_FILTER_FLAG_FRAME_THREADS (1 << 1)
+
 /**
  * Run one round of processing on a filter graph.
  */
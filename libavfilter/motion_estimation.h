@@ -23,6 +23,9 @@
 
 #include <stdint.h>
 
+#include "libavutil/common.h"
+#include "libavutil/pixelutils.h"
+
 #define AV_ME_METHOD_ESA        1
 #define AV_ME_METHOD_TSS        2
 #define AV_ME_METHOD_TDLS       3
@@ -38,6 +41,10 @@ typedef struct AVMotionEstPredictor {
     int nb;
 } AVMotionEstPredictor;
 
+/**
+ * The search functions only read the context, but the predictor fields are
+ * set per block by the caller: concurrent searches need a copy each.
+ */
 typedef struct AVMotionEstContext {
     uint8_t *data_cur, *data_ref;
     int linesize;
@@ -57,10 +64,23 @@ typedef struct AVMotionEstContext {
     int pred_y;     ///< median predictor y
     AVMotionEstPredictor preds[2];
 
+    av_pixelutils_sad_fn sad[6];    ///< SAD functions indexed by log2 of the block size
+
     uint64_t (*get_cost)(struct AVMotionEstContext *me_ctx, int x_mb, int y_mb,
                          int mv_x, int mv_y);
 } AVMotionEstContext;
 
+/**
+ * Get the optimized SAD function of a size x size block, or NULL if there is
+ * none and the caller has to use a C loop.
+ */
+static inline av_pixelutils_sad_fn ff_me_get_sad_fn(const AVMotionEstContext *me_ctx, int size)
+{
+    if (size <= 0 || size > 32 || (size & (size - 1)))
+        return NULL;
+    return me_ctx->sad[av_log2(size)];
+}
+
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max);
 
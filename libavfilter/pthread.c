@@ -24,12 +24,18 @@
 #include <stddef.h>
 
 #include "libavutil/error.h"
+#include "libavutil/executor.h"
+#include "libavutil/fifo.h"
+#include "libavutil/frame.h"
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
 #include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
 
 #include "avfilter.h"
 #include "avfilter_internal.h"
+#include "filters.h"
+#include "internal.h"
 
 typedef struct ThreadContext {
     AVFilterGraph *graph;
@@ -40,8 +46,31 @@ typedef struct ThreadContext {
     AVFilterContext *ctx;
     void *arg;
     int   *rets;
+
+    /* serializes execute() calls made from concurrent frame threads */
+    AVMutex execute_lock;
+
+    /* frame threading */
+    AVExecutor *frame_executor;
+    AVMutex     frame_lock;
+    AVCond      frame_cond;
 } ThreadContext;
 
+typedef struct FrameThreadFilter {
+    AVTask task;
+    ThreadContext   *c;
+    AVFilterContext *ctx;
+
+    /* the fields below are protected by ThreadContext.frame_lock */
+    AVFifo *in;
+    AVFifo *out;
+    int nb_pending;
+    int running;
+    int progress;
+    int error;
+    int error_reported;
+} FrameThreadFilter;
+
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
     ThreadContext *c = priv;
@@ -62,12 +91,14 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+    ff_mutex_lock(&c->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    ff_mutex_unlock(&c->execute_lock);
     return 0;
 }
 
@@ -82,6 +113,7 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
 int ff_graph_thread_init(FFFilterGraph *graphi)
 {
     AVFilterGraph *graph = &graphi->p;
+    ThreadContext *c;
     int ret;
 
     if (graph->nb_threads == 1) {
@@ -102,14 +134,347 @@ int ff_graph_thread_init(FFFilterGraph *graphi)
     }
     graph->nb_threads = ret;
 
+    c = graphi->thread;
+    if ((ret = ff_mutex_init(&c->execute_lock, NULL)))
+        goto fail;
+    if ((ret = ff_mutex_init(&c->frame_lock, NULL))) {
+        ff_mutex_destroy(&c->execute_lock);
+        goto fail;
+    }
+    if ((ret = ff_cond_init(&c->frame_cond, NULL))) {
+        ff_mutex_destroy(&c->execute_lock);
+        ff_mutex_destroy(&c->frame_lock);
+        goto fail;
+    }
+
     graphi->thread_execute = thread_execute;
 
     return 0;
+
+fail:
+    slice_thread_uninit(c);
+    av_freep(&graphi->thread);
+    graph->thread_type = 0;
+    graph->nb_threads  = 1;
+    return AVERROR(ret);
 }
 
 void ff_graph_thread_free(FFFilterGraph *graph)
 {
-    if (graph->thread)
-        slice_thread_uninit(graph->thread);
+    ThreadContext *c = graph->thread;
+
+    if (c) {
+        av_executor_free(&c->frame_executor);
+        slice_thread_uninit(c);
+        ff_mutex_destroy(&c->execute_lock);
+        ff_mutex_destroy(&c->frame_lock);
+        ff_cond_destroy(&c->frame_cond);
+    }
     av_freep(&graph->thread);
 }
+
+static int frame_thread_priority_higher(const AVTask *a, const AVTask *b)
+{
+    /* run the filters in the order they were submitted */
+    return 1;
+}
+
+static int frame_thread_ready(const AVTask *t, void *user_data)
+{
+    return 1;
+}
+
+static int frame_thread_run(AVTask *t, void *local_context, void *user_data)
+{
+    FrameThreadFilter *ft = (FrameThreadFilter*)t;
+    ThreadContext      *c = user_data;
+    AVFilterLink  *inlink = ft->ctx->inputs[0];
+    AVFrame        *frame;
+
+    ff_mutex_lock(&c->frame_lock);
+    while (av_fifo_read(ft->in, &frame, 1) >= 0) {
+        int ret = ft->error;
+
+        ff_mutex_unlock(&c->frame_lock);
+
+        if (ret >= 0)
+            ret = inlink->dstpad->filter_frame(inlink, frame);
+        else
+            av_frame_free(&frame);
+
+        ff_mutex_lock(&c->frame_lock);
+        if (ret < 0 && ft->error >= 0)
+            ft->error = ret;
+        ft->nb_pending--;
+        ft->progress = 1;
+        ff_cond_broadcast(&c->frame_cond);
+    }
+    ft->running = 0;
+    ff_cond_broadcast(&c->frame_cond);
+    ff_mutex_unlock(&c->frame_lock);
+
+    return 0;
+}
+
+static int frame_thread_supported(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink, *outlink;
+
+    if (!(ctx->thread_type & AVFILTER_THREAD_FRAME) ||
+        ctx->nb_inputs != 1 || ctx->nb_outputs != 1 || ctx->filter->activate)
+        return 0;
+
+    inlink  = ctx->inputs[0];
+    outlink = ctx->outputs[0];
+
+    /* Buffers must be allocated from the output link's own pool, which no
+     * other filter may use concurrently. */
+    return inlink->dstpad->filter_frame &&
+           !(inlink->dstpad->flags & AVFILTERPAD_FLAG_NEEDS_WRITABLE) &&
+           !inlink->dstpad->get_buffer.video &&
+           !outlink->dstpad->get_buffer.video &&
+           !outlink->hw_frames_ctx;
+}
+
+int ff_graph_frame_thread_init(FFFilterGraph *graphi)
+{
+    AVFilterGraph *graph = &graphi->p;
+    ThreadContext     *c = graphi->thread;
+    int nb_filters = 0;
+
+    if (!c || graphi->thread_execute != thread_execute ||
+        !(graph->thread_type & AVFILTER_THREAD_FRAME))
+        return 0;
+
+    for (int i = 0; i < graph->nb_filters; i++)
+        nb_filters += frame_thread_supported(graph->filters[i]);
+    if (!nb_filters)
+        return 0;
+
+    if (!c->frame_executor) {
+        const AVTaskCallbacks callbacks = {
+            .user_data       = c,
+            .priority_higher = frame_thread_priority_higher,
+            .ready           = frame_thread_ready,
+            .run             = frame_thread_run,
+        };
+
+        c->frame_executor = av_executor_alloc(&callbacks,
+                                              FFMIN(nb_filters, graph->nb_threads));
+        if (!c->frame_executor)
+            return AVERROR(ENOMEM);
+    }
+
+    for (int i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *ctx = graph->filters[i];
+        FFFilterContext *ctxi = fffilterctx(ctx);
+        FrameThreadFilter *ft;
+
+        if (ctxi->frame_thread || !frame_thread_supported(ctx))
+            continue;
+
+        ft = av_mallocz(sizeof(*ft));
+        if (!ft)
+            return AVERROR(ENOMEM);
+        ctxi->frame_thread = ft;
+
+        ft->c   = c;
+        ft->ctx = ctx;
+        ft->in  = av_fifo_alloc2(FF_FRAME_THREAD_MAX_PENDING, sizeof(AVFrame*), 0);
+        ft->out = av_fifo_alloc2(FF_FRAME_THREAD_MAX_PENDING, sizeof(AVFrame*),
+                                 AV_FIFO_FLAG_AUTO_GROW);
+        if (!ft->in || !ft->out)
+            return AVERROR(ENOMEM);
+
+        av_log(ctx, AV_LOG_DEBUG, "Using frame threading\n");
+    }
+
+    return 0;
+}
+
+/* whether a source of the graph was asked for a frame it cannot produce by
+ * itself, i.e. the caller of the graph can still push more input */
+static int graph_input_wanted(AVFilterGraph *graph)
+{
+    for (int i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *ctx = graph->filters[i];
+
+        if (ctx->nb_inputs || ctx->ready)
+            continue;
+
+        for (int j = 0; j < ctx->nb_outputs; j++) {
+            AVFilterLink *link = ctx->outputs[j];
+
+            if (link && link->frame_wanted_out && !ff_link_internal(link)->status_in)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+void ff_graph_frame_thread_poll(FFFilterGraph *graphi, int wait)
+{
+    AVFilterGraph *graph = &graphi->p;
+    ThreadContext     *c = graphi->thread;
+    int input_wanted;
+
+    if (!c || !c->frame_executor)
+        return;
+
+    input_wanted = wait && graph_input_wanted(graph);
+
+    ff_mutex_lock(&c->frame_lock);
+    while (1) {
+        int progress = 0, busy = 0, stalled = 0;
+
+        for (int i = 0; i < graph->nb_filters; i++) {
+            AVFilterContext *ctx = graph->filters[i];
+            FrameThreadFilter *ft = fffilterctx(ctx)->frame_thread;
+
+            if (!ft)
+                continue;
+
+            if (ft->progress) {
+                ft->progress = 0;
+                ff_filter_set_ready(ctx, 300);
+                progress = 1;
+            } else if (ft->nb_pending) {
+                AVFilterLink *inlink = ctx->inputs[0];
+
+                busy = 1;
+                /* nothing more can be submitted before the worker is done
+                 * with a frame */
+                if (ff_link_internal(inlink)->status_in ||
+                    (ft->nb_pending >= FF_FRAME_THREAD_MAX_PENDING &&
+                     ff_inlink_queued_frames(inlink)))
+                    stalled = 1;
+            }
+        }
+
+        /* While the graph waits for more input from the caller, return and
+         * let the workers run in parallel with it, unless one of them holds
+         * up its input. */
+        if (progress || !busy || !wait || (input_wanted && !stalled))
+            break;
+
+        ff_cond_wait(&c->frame_cond, &c->frame_lock);
+    }
+    ff_mutex_unlock(&c->frame_lock);
+}
+
+int ff_frame_thread_submit(AVFilterContext *ctx, AVFrame *frame)
+{
+    FrameThreadFilter *ft = fffilterctx(ctx)->frame_thread;
+    ThreadContext      *c = ft->c;
+    int ret, start = 0;
+
+    ff_mutex_lock(&c->frame_lock);
+    ret = av_fifo_write(ft->in, &frame, 1);
+    if (ret >= 0) {
+        ft->nb_pending++;
+        if (!ft->running)
+            start = ft->running = 1;
+    }
+    ff_mutex_unlock(&c->frame_lock);
+
+    if (ret < 0) {
+        av_frame_free(&frame);
+        return ret;
+    }
+
+    if (start)
+        av_executor_execute(c->frame_executor, &ft->task);
+
+    return 0;
+}
+
+int ff_frame_thread_pending(AVFilterContext *ctx)
+{
+    FrameThreadFilter *ft = fffilterctx(ctx)->frame_thread;
+    int nb_pending;
+
+    ff_mutex_lock(&ft->c->frame_lock);
+    nb_pending = ft->nb_pending;
+    ff_mutex_unlock(&ft->c->frame_lock);
+
+    return nb_pending;
+}
+
+int ff_frame_thread_output(AVFilterContext *ctx, AVFrame *frame)
+{
+    FrameThreadFilter *ft = fffilterctx(ctx)->frame_thread;
+    ThreadContext      *c = ft->c;
+    int ret;
+
+    ff_mutex_lock(&c->frame_lock);
+    ret = av_fifo_write(ft->out, &frame, 1);
+    ft->progress = 1;
+    ff_cond_broadcast(&c->frame_cond);
+    ff_mutex_unlock(&c->frame_lock);
+
+    if (ret < 0)
+        av_frame_free(&frame);
+
+    return ret;
+}
+
+int ff_frame_thread_receive(AVFilterContext *ctx, AVFrame **frame, int wait)
+{
+    FrameThreadFilter *ft = fffilterctx(ctx)->frame_thread;
+    ThreadContext      *c = ft->c;
+    int ret = 0;
+
+    ff_mutex_lock(&c->frame_lock);
+    while (wait && ft->nb_pending && !av_fifo_can_read(ft->out))
+        ff_cond_wait(&c->frame_cond, &c->frame_lock);
+
+    if (av_fifo_read(ft->out, frame, 1) >= 0) {
+        ret = 1;
+    } else if (ft->error < 0 && !ft->error_reported) {
+        ft->error_reported = 1;
+        ret = ft->error;
+    }
+    ff_mutex_unlock(&c->frame_lock);
+
+    return ret;
+}
+
+void ff_frame_thread_wait(AVFilterContext *ctx)
+{
+    FrameThreadFilter *ft = fffilterctx(ctx)->frame_thread;
+
+    /* only called from the graph thread, a worker never waits for itself */
+    if (!ft)
+        return;
+
+    ff_mutex_lock(&ft->c->frame_lock);
+    while (ft->running)
+        ff_cond_wait(&ft->c->frame_cond, &ft->c->frame_lock);
+    ff_mutex_unlock(&ft->c->frame_lock);
+}
+
+void ff_frame_thread_uninit(AVFilterContext *ctx)
+{
+    FFFilterContext *ctxi = fffilterctx(ctx);
+    FrameThreadFilter *ft = ctxi->frame_thread;
+    AVFrame *frame;
+
+    if (!ft)
+        return;
+
+    /* drop the frames the worker has not started processing yet */
+    ff_mutex_lock(&ft->c->frame_lock);
+    if (ft->error >= 0)
+        ft->error = AVERROR_EXIT;
+    while (ft->running)
+        ff_cond_wait(&ft->c->frame_cond, &ft->c->frame_lock);
+    ff_mutex_unlock(&ft->c->frame_lock);
+
+    if (ft->out) {
+        while (av_fifo_read(ft->out, &frame, 1) >= 0)
+            av_frame_free(&frame);
+    }
+    av_fifo_freep2(&ft->in);
+    av_fifo_freep2(&ft->out);
+    av_freep(&ctxi->frame_thread);
+}
@@ -124,7 +124,8 @@ void ff_get_matrix(
 
 int ff_affine_transform(const uint8_t *src, uint8_t *dst,
                         int src_stride, int dst_stride,
-                        int width, int height, const float *matrix,
+                        int width, int height,
+                        int slice_start, int slice_end, const float *matrix,
                         enum InterpolateMethod interpolate,
                         enum FillMethod fill)
 {
@@ -147,7 +148,7 @@ int ff_affine_transform(const uint8_t *src, uint8_t *dst,
             return AVERROR(EINVAL);
     }
 
-    for (y = 0; y < height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for(x = 0; x < width; x++) {
             x_s = x * matrix[0] + y * matrix[1] + matrix[2];
             y_s = x * matrix[3] + y * matrix[4] + matrix[5];
@@ -86,7 +86,9 @@ void ff_get_matrix(
 /**
  * Do an affine transformation with the given interpolation method. This
  * multiplies each vector [x,y,1] by the matrix and then interpolates to
- * get the final value.
+ * get the final value. Only the destination rows in [slice_start, slice_end)
+ * are written, so disjoint slices of the same image may be transformed
+ * concurrently.
  *
  * @param src         source image
  * @param dst         destination image
@@ -94,6 +96,8 @@ void ff_get_matrix(
  * @param dst_stride  destination image line size in bytes
  * @param width       image width in pixels
  * @param height      image height in pixels
+ * @param slice_start first destination row to transform
+ * @param slice_end   row after the last destination row to transform
  * @param matrix      9-item affine transformation matrix
  * @param interpolate pixel interpolation method
  * @param fill        edge fill method
@@ -101,7 +105,8 @@ void ff_get_matrix(
  */
 int ff_affine_transform(const uint8_t *src, uint8_t *dst,
                         int src_stride, int dst_stride,
-                        int width, int height, const float *matrix,
+                        int width, int height,
+                        int slice_start, int slice_end, const float *matrix,
                         enum InterpolateMethod interpolate,
                         enum FillMethod fill);
 
@@ -91,6 +91,8 @@ typedef struct DeshakeContext {
     int counts[2*MAX_R+1][2*MAX_R+1]; ///< Scratch buffer for motion search
     double *angles;            ///< Scratch buffer for block angles
     unsigned angles_size;
+    IntMotionVector *mvs;      ///< Scratch buffer for block motion vectors
+    unsigned mvs_size;
     AVFrame *ref;              ///< Previous frame
     int rx;                    ///< Maximum horizontal shift
     int ry;                    ///< Maximum vertical shift
@@ -284,13 +286,56 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+typedef struct MotionThreadData {
+    uint8_t *src1, *src2;
+    int stride;
+    int nb_blocks_x, nb_blocks_y;
+    IntMotionVector *mvs;      ///< Motion vector of each block, -1/-1 if unusable
+} MotionThreadData;
+
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y;
+    DeshakeContext *deshake = ctx->priv;
+    const MotionThreadData *td = arg;
+    const int start = (td->nb_blocks_y *  jobnr     ) / nb_jobs;
+    const int end   = (td->nb_blocks_y * (jobnr + 1)) / nb_jobs;
     IntMotionVector mv = {0, 0};
+
+    for (int by = start; by < end; by++) {
+        const int y = deshake->ry + by * deshake->blocksize * 2;
+
+        for (int bx = 0; bx < td->nb_blocks_x; bx++) {
+            // We use a width of 16 here to match the sad function
+            const int x = deshake->rx + bx * 16;
+            IntMotionVector *block_mv = &td->mvs[by * td->nb_blocks_x + bx];
+
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast) {
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, &mv);
+                *block_mv = mv;
+            } else {
+                block_mv->x = block_mv->y = -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Find the estimated global motion for a scene given the most likely shift
+ * for each block in the frame. The global motion is estimated to be the
+ * same as the motion from most blocks in the frame, so if most blocks
+ * move one pixel to the right and two pixels down, this would yield a
+ * motion vector (1, -2).
+ */
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
+{
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData td;
+    int x, y, i, nb_jobs;
     int count_max_value = 0;
-    int contrast;
 
     int pos;
     int center_x = 0, center_y = 0;
@@ -305,26 +350,44 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    td.src1 = src1;
+    td.src2 = src2;
+    td.stride = stride;
+    td.nb_blocks_x = td.nb_blocks_y = 0;
+    for (x = deshake->rx; x < width - deshake->rx - 16; x += 16)
+        td.nb_blocks_x++;
+    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2)
+        td.nb_blocks_y++;
+
+    av_fast_malloc(&deshake->mvs, &deshake->mvs_size,
+                   td.nb_blocks_x * td.nb_blocks_y * sizeof(*deshake->mvs));
+    if (!deshake->mvs)
+        return AVERROR(ENOMEM);
+    td.mvs = deshake->mvs;
+
+    // Find motion for every block. Without a coarse search step the smart
+    // search starts from the vector of the previous block, so it has to run
+    // in a single job.
+    nb_jobs = FFMIN(ff_filter_get_nb_threads(ctx), td.nb_blocks_y);
+    if (deshake->search == SMART_EXHAUSTIVE && (!deshake->rx || !deshake->ry))
+        nb_jobs = FFMIN(nb_jobs, 1);
+    if (nb_jobs > 0)
+        ff_filter_execute(ctx, find_motion_slice, &td, NULL, nb_jobs);
+
+    // Store the motion vectors in the counts, in raster order
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
-            }
+    for (i = 0; i < td.nb_blocks_x * td.nb_blocks_y; i++) {
+        IntMotionVector *mv = &td.mvs[i];
+
+        x = deshake->rx + (i % td.nb_blocks_x) * 16;
+        y = deshake->ry + (i / td.nb_blocks_x) * deshake->blocksize * 2;
+        if (mv->x != -1 && mv->y != -1) {
+            deshake->counts[mv->x + deshake->rx][mv->y + deshake->ry] += 1;
+            if (x > deshake->rx && y > deshake->ry)
+                deshake->angles[pos++] = block_angle(x, y, 0, 0, mv);
+
+            center_x += mv->x;
+            center_y += mv->y;
         }
     }
 
@@ -362,33 +425,62 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
 }
 
-static int deshake_transform_c(AVFilterContext *ctx,
-                                    int width, int height, int cw, int ch,
-                                    const float *matrix_y, const float *matrix_uv,
-                                    enum InterpolateMethod interpolate,
-                                    enum FillMethod fill, AVFrame *in, AVFrame *out)
-{
-    int i = 0, ret = 0;
-    const float *matrixs[3];
+typedef struct TransformThreadData {
+    const float *matrix[3];
     int plane_w[3], plane_h[3];
-    matrixs[0] = matrix_y;
-    matrixs[1] =  matrixs[2] = matrix_uv;
-    plane_w[0] = width;
-    plane_w[1] = plane_w[2] = cw;
-    plane_h[0] = height;
-    plane_h[1] = plane_h[2] = ch;
+    enum InterpolateMethod interpolate;
+    enum FillMethod fill;
+    AVFrame *in, *out;
+} TransformThreadData;
+
+static int transform_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const TransformThreadData *td = arg;
+    int i, ret;
 
     for (i = 0; i < 3; i++) {
+        const int slice_start = (td->plane_h[i] *  jobnr     ) / nb_jobs;
+        const int slice_end   = (td->plane_h[i] * (jobnr + 1)) / nb_jobs;
+
         // Transform the luma and chroma planes
-        ret = ff_affine_transform(in->data[i], out->data[i], in->linesize[i],
-                                  out->linesize[i], plane_w[i], plane_h[i],
-                                  matrixs[i], interpolate, fill);
+        ret = ff_affine_transform(td->in->data[i], td->out->data[i], td->in->linesize[i],
+                                  td->out->linesize[i], td->plane_w[i], td->plane_h[i],
+                                  slice_start, slice_end,
+                                  td->matrix[i], td->interpolate, td->fill);
         if (ret < 0)
             return ret;
     }
-    return ret;
+    return 0;
+}
+
+static int deshake_transform_c(AVFilterContext *ctx,
+                                    int width, int height, int cw, int ch,
+                                    const float *matrix_y, const float *matrix_uv,
+                                    enum InterpolateMethod interpolate,
+                                    enum FillMethod fill, AVFrame *in, AVFrame *out)
+{
+    TransformThreadData td;
+
+    if ((unsigned)interpolate >= INTERPOLATE_COUNT)
+        return AVERROR(EINVAL);
+
+    td.matrix[0] = matrix_y;
+    td.matrix[1] = td.matrix[2] = matrix_uv;
+    td.plane_w[0] = width;
+    td.plane_w[1] = td.plane_w[2] = cw;
+    td.plane_h[0] = height;
+    td.plane_h[1] = td.plane_h[2] = ch;
+    td.interpolate = interpolate;
+    td.fill = fill;
+    td.in  = in;
+    td.out = out;
+
+    ff_filter_execute(ctx, transform_slice, &td, NULL,
+                      FFMIN(ch, ff_filter_get_nb_threads(ctx)));
+    return 0;
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -449,6 +541,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->mvs);
+    deshake->mvs_size = 0;
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -483,7 +577,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -500,7 +594,11 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+    }
+    if (ret < 0) {
+        av_frame_free(&in);
+        goto fail;
     }
 
 
@@ -597,4 +695,5 @@ const AVFilter ff_vf_deshake = {
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_PIXFMTS_ARRAY(pix_fmts),
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
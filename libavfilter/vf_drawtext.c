@@ -193,6 +193,7 @@ typedef struct GlyphInfo {
     int y;                          ///< the y position of the glyph
     int shift_x64;                  ///< the horizontal shift of the glyph in 26.6 units
     int shift_y64;                  ///< the vertical shift of the glyph in 26.6 units
+    struct Glyph *glyph;            ///< the cached glyph, resolved during layout
 } GlyphInfo;
 
 /** Information about a single line of text */
@@ -1266,15 +1267,21 @@ static void update_alpha(DrawTextContext *s)
         s->alpha = 256 * alpha;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       FFDrawColor *color,
-                       TextMetrics *metrics,
-                       int x, int y, int borderw)
+/**
+ * Blend the glyphs of all text lines into the rows [y_start, y_end) of frame.
+ * dst points to row y_start of each plane; y_start must be aligned to the
+ * vertical chroma subsampling so that no chroma row is shared between slices.
+ */
+static void draw_glyphs(DrawTextContext *s, AVFrame *frame, uint8_t *dst[4],
+                        int y_start, int y_end,
+                        FFDrawColor *color,
+                        TextMetrics *metrics,
+                        int x, int y, int borderw)
 {
     int g, l, x1, y1, w1, h1, idx;
     int dx = 0, dy = 0, pdx = 0;
     GlyphInfo *info;
-    Glyph dummy = { 0 }, *glyph;
+    Glyph *glyph;
     FT_Bitmap bitmap;
     FT_BitmapGlyph b_glyph;
     uint8_t j_left = 0, j_right = 0, j_top = 0, j_bottom = 0;
@@ -1292,25 +1299,16 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
         offset_y = s->box_height - metrics->height;
     }
 
-    if ((!j_left || j_right) && !s->tab_warning_printed && s->tab_count > 0) {
-        s->tab_warning_printed = 1;
-        av_log(s, AV_LOG_WARNING, "Tab characters are only supported with left horizontal alignment\n");
-    }
-
     clip_x = FFMIN(metrics->rect_x + s->box_width + s->bb_right, frame->width);
     clip_y = FFMIN(metrics->rect_y + s->box_height + s->bb_bottom, frame->height);
+    clip_y = FFMIN(clip_y, y_end);
 
     for (l = 0; l < s->line_count; ++l) {
         TextLine *line = &s->lines[l];
         line_w = POS_CEIL(line->width64, 64);
         for (g = 0; g < line->hb_data.glyph_count; ++g) {
             info = &line->glyphs[g];
-            dummy.fontsize = s->fontsize;
-            dummy.code = info->code;
-            glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
-            if (!glyph) {
-                return AVERROR(EINVAL);
-            }
+            glyph = info->glyph;
 
             idx = get_subpixel_idx(info->shift_x64, info->shift_y64);
             b_glyph = borderw ? glyph->border_bglyph[idx] : glyph->bglyph[idx];
@@ -1338,7 +1336,8 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
             }
 
             // check if the glyph is empty or out of the clipping region
-            if (dx >= w1 || dy >= h1 || x1 >= clip_x || y1 >= clip_y) {
+            if (dx >= w1 || dy >= h1 || x1 >= clip_x || y1 >= clip_y ||
+                y1 + h1 - dy <= y_start) {
                 continue;
             }
 
@@ -1346,10 +1345,61 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
             w1 = FFMIN(clip_x - x1, w1 - dx);
             h1 = FFMIN(clip_y - y1, h1 - dy);
 
-            ff_blend_mask(&s->dc, color, frame->data, frame->linesize, clip_x, clip_y,
-                bitmap.buffer + pdx, bitmap.pitch, w1, h1, 3, 0, x1, y1);
+            ff_blend_mask(&s->dc, color, dst, frame->linesize, clip_x, clip_y - y_start,
+                bitmap.buffer + pdx, bitmap.pitch, w1, h1, 3, 0, x1, y1 - y_start);
         }
     }
+}
+
+typedef struct ThreadData {
+    AVFrame *frame;
+    TextMetrics *metrics;
+    FFDrawColor *fontcolor;
+    FFDrawColor *shadowcolor;
+    FFDrawColor *bordercolor;
+    FFDrawColor *boxcolor;
+    int y_min, y_max;
+} ThreadData;
+
+static int draw_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    TextMetrics *metrics = td->metrics;
+    const int align = 1 << s->dc.vsub_max;
+    const int h = td->y_max - td->y_min;
+    const int y_start = FFMIN(td->y_min + FFALIGN(h *  jobnr      / nb_jobs, align), td->y_max);
+    const int y_end   = FFMIN(td->y_min + FFALIGN(h * (jobnr + 1) / nb_jobs, align), td->y_max);
+    uint8_t *dst[4] = { NULL };
+
+    if (y_start >= y_end)
+        return 0;
+
+    for (int i = 0; i < s->dc.nb_planes; i++)
+        dst[i] = frame->data[i] + (y_start >> s->dc.vsub[i]) * frame->linesize[i];
+
+    /* draw box */
+    if (s->draw_box) {
+        int rec_x = metrics->rect_x - s->bb_left;
+        int rec_y = metrics->rect_y - s->bb_top;
+        int rec_width = s->box_width + s->bb_right + s->bb_left;
+        int rec_height = s->box_height + s->bb_bottom + s->bb_top;
+        ff_blend_rectangle(&s->dc, td->boxcolor,
+            dst, frame->linesize, frame->width, y_end - y_start,
+            rec_x, rec_y - y_start, rec_width, rec_height);
+    }
+
+    if (s->shadowx || s->shadowy)
+        draw_glyphs(s, frame, dst, y_start, y_end, td->shadowcolor, metrics,
+                    s->shadowx, s->shadowy, s->borderw);
+
+    if (s->borderw)
+        draw_glyphs(s, frame, dst, y_start, y_end, td->bordercolor, metrics,
+                    0, 0, s->borderw);
+
+    draw_glyphs(s, frame, dst, y_start, y_end, td->fontcolor, metrics,
+                0, 0, 0);
 
     return 0;
 }
@@ -1568,7 +1618,6 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
 
     int width = frame->width;
     int height = frame->height;
-    int rec_x = 0, rec_y = 0, rec_width = 0, rec_height = 0;
     int is_outside = 0;
     int last_tab_idx = 0;
 
@@ -1737,6 +1786,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
                 return ret;
             }
             g_info->code = hb->glyph_info[t].codepoint;
+            g_info->glyph = glyph;
             g_info->x = (x64 + true_x) >> 6;
             g_info->y = ((y64 + true_y) >> 6) + (shift_y64 > 0 ? 1 : 0);
             g_info->shift_x64 = shift_x64;
@@ -1782,35 +1832,30 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
                     metrics.rect_y + s->box_height + s->bb_bottom <= 0;
 
     if (!is_outside) {
-        /* draw box */
-        if (s->draw_box) {
-            rec_x = metrics.rect_x - s->bb_left;
-            rec_y = metrics.rect_y - s->bb_top;
-            rec_width = s->box_width + s->bb_right + s->bb_left;
-            rec_height = s->box_height + s->bb_bottom + s->bb_top;
-            ff_blend_rectangle(&s->dc, &boxcolor,
-                frame->data, frame->linesize, width, height,
-                rec_x, rec_y, rec_width, rec_height);
-        }
-
-        if (s->shadowx || s->shadowy) {
-            if ((ret = draw_glyphs(s, frame, &shadowcolor, &metrics,
-                    s->shadowx, s->shadowy, s->borderw)) < 0) {
-                return ret;
-            }
+        /* Only the rows covered by the box (and the glyphs clipped to it) are
+         * touched; split them into bands aligned to the chroma subsampling. */
+        ThreadData td = {
+            .frame       = frame,
+            .metrics     = &metrics,
+            .fontcolor   = &fontcolor,
+            .shadowcolor = &shadowcolor,
+            .bordercolor = &bordercolor,
+            .boxcolor    = &boxcolor,
+        };
+        const int align = 1 << s->dc.vsub_max;
+
+        if ((!(s->text_align & TA_LEFT) || (s->text_align & TA_RIGHT)) &&
+            !s->tab_warning_printed && s->tab_count > 0) {
+            s->tab_warning_printed = 1;
+            av_log(s, AV_LOG_WARNING, "Tab characters are only supported with left horizontal alignment\n");
         }
 
-        if (s->borderw) {
-            if ((ret = draw_glyphs(s, frame, &bordercolor, &metrics,
-                    0, 0, s->borderw)) < 0) {
-                return ret;
-            }
-        }
-
-        if ((ret = draw_glyphs(s, frame, &fontcolor, &metrics, 0,
-                0, 0)) < 0) {
-            return ret;
-        }
+        td.y_min = av_clip(metrics.rect_y - s->bb_top, 0, height) & ~(align - 1);
+        td.y_max = av_clip(metrics.rect_y + s->box_height + s->bb_bottom, 0, height);
+        if (td.y_max > td.y_min)
+            ff_filter_execute(ctx, draw_text_slice, &td, NULL,
+                              FFMIN((td.y_max - td.y_min + align - 1) / align,
+                                    ff_filter_get_nb_threads(ctx)));
     }
 
     // FREE data structures
@@ -1914,5 +1959,5 @@ const AVFilter ff_vf_drawtext = {
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_QUERY_FUNC(query_formats),
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
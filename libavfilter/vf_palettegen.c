@@ -82,6 +82,9 @@ typedef struct PaletteGenContext {
     int nb_boxes;                           // number of boxes (increase will segmenting them)
     int palette_pushed;                     // if the palette frame is pushed into the outlink or not
     uint8_t transparency_color[4];          // background color for transparency
+    int nb_jobs;                            // number of histogram update jobs
+    int *jobs_ret;                          // per-job error code
+    struct hist_node *job_hists;            // per-job histograms, merged after each frame
 } PaletteGenContext;
 
 #define OFFSET(x) offsetof(PaletteGenContext, x)
@@ -391,9 +394,8 @@ static AVFrame *get_palette_frame(AVFilterContext *ctx)
 /**
  * Locate the color in the hash table and increment its counter.
  */
-static int color_inc(struct hist_node *hist, uint32_t color)
+static int color_inc(struct hist_node *hist, uint32_t color, uint32_t hash)
 {
-    const uint32_t hash = ff_lowbias32(color) & (HIST_SIZE - 1);
     struct hist_node *node = &hist[hash];
     struct color_ref *e;
 
@@ -416,41 +418,75 @@ static int color_inc(struct hist_node *hist, uint32_t color)
 }
 
 /**
- * Update histogram when pixels differ from previous frame.
+ * Add the colors of a job histogram to the main one. Merging the jobs in
+ * order keeps the colors of each bucket in order of first appearance in the
+ * frame, as if it had been scanned by a single job.
  */
-static int update_histogram_diff(struct hist_node *hist,
-                                 const AVFrame *f1, const AVFrame *f2)
+static int merge_histogram(struct hist_node *hist, struct hist_node *job_hist)
 {
-    int x, y, ret, nb_diff_colors = 0;
+    int nb_new_colors = 0;
 
-    for (y = 0; y < f1->height; y++) {
-        const uint32_t *p = (const uint32_t *)(f1->data[0] + y*f1->linesize[0]);
-        const uint32_t *q = (const uint32_t *)(f2->data[0] + y*f2->linesize[0]);
+    for (int i = 0; i < HIST_SIZE; i++) {
+        struct hist_node *src = &job_hist[i];
+        struct hist_node *dst = &hist[i];
 
-        for (x = 0; x < f1->width; x++) {
-            if (p[x] == q[x])
-                continue;
-            ret = color_inc(hist, p[x]);
-            if (ret < 0)
-                return ret;
-            nb_diff_colors += ret;
+        for (int j = 0; j < src->nb_entries; j++) {
+            const struct color_ref *s = &src->entries[j];
+            struct color_ref *e = NULL;
+
+            for (int k = 0; k < dst->nb_entries; k++) {
+                if (dst->entries[k].color == s->color) {
+                    e = &dst->entries[k];
+                    break;
+                }
+            }
+
+            if (e) {
+                e->count += s->count;
+            } else {
+                e = av_dynarray2_add((void**)&dst->entries, &dst->nb_entries,
+                                     sizeof(*dst->entries), (const uint8_t *)s);
+                if (!e)
+                    return AVERROR(ENOMEM);
+                nb_new_colors++;
+            }
         }
+        /* the entries are kept allocated for the next frame */
+        src->nb_entries = 0;
     }
-    return nb_diff_colors;
+
+    return nb_new_colors;
 }
 
+typedef struct ThreadData {
+    const AVFrame *f1, *f2;                 // f2 is the previous frame in diff mode, or NULL
+} ThreadData;
+
 /**
- * Simple histogram of the frame.
+ * Count the colors of a band of rows into the histogram of this job, or
+ * directly into the main one if there is a single job.
+ *
+ * @return the number of colors new to the histogram, or a negative error code
  */
-static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
+static int update_histogram(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    PaletteGenContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *f1 = td->f1, *f2 = td->f2;
+    struct hist_node *hist = nb_jobs > 1 ? s->job_hists + jobnr * HIST_SIZE
+                                         : s->histogram;
+    const int slice_start = (f1->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (f1->height * (jobnr + 1)) / nb_jobs;
     int x, y, ret, nb_diff_colors = 0;
 
-    for (y = 0; y < f->height; y++) {
-        const uint32_t *p = (const uint32_t *)(f->data[0] + y*f->linesize[0]);
+    for (y = slice_start; y < slice_end; y++) {
+        const uint32_t *p = (const uint32_t *)(f1->data[0] + y*f1->linesize[0]);
+        const uint32_t *q = f2 ? (const uint32_t *)(f2->data[0] + y*f2->linesize[0]) : NULL;
 
-        for (x = 0; x < f->width; x++) {
-            ret = color_inc(hist, p[x]);
+        for (x = 0; x < f1->width; x++) {
+            if (q && p[x] == q[x])
+                continue;
+            ret = color_inc(hist, p[x], ff_lowbias32(p[x]) & (HIST_SIZE - 1));
             if (ret < 0)
                 return ret;
             nb_diff_colors += ret;
@@ -466,15 +502,25 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
     PaletteGenContext *s = ctx->priv;
-    int ret;
+    ThreadData td;
+    int ret = 0;
 
     if (in->color_trc != AVCOL_TRC_UNSPECIFIED && in->color_trc != AVCOL_TRC_IEC61966_2_1)
         av_log(ctx, AV_LOG_WARNING, "The input frame is not in sRGB, colors may be off\n");
 
-    ret = s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in)
-                        : update_histogram_frame(s->histogram, in);
-    if (ret > 0)
-        s->nb_refs += ret;
+    td.f1   = s->prev_frame ? s->prev_frame : in;
+    td.f2   = s->prev_frame ? in : NULL;
+    ff_filter_execute(ctx, update_histogram, &td, s->jobs_ret, s->nb_jobs);
+    for (int i = 0; i < s->nb_jobs; i++) {
+        int nb_new_colors = s->jobs_ret[i];
+
+        if (s->nb_jobs > 1 && nb_new_colors >= 0)
+            nb_new_colors = merge_histogram(s->histogram, s->job_hists + i * HIST_SIZE);
+        if (nb_new_colors < 0)
+            ret = nb_new_colors;
+        else
+            s->nb_refs += nb_new_colors;
+    }
 
     if (s->stats_mode == STATS_MODE_DIFF_FRAMES) {
         av_frame_free(&s->prev_frame);
@@ -520,13 +566,36 @@ static int request_frame(AVFilterLink *outlink)
     return r;
 }
 
+static void free_job_histograms(PaletteGenContext *s)
+{
+    if (s->job_hists) {
+        for (int i = 0; i < s->nb_jobs * HIST_SIZE; i++)
+            av_freep(&s->job_hists[i].entries);
+    }
+    av_freep(&s->job_hists);
+    av_freep(&s->jobs_ret);
+}
+
 /**
  * The output is one simple 16x16 squared-pixels palette.
  */
 static int config_output(AVFilterLink *outlink)
 {
+    PaletteGenContext *s = outlink->src->priv;
+
     outlink->w = outlink->h = 16;
     outlink->sample_aspect_ratio = av_make_q(1, 1);
+
+    free_job_histograms(s);
+    s->nb_jobs = ff_filter_get_nb_threads(outlink->src);
+    s->jobs_ret = av_calloc(s->nb_jobs, sizeof(*s->jobs_ret));
+    if (!s->jobs_ret)
+        return AVERROR(ENOMEM);
+    if (s->nb_jobs > 1) {
+        s->job_hists = av_calloc(s->nb_jobs, HIST_SIZE * sizeof(*s->job_hists));
+        if (!s->job_hists)
+            return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
@@ -550,6 +619,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < HIST_SIZE; i++)
         av_freep(&s->histogram[i].entries);
     av_freep(&s->refs);
+    free_job_histograms(s);
     av_frame_free(&s->prev_frame);
 }
 
@@ -580,4 +650,5 @@ const AVFilter ff_vf_palettegen = {
     FILTER_OUTPUTS(palettegen_outputs),
     FILTER_QUERY_FUNC(query_formats),
     .priv_class    = &palettegen_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -82,13 +82,17 @@ struct cache_node {
 
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
+typedef int (*set_frame_func)(struct PaletteUseContext *s, struct cache_node *cache,
+                              AVFrame *out, AVFrame *in,
                               int x_start, int y_start, int width, int height);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
     struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node *job_caches;          /* lookup caches of the slice jobs after the first one */
+    int nb_jobs;
+    int *jobs_ret;
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
@@ -237,11 +241,12 @@ struct stack_node {
  * Check if the requested color is in the cache already. If not, find it in the
  * color tree and cache it.
  */
-static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
+static av_always_inline int color_get(PaletteUseContext *s, struct cache_node *cache,
+                                      uint32_t color)
 {
     struct color_info clrinfo;
     const uint32_t hash = ff_lowbias32(color) & (CACHE_SIZE - 1);
-    struct cache_node *node = &s->cache[hash];
+    struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
     // first, check for transparency
@@ -266,11 +271,11 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(PaletteUseContext *s,
+static av_always_inline int get_dst_color_err(PaletteUseContext *s, struct cache_node *cache,
                                               uint32_t c, int *er, int *eg, int *eb)
 {
     uint32_t dstc;
-    const int dstx = color_get(s, c);
+    const int dstx = color_get(s, cache, c);
     if (dstx < 0)
         return dstx;
     dstc = s->palette[dstx];
@@ -287,7 +292,8 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
+static av_always_inline int set_frame(PaletteUseContext *s, struct cache_node *cache,
+                                      AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
                                       enum dithering_mode dither)
 {
@@ -313,7 +319,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
                 const uint32_t color_new = (unsigned)(a8) << 24 | r << 16 | g << 8 | b;
-                const int color = color_get(s, color_new);
+                const int color = color_get(s, cache, color_new);
 
                 if (color < 0)
                     return color;
@@ -321,7 +327,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -333,7 +339,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -347,7 +353,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -366,7 +372,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -379,7 +385,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA3) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2, down2 = y < h - 2, left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -405,7 +411,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_BURKES) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -425,7 +431,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_ATKINSON) {
                 const int right  = x < w - 1, down  = y < h - 1, left = x > x_start;
                 const int right2 = x < w - 2, down2 = y < h - 2;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -442,7 +448,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 }
 
             } else {
-                const int color = color_get(s, src[x]);
+                const int color = color_get(s, cache, src[x]);
 
                 if (color < 0)
                     return color;
@@ -765,12 +771,35 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *out, *in;
+    int x, y, w, h;
+} ThreadData;
+
+/**
+ * Map a band of rows of the processing window. Every job has its own lookup
+ * cache; the cache only memoizes the nearest color search, so the output does
+ * not depend on the number of jobs.
+ */
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const int slice_start = td->y + (td->h *  jobnr     ) / nb_jobs;
+    const int slice_end   = td->y + (td->h * (jobnr + 1)) / nb_jobs;
+    struct cache_node *cache = jobnr ? s->job_caches + (jobnr - 1) * CACHE_SIZE : s->cache;
+
+    return s->set_frame(s, cache, td->out, td->in,
+                        td->x, slice_start, td->w, slice_end - slice_start);
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
-    int x, y, w, h, ret;
+    int x, y, w, h, ret, nb_jobs;
     AVFilterContext *ctx = inlink->dst;
     PaletteUseContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
+    ThreadData td;
 
     AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out) {
@@ -793,7 +822,18 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
+    /* error diffusion carries state from one row to the next, so only the
+     * dithering modes working on isolated pixels can be split in slices */
+    nb_jobs = s->job_caches ? FFMIN(s->nb_jobs, FFMAX(h, 1)) : 1;
+    td.out = out;
+    td.in  = in;
+    td.x = x; td.y = y;
+    td.w = w; td.h = h;
+    ff_filter_execute(ctx, set_frame_slice, &td, s->jobs_ret, nb_jobs);
+    ret = 0;
+    for (int i = 0; i < nb_jobs; i++)
+        if (s->jobs_ret[i] < 0)
+            ret = s->jobs_ret[i];
     if (ret < 0) {
         av_frame_free(&out);
         *outf = NULL;
@@ -804,6 +844,22 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     return 0;
 }
 
+static void free_cache(struct cache_node *cache)
+{
+    for (int i = 0; i < CACHE_SIZE; i++)
+        av_freep(&cache[i].entries);
+    memset(cache, 0, CACHE_SIZE * sizeof(*cache));
+}
+
+static void free_job_caches(PaletteUseContext *s)
+{
+    if (!s->job_caches)
+        return;
+    for (int i = 0; i < s->nb_jobs - 1; i++)
+        free_cache(s->job_caches + i * CACHE_SIZE);
+    av_freep(&s->job_caches);
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     int ret;
@@ -823,6 +879,18 @@ static int config_output(AVFilterLink *outlink)
     outlink->time_base = ctx->inputs[0]->time_base;
     if ((ret = ff_framesync_configure(&s->fs)) < 0)
         return ret;
+
+    free_job_caches(s);
+    s->nb_jobs = ff_filter_get_nb_threads(ctx);
+    av_freep(&s->jobs_ret);
+    s->jobs_ret = av_calloc(s->nb_jobs, sizeof(*s->jobs_ret));
+    if (!s->jobs_ret)
+        return AVERROR(ENOMEM);
+    if (s->nb_jobs > 1 && (s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER)) {
+        s->job_caches = av_calloc((s->nb_jobs - 1) * CACHE_SIZE, sizeof(*s->job_caches));
+        if (!s->job_caches)
+            return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
@@ -852,9 +920,10 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        free_cache(s->cache);
+        if (s->job_caches)
+            for (i = 0; i < s->nb_jobs - 1; i++)
+                free_cache(s->job_caches + i * CACHE_SIZE);
     }
 
     i = 0;
@@ -902,10 +971,11 @@ static int load_apply_palette(FFFrameSync *fs)
 }
 
 #define DEFINE_SET_FRAME(name, value)                                           \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
+static int set_frame_##name(PaletteUseContext *s, struct cache_node *cache,     \
+                            AVFrame *out, AVFrame *in,                          \
                             int x_start, int y_start, int w, int h)             \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value);                \
+    return set_frame(s, cache, out, in, x_start, y_start, w, h, value);         \
 }
 
 DEFINE_SET_FRAME(none,            DITHERING_NONE)
@@ -970,8 +1040,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (int i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    free_cache(s->cache);
+    free_job_caches(s);
+    av_freep(&s->jobs_ret);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
 }
@@ -1006,4 +1077,5 @@ const AVFilter ff_vf_paletteuse = {
     FILTER_OUTPUTS(paletteuse_outputs),
     FILTER_QUERY_FUNC(query_formats),
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,425 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale one input to several output sizes and formats in a single pass
+ */
+
+#include <string.h>
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+#include "libavutil/avstring.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+typedef struct ScaleMultiOutput {
+    int w, h;
+    enum AVPixelFormat format;    ///< AV_PIX_FMT_NONE to negotiate freely
+    struct SwsContext *sws;
+} ScaleMultiOutput;
+
+typedef struct ScaleMultiContext {
+    const AVClass *class;
+
+    char *sizes_str;
+    char *formats_str;
+    char *flags_str;
+
+    ScaleMultiOutput *outputs;
+    int nb_outputs;
+
+    /* per-frame scratch arrays, nb_outputs entries each */
+    struct SwsContext **sws;
+    AVFrame **frames;
+    int *links;
+} ScaleMultiContext;
+
+static int config_output(AVFilterLink *outlink);
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    ScaleMultiContext *s = ctx->priv;
+    const char *sizes = s->sizes_str, *formats = s->formats_str;
+    int ret;
+
+    if (!sizes || !*sizes) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified\n");
+        return AVERROR(EINVAL);
+    }
+
+    while (*sizes) {
+        ScaleMultiOutput *outputs, *out;
+        AVFilterPad pad = { 0 };
+        char *size;
+
+        outputs = av_realloc_array(s->outputs, s->nb_outputs + 1, sizeof(*s->outputs));
+        if (!outputs)
+            return AVERROR(ENOMEM);
+        s->outputs = outputs;
+        out = &s->outputs[s->nb_outputs];
+        memset(out, 0, sizeof(*out));
+        out->format = AV_PIX_FMT_NONE;
+
+        size = av_get_token(&sizes, "|");
+        if (!size)
+            return AVERROR(ENOMEM);
+        if (*sizes)
+            sizes++;
+        ret = av_parse_video_size(&out->w, &out->h, size);
+        if (ret < 0)
+            av_log(ctx, AV_LOG_ERROR, "Invalid output size '%s'\n", size);
+        av_free(size);
+        if (ret < 0)
+            return ret;
+
+        if (formats && *formats) {
+            char *fmt = av_get_token(&formats, "|");
+            if (!fmt)
+                return AVERROR(ENOMEM);
+            if (*formats)
+                formats++;
+            if (*fmt && strcmp(fmt, "auto")) {
+                out->format = av_get_pix_fmt(fmt);
+                if (out->format == AV_PIX_FMT_NONE || !sws_isSupportedOutput(out->format)) {
+                    av_log(ctx, AV_LOG_ERROR, "Invalid output pixel format '%s'\n", fmt);
+                    av_free(fmt);
+                    return AVERROR(EINVAL);
+                }
+            }
+            av_free(fmt);
+        }
+
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.config_props = config_output;
+        pad.name         = av_asprintf("output%d", s->nb_outputs);
+        if (!pad.name)
+            return AVERROR(ENOMEM);
+        s->nb_outputs++;
+
+        if ((ret = ff_append_outpad_free_name(ctx, &pad)) < 0)
+            return ret;
+    }
+
+    if (formats && *formats) {
+        av_log(ctx, AV_LOG_ERROR, "More pixel formats than output sizes\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->sws    = av_calloc(s->nb_outputs, sizeof(*s->sws));
+    s->frames = av_calloc(s->nb_outputs, sizeof(*s->frames));
+    s->links  = av_calloc(s->nb_outputs, sizeof(*s->links));
+    if (!s->sws || !s->frames || !s->links)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    ScaleMultiContext *s = ctx->priv;
+
+    for (int i = 0; i < s->nb_outputs; i++)
+        sws_freeContext(s->outputs[i].sws);
+    av_freep(&s->outputs);
+    av_freep(&s->sws);
+    av_freep(&s->frames);
+    av_freep(&s->links);
+}
+
+static const int sws_colorspaces[] = {
+    AVCOL_SPC_UNSPECIFIED,
+    AVCOL_SPC_RGB,
+    AVCOL_SPC_BT709,
+    AVCOL_SPC_BT470BG,
+    AVCOL_SPC_SMPTE170M,
+    AVCOL_SPC_FCC,
+    AVCOL_SPC_SMPTE240M,
+    AVCOL_SPC_BT2020_NCL,
+    -1
+};
+
+static int query_formats(AVFilterContext *ctx)
+{
+    ScaleMultiContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = NULL;
+    AVFilterFormats *formats = NULL;
+    int ret;
+
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+        if (sws_isSupportedInput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+    if ((ret = ff_formats_ref(formats, &ctx->inputs[0]->outcfg.formats)) < 0)
+        return ret;
+    if ((ret = ff_formats_ref(ff_make_format_list(sws_colorspaces),
+                              &ctx->inputs[0]->outcfg.color_spaces)) < 0)
+        return ret;
+    if ((ret = ff_formats_ref(ff_all_color_ranges(),
+                              &ctx->inputs[0]->outcfg.color_ranges)) < 0)
+        return ret;
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        formats = NULL;
+        if (s->outputs[i].format != AV_PIX_FMT_NONE) {
+            formats = ff_make_formats_list_singleton(s->outputs[i].format);
+        } else {
+            desc = NULL;
+            while ((desc = av_pix_fmt_desc_next(desc))) {
+                enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+                if (sws_isSupportedOutput(pix_fmt) &&
+                    (ret = ff_add_format(&formats, pix_fmt)) < 0)
+                    return ret;
+            }
+        }
+        if ((ret = ff_formats_ref(formats, &ctx->outputs[i]->incfg.formats)) < 0)
+            return ret;
+        if ((ret = ff_formats_ref(ff_make_format_list(sws_colorspaces),
+                                  &ctx->outputs[i]->incfg.color_spaces)) < 0)
+            return ret;
+        if ((ret = ff_formats_ref(ff_all_color_ranges(),
+                                  &ctx->outputs[i]->incfg.color_ranges)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    ScaleMultiContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    const int idx = FF_OUTLINK_IDX(outlink);
+    ScaleMultiOutput *out = &s->outputs[idx];
+    const AVPixFmtDescriptor *desc    = av_pix_fmt_desc_get(inlink->format);
+    const AVPixFmtDescriptor *outdesc = av_pix_fmt_desc_get(outlink->format);
+    const int *inv_table = sws_getCoefficients(inlink->colorspace);
+    const int *table     = outlink->colorspace != AVCOL_SPC_UNSPECIFIED ?
+                           sws_getCoefficients(outlink->colorspace) : inv_table;
+    int in_full, out_full, brightness, contrast, saturation;
+    int *dummy_inv, *dummy;
+    int ret;
+
+    outlink->w = out->w;
+    outlink->h = out->h;
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ outlink->h * inlink->w,
+                                                              outlink->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    sws_freeContext(out->sws);
+    out->sws = sws_alloc_context();
+    if (!out->sws)
+        return AVERROR(ENOMEM);
+
+    av_opt_set_int(out->sws, "srcw",       inlink->w,       0);
+    av_opt_set_int(out->sws, "srch",       inlink->h,       0);
+    av_opt_set_int(out->sws, "src_format", inlink->format,  0);
+    av_opt_set_int(out->sws, "dstw",       outlink->w,      0);
+    av_opt_set_int(out->sws, "dsth",       outlink->h,      0);
+    av_opt_set_int(out->sws, "dst_format", outlink->format, 0);
+    av_opt_set_int(out->sws, "threads",    1,               0);
+    if (inlink->color_range != AVCOL_RANGE_UNSPECIFIED)
+        av_opt_set_int(out->sws, "src_range", inlink->color_range == AVCOL_RANGE_JPEG, 0);
+    if (outlink->color_range != AVCOL_RANGE_UNSPECIFIED)
+        av_opt_set_int(out->sws, "dst_range", outlink->color_range == AVCOL_RANGE_JPEG, 0);
+
+    /* MPEG chroma positions, as in the scale filter */
+    if (desc->log2_chroma_h == 1)
+        av_opt_set_int(out->sws, "src_v_chr_pos", 128, 0);
+    if (outdesc->log2_chroma_h == 1)
+        av_opt_set_int(out->sws, "dst_v_chr_pos", 128, 0);
+
+    if (s->flags_str && *s->flags_str) {
+        ret = av_opt_set(out->sws, "sws_flags", s->flags_str, 0);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = sws_init_context(out->sws, NULL, NULL);
+    if (ret < 0)
+        return ret;
+
+    sws_getColorspaceDetails(out->sws, &dummy_inv, &in_full, &dummy, &out_full,
+                             &brightness, &contrast, &saturation);
+    sws_setColorspaceDetails(out->sws, inv_table, in_full, table, out_full,
+                             brightness, contrast, saturation);
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d: w:%d h:%d fmt:%s -> w:%d h:%d fmt:%s\n",
+           idx, inlink->w, inlink->h, av_get_pix_fmt_name(inlink->format),
+           outlink->w, outlink->h, av_get_pix_fmt_name(outlink->format));
+
+    return 0;
+}
+
+static int scale_frame(AVFilterContext *ctx, AVFrame *in)
+{
+    ScaleMultiContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    int nb = 0, ret = 0;
+
+    if (in->width != inlink->w || in->height != inlink->h ||
+        in->format != inlink->format) {
+        av_log(ctx, AV_LOG_ERROR, "Input frame parameters changed midstream\n");
+        av_frame_free(&in);
+        return AVERROR(EINVAL);
+    }
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        AVFrame *out;
+
+        if (ff_outlink_get_status(outlink))
+            continue;
+
+        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        ret = av_frame_copy_props(out, in);
+        if (ret < 0) {
+            av_frame_free(&out);
+            goto fail;
+        }
+        out->width  = outlink->w;
+        out->height = outlink->h;
+        out->sample_aspect_ratio = outlink->sample_aspect_ratio;
+        out->color_range = outlink->color_range;
+        out->colorspace  = outlink->colorspace;
+
+        s->sws[nb]    = s->outputs[i].sws;
+        s->frames[nb] = out;
+        s->links[nb]  = i;
+        nb++;
+    }
+
+    if (nb) {
+        ret = sws_scale_frame_multi(s->sws, s->frames, nb, in);
+        if (ret < 0)
+            goto fail;
+    }
+    av_frame_free(&in);
+
+    for (int i = 0; i < nb; i++) {
+        AVFrame *out = s->frames[i];
+
+        s->frames[i] = NULL;
+        ret = ff_filter_frame(ctx->outputs[s->links[i]], out);
+        if (ret < 0)
+            goto fail;
+    }
+
+    return 0;
+
+fail:
+    av_frame_free(&in);
+    for (int i = 0; i < nb; i++)
+        av_frame_free(&s->frames[i]);
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFrame *in;
+    int status, ret, nb_eofs = 0;
+    int64_t pts;
+
+    for (int i = 0; i < ctx->nb_outputs; i++)
+        nb_eofs += ff_outlink_get_status(ctx->outputs[i]) == AVERROR_EOF;
+
+    if (nb_eofs == ctx->nb_outputs) {
+        ff_inlink_set_status(inlink, AVERROR_EOF);
+        return 0;
+    }
+
+    ret = ff_inlink_consume_frame(inlink, &in);
+    if (ret < 0)
+        return ret;
+    if (ret > 0)
+        return scale_frame(ctx, in);
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if (ff_outlink_get_status(ctx->outputs[i]))
+                continue;
+            ff_outlink_set_status(ctx->outputs[i], status, pts);
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        if (ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+
+        if (ff_outlink_frame_wanted(ctx->outputs[i])) {
+            ff_inlink_request_frame(inlink);
+            return 0;
+        }
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+#define OFFSET(x) offsetof(ScaleMultiContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption scale_multi_options[] = {
+    { "sizes",   "'|'-separated list of output sizes",   OFFSET(sizes_str),   AV_OPT_TYPE_STRING, { .str = NULL }, .flags = FLAGS },
+    { "formats", "'|'-separated list of output pixel formats", OFFSET(formats_str), AV_OPT_TYPE_STRING, { .str = NULL }, .flags = FLAGS },
+    { "flags",   "Flags to pass to libswscale",         OFFSET(flags_str),   AV_OPT_TYPE_STRING, { .str = ""   }, .flags = FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(scale_multi);
+
+static const AVFilterPad scale_multi_inputs[] = {
+    {
+        .name = "default",
+        .type = AVMEDIA_TYPE_VIDEO,
+    },
+};
+
+const AVFilter ff_vf_scale_multi = {
+    .name          = "scale_multi",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes and formats at once."),
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    .priv_size     = sizeof(ScaleMultiContext),
+    .priv_class    = &scale_multi_class,
+    FILTER_INPUTS(scale_multi_inputs),
+    .outputs       = NULL,
+    FILTER_QUERY_FUNC(query_formats),
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
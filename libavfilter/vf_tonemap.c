@@ -25,6 +25,7 @@
 
 #include <float.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "libavutil/csp.h"
 #include "libavutil/imgutils.h"
@@ -46,9 +47,13 @@ enum TonemapAlgorithm {
     TONEMAP_REINHARD,
     TONEMAP_HABLE,
     TONEMAP_MOBIUS,
+    TONEMAP_BT2390,
     TONEMAP_MAX,
 };
 
+#define TILE_SIZE 1024
+#define LUT_SIZE  1024
+
 typedef struct TonemapContext {
     const AVClass *class;
 
@@ -58,6 +63,14 @@ typedef struct TonemapContext {
     double peak;
 
     const AVLumaCoefficients *coeffs;
+
+    /* coefficients of the curve kernels for the current peak */
+    float curve[7];
+
+    /* tone curve sampled on [lo, peak] with a quadratic spacing, for the
+     * curves too expensive to evaluate per pixel; below lo they are linear */
+    float lut[LUT_SIZE + 1];
+    double lut_peak;
 } TonemapContext;
 
 static av_cold int init(AVFilterContext *ctx)
@@ -91,91 +104,253 @@ static float hable(float in)
     return (in * (in * a + b * c) + d * e) / (in * (in * a + b) + d * f) - e / f;
 }
 
-static float mobius(float in, float j, double peak)
+static float gamma_curve(float in, float param, double peak)
 {
-    float a, b;
+    return in > 0.05f ? pow(in / peak, 1.0f / param)
+                      : in * pow(0.05f / peak, 1.0f / param) / 0.05f;
+}
 
-    if (in <= j)
-        return in;
+/* SMPTE ST 2084, on linear light relative to REFERENCE_WHITE */
+#define PQ_M1 (2610.0 / 4096 / 4)
+#define PQ_M2 (2523.0 / 4096 * 128)
+#define PQ_C1 (3424.0 / 4096)
+#define PQ_C2 (2413.0 / 4096 * 32)
+#define PQ_C3 (2392.0 / 4096 * 32)
 
-    a = -j * j * (peak - 1.0f) / (j * j - 2.0f * j + peak);
-    b = (j * j - 2.0f * j * peak + peak) / FFMAX(peak - 1.0f, 1e-6);
+static double pq_oetf(double in)
+{
+    double x = pow(FFMAX(in, 0) * REFERENCE_WHITE / 10000, PQ_M1);
+    return pow((PQ_C1 + PQ_C2 * x) / (1 + PQ_C3 * x), PQ_M2);
+}
 
-    return (b * b + 2.0f * b * j + j * j) / (b - a) * (in + a) / (in + b);
+static double pq_eotf(double in)
+{
+    double x = pow(FFMAX(in, 0), 1.0 / PQ_M2);
+    return pow(FFMAX(x - PQ_C1, 0) / (PQ_C2 - PQ_C3 * x), 1.0 / PQ_M1) * 10000 / REFERENCE_WHITE;
 }
 
-#define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
-static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
-                    const AVPixFmtDescriptor *desc, int x, int y, double peak)
+/* ITU-R BT.2390 EETF with a hermite spline knee, mapping [0, peak] to [0, 1] */
+static float bt2390(float in, double peak)
 {
-    int map[3] = { desc->comp[0].plane, desc->comp[1].plane, desc->comp[2].plane };
-    const float *r_in = (const float *)(in->data[map[0]] + x * desc->comp[map[0]].step + y * in->linesize[map[0]]);
-    const float *g_in = (const float *)(in->data[map[1]] + x * desc->comp[map[1]].step + y * in->linesize[map[1]]);
-    const float *b_in = (const float *)(in->data[map[2]] + x * desc->comp[map[2]].step + y * in->linesize[map[2]]);
-    float *r_out = (float *)(out->data[map[0]] + x * desc->comp[map[0]].step + y * out->linesize[map[0]]);
-    float *g_out = (float *)(out->data[map[1]] + x * desc->comp[map[1]].step + y * out->linesize[map[1]]);
-    float *b_out = (float *)(out->data[map[2]] + x * desc->comp[map[2]].step + y * out->linesize[map[2]]);
-    float sig, sig_orig;
-
-    /* load values */
-    *r_out = *r_in;
-    *g_out = *g_in;
-    *b_out = *b_in;
-
-    /* desaturate to prevent unnatural colors */
-    if (s->desat > 0) {
-        float luma = av_q2d(s->coeffs->cr) * *r_in + av_q2d(s->coeffs->cg) * *g_in + av_q2d(s->coeffs->cb) * *b_in;
-        float overbright = FFMAX(luma - s->desat, 1e-6) / FFMAX(luma, 1e-6);
-        *r_out = MIX(*r_in, luma, overbright);
-        *g_out = MIX(*g_in, luma, overbright);
-        *b_out = MIX(*b_in, luma, overbright);
+    const double src_pq = pq_oetf(peak);
+    const double max_lum = pq_oetf(1.0) / src_pq;
+    const double ks = 1.5 * max_lum - 0.5;
+    double e1 = pq_oetf(in) / src_pq;
+    double e2 = e1;
+
+    if (e1 > ks && ks < 1.0) {
+        double t  = (FFMIN(e1, 1.0) - ks) / (1.0 - ks);
+        double t2 = t * t, t3 = t2 * t;
+        e2 = (2 * t3 - 3 * t2 + 1) * ks + (t3 - 2 * t2 + t) * (1.0 - ks) +
+             (-2 * t3 + 3 * t2) * max_lum;
     }
 
-    /* pick the brightest component, reducing the value range as necessary
-     * to keep the entire signal in range and preventing discoloration due to
-     * out-of-bounds clipping */
-    sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
-    sig_orig = sig;
+    return pq_eotf(e2 * src_pq);
+}
 
-    switch(s->tonemap) {
-    default:
-    case TONEMAP_NONE:
-        // do nothing
-        break;
+static float eval_curve(const TonemapContext *s, float in, double peak)
+{
+    switch (s->tonemap) {
+    case TONEMAP_GAMMA:  return gamma_curve(in, s->param, peak);
+    case TONEMAP_BT2390: return bt2390(in, peak);
+    default:             return in;
+    }
+}
+
+static void update_lut(TonemapContext *s, double lo, double peak)
+{
+    if (s->lut_peak == peak)
+        return;
+
+    for (int i = 0; i <= LUT_SIZE; i++) {
+        double t = (double)i / LUT_SIZE;
+        s->lut[i] = eval_curve(s, lo + t * t * (peak - lo), peak);
+    }
+    s->lut_peak = peak;
+}
+
+/**
+ * Express the tone curve for the given peak as the coefficients of
+ * curve_rational() or curve_lut().
+ */
+static void update_curve(TonemapContext *s, double peak)
+{
+    const float fpeak = peak;
+    const float param = s->param;
+    float *c = s->curve;
+    double lo;
+
+    /* the signal is at least 1e-6, so c[0] = 0 never selects c[1] */
+    memset(c, 0, sizeof(s->curve));
+    c[4] = 1.0f;
+
+    switch (s->tonemap) {
     case TONEMAP_LINEAR:
-        sig = sig * s->param / peak;
-        break;
-    case TONEMAP_GAMMA:
-        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
-                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
+        c[2] = param / fpeak;
         break;
     case TONEMAP_CLIP:
-        sig = av_clipf(sig * s->param, 0, 1.0f);
+        /* min(sig * param, 1) / sig */
+        c[0] = 1.0f / param;
+        c[1] = param;
+        c[2] = 1.0f;
+        c[4] = 0.0f;
+        c[5] = 1.0f;
         break;
-    case TONEMAP_HABLE:
-        sig = hable(sig) / hable(peak);
+    case TONEMAP_HABLE: {
+        /* hable(sig) / sig, with the constant terms of the numerator
+         * cancelling out against the e / f offset */
+        const float a = 0.15f, b = 0.50f, cc = 0.10f, d = 0.20f, e = 0.02f, f = 0.30f;
+        const float scale = 1.0f / hable(fpeak);
+        c[2] = scale * b * (cc - e / f);
+        c[3] = scale * a * (1.0f - e / f);
+        c[4] = d * f;
+        c[5] = b;
+        c[6] = a;
         break;
+    }
     case TONEMAP_REINHARD:
-        sig = sig / (sig + s->param) * (peak + s->param) / peak;
+        c[2] = (fpeak + param) / fpeak;
+        c[4] = param;
+        c[5] = 1.0f;
         break;
-    case TONEMAP_MOBIUS:
-        sig = mobius(sig, s->param, peak);
+    case TONEMAP_MOBIUS: {
+        const float j = param;
+        const float a = -j * j * (fpeak - 1.0f) / (j * j - 2.0f * j + fpeak);
+        const float b = (j * j - 2.0f * j * fpeak + fpeak) / FFMAX(fpeak - 1.0f, 1e-6f);
+        const float scale = (b * b + 2.0f * b * j + j * j) / (b - a);
+        c[0] = j;
+        c[1] = 1.0f;
+        c[2] = scale * a;
+        c[3] = scale;
+        c[4] = 0.0f;
+        c[5] = b;
+        c[6] = 1.0f;
         break;
     }
-
-    /* apply the computed scale factor to the color,
-     * linearly to prevent discoloration */
-    *r_out *= sig / sig_orig;
-    *g_out *= sig / sig_orig;
-    *b_out *= sig / sig_orig;
+    case TONEMAP_GAMMA:
+        lo = FFMIN(0.05f, peak);
+        c[0] = 0.05f;
+        c[1] = pow(0.05f / peak, 1.0f / param) / 0.05f;
+        c[2] = lo;
+        c[3] = peak > lo ? 1.0 / (peak - lo) : 0.0;
+        update_lut(s, lo, peak);
+        break;
+    case TONEMAP_BT2390: {
+        const double src_pq = pq_oetf(peak);
+        const double max_lum = pq_oetf(1.0) / src_pq;
+        const double ks = 1.5 * max_lum - 0.5;
+        /* the curve is the identity up to the knee */
+        lo = ks < 1.0 ? pq_eotf(FFMAX(ks, 0) * src_pq) : peak;
+        c[0] = ks < 1.0 ? lo : FLT_MAX;
+        c[1] = 1.0f;
+        c[2] = lo;
+        c[3] = peak > lo ? 1.0 / (peak - lo) : 0.0;
+        if (ks < 1.0)
+            update_lut(s, lo, peak);
+        break;
+    }
+    }
 }
 
 typedef struct ThreadData {
     AVFrame *in, *out;
     const AVPixFmtDescriptor *desc;
     double peak;
+    float coeffs[4];
 } ThreadData;
 
+/**
+ * Desaturate overbright pixels towards their luma and store the brightest
+ * component of the result, clipped to 1e-6, in sig.
+ *
+ * @param coeffs red, green and blue luma coefficients and the desaturation
+ *               strength
+ */
+static void desaturate(float *r_out, float *g_out, float *b_out, float *sig,
+                       const float *r_in, const float *g_in, const float *b_in,
+                       const float *coeffs, int width)
+{
+    const float cr = coeffs[0], cg = coeffs[1], cb = coeffs[2];
+    const float desat = coeffs[3];
+
+    for (int x = 0; x < width; x++) {
+        float luma = cr * r_in[x] + cg * g_in[x] + cb * b_in[x];
+        float overbright = FFMAX(luma - desat, 1e-6f) / FFMAX(luma, 1e-6f);
+        float r = r_in[x] * (1.0f - overbright) + luma * overbright;
+        float g = g_in[x] * (1.0f - overbright) + luma * overbright;
+        float b = b_in[x] * (1.0f - overbright) + luma * overbright;
+
+        r_out[x] = r;
+        g_out[x] = g;
+        b_out[x] = b;
+        sig[x] = FFMAX(FFMAX3(r, g, b), 1e-6f);
+    }
+}
+
+/**
+ * Scale factor for the curves reducible to a rational function:
+ * dst = sig <= c[0] ? c[1] : (c[2] + c[3] * sig) / (c[4] + sig * (c[5] + c[6] * sig))
+ */
+static void curve_rational(float *dst, const float *sig, const float *c, int width)
+{
+    const float thresh = c[0], below = c[1];
+    const float n0 = c[2], n1 = c[3];
+    const float d0 = c[4], d1 = c[5], d2 = c[6];
+
+    for (int x = 0; x < width; x++) {
+        float in = sig[x];
+        float out = (n0 + n1 * in) / (d0 + in * (d1 + d2 * in));
+        dst[x] = in <= thresh ? below : out;
+    }
+}
+
+/**
+ * Scale factor with the tone curve interpolated from lut, which holds
+ * LUT_SIZE + 1 samples at lo + t^2 * (peak - lo), t in [0, 1]:
+ * dst = sig <= c[0] ? c[1] : curve(sig) / sig, with lo = c[2] and
+ * c[3] = 1 / (peak - lo). Signals above peak use the last sample.
+ */
+static void curve_lut(float *dst, const float *sig, const float *c,
+                      const float *lut, int width)
+{
+    const float thresh = c[0], below = c[1];
+    const float lo = c[2], scale = c[3];
+
+    for (int x = 0; x < width; x++) {
+        float in = sig[x];
+        /* interpolate linearly in the signal domain, not in the lut's */
+        float pos = FFMIN(FFMAX((in - lo) * scale, 0.0f), 1.0f) * (LUT_SIZE * LUT_SIZE);
+        int idx = FFMIN((int)sqrtf(pos), LUT_SIZE - 1);
+        float frac = (pos - (float)(idx * idx)) / (2 * idx + 1);
+        float out = lut[idx] + (lut[idx + 1] - lut[idx]) * frac;
+        dst[x] = in <= thresh ? below : out / in;
+    }
+}
+
+/**
+ * Turn the signal of each pixel into the scale factor to apply to it.
+ */
+static void tonemap_curve(const TonemapContext *s, float *dst, const float *sig,
+                          int width, double peak)
+{
+    switch (s->tonemap) {
+    default:
+        curve_rational(dst, sig, s->curve, width);
+        break;
+    case TONEMAP_GAMMA:
+    case TONEMAP_BT2390:
+        curve_lut(dst, sig, s->curve, s->lut, width);
+        /* unlike bt2390, the gamma curve keeps rising past the lut */
+        if (s->tonemap == TONEMAP_GAMMA) {
+            const float fpeak = peak;
+            for (int x = 0; x < width; x++)
+                if (sig[x] > fpeak)
+                    dst[x] = gamma_curve(sig[x], s->param, peak) / sig[x];
+        }
+        break;
+    }
+}
+
 static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     TonemapContext *s = ctx->priv;
@@ -183,13 +358,53 @@ static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
     AVFrame *in = td->in;
     AVFrame *out = td->out;
     const AVPixFmtDescriptor *desc = td->desc;
+    const int map[3] = { desc->comp[0].plane, desc->comp[1].plane, desc->comp[2].plane };
     const int slice_start = (in->height * jobnr) / nb_jobs;
     const int slice_end = (in->height * (jobnr+1)) / nb_jobs;
+    const int width = out->width;
     double peak = td->peak;
+    float sig[TILE_SIZE], scale[TILE_SIZE];
+
+    for (int y = slice_start; y < slice_end; y++) {
+        const float *r_in = (const float *)(in->data[map[0]] + y * in->linesize[map[0]]);
+        const float *g_in = (const float *)(in->data[map[1]] + y * in->linesize[map[1]]);
+        const float *b_in = (const float *)(in->data[map[2]] + y * in->linesize[map[2]]);
+        float *r_out = (float *)(out->data[map[0]] + y * out->linesize[map[0]]);
+        float *g_out = (float *)(out->data[map[1]] + y * out->linesize[map[1]]);
+        float *b_out = (float *)(out->data[map[2]] + y * out->linesize[map[2]]);
+
+        for (int x = 0; x < width; x += TILE_SIZE) {
+            const int w = FFMIN(width - x, TILE_SIZE);
+
+            /* desaturate to prevent unnatural colors, and pick the brightest
+             * component, reducing the value range as necessary to keep the
+             * entire signal in range and preventing discoloration due to
+             * out-of-bounds clipping */
+            if (s->desat > 0) {
+                desaturate(r_out + x, g_out + x, b_out + x, sig,
+                           r_in + x, g_in + x, b_in + x, td->coeffs, w);
+            } else {
+                memcpy(r_out + x, r_in + x, w * sizeof(*r_out));
+                memcpy(g_out + x, g_in + x, w * sizeof(*g_out));
+                memcpy(b_out + x, b_in + x, w * sizeof(*b_out));
+                for (int i = 0; i < w; i++)
+                    sig[i] = FFMAX(FFMAX3(r_in[x + i], g_in[x + i], b_in[x + i]), 1e-6f);
+            }
+
+            if (s->tonemap == TONEMAP_NONE)
+                continue;
 
-    for (int y = slice_start; y < slice_end; y++)
-        for (int x = 0; x < out->width; x++)
-            tonemap(s, out, in, desc, x, y, peak);
+            tonemap_curve(s, scale, sig, w, peak);
+
+            /* apply the computed scale factor to the color,
+             * linearly to prevent discoloration */
+            for (int i = 0; i < w; i++) {
+                r_out[x + i] *= scale[i];
+                g_out[x + i] *= scale[i];
+                b_out[x + i] *= scale[i];
+            }
+        }
+    }
 
     return 0;
 }
@@ -249,11 +464,19 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         s->desat = 0;
     }
 
+    update_curve(s, peak);
+
     /* do the tone map */
     td.out = out;
     td.in = in;
     td.desc = desc;
     td.peak = peak;
+    if (s->coeffs) {
+        td.coeffs[0] = av_q2d(s->coeffs->cr);
+        td.coeffs[1] = av_q2d(s->coeffs->cg);
+        td.coeffs[2] = av_q2d(s->coeffs->cb);
+    }
+    td.coeffs[3] = s->desat;
     ff_filter_execute(ctx, tonemap_slice, &td, NULL,
                       FFMIN(in->height, ff_filter_get_nb_threads(ctx)));
 
@@ -289,6 +512,7 @@ static const AVOption tonemap_options[] = {
     {     "reinhard", 0, 0, AV_OPT_TYPE_CONST, {.i64 = TONEMAP_REINHARD},          0, 0, FLAGS, .unit = "tonemap" },
     {     "hable",    0, 0, AV_OPT_TYPE_CONST, {.i64 = TONEMAP_HABLE},             0, 0, FLAGS, .unit = "tonemap" },
     {     "mobius",   0, 0, AV_OPT_TYPE_CONST, {.i64 = TONEMAP_MOBIUS},            0, 0, FLAGS, .unit = "tonemap" },
+    {     "bt2390",   0, 0, AV_OPT_TYPE_CONST, {.i64 = TONEMAP_BT2390},            0, 0, FLAGS, .unit = "tonemap" },
     { "param",        "tonemap parameter", OFFSET(param), AV_OPT_TYPE_DOUBLE, {.dbl = NAN}, DBL_MIN, DBL_MAX, FLAGS },
     { "desat",        "desaturation strength", OFFSET(desat), AV_OPT_TYPE_DOUBLE, {.dbl = 2}, 0, DBL_MAX, FLAGS },
     { "peak",         "signal peak override", OFFSET(peak), AV_OPT_TYPE_DOUBLE, {.dbl = 0}, 0, DBL_MAX, FLAGS },
@@ -87,11 +87,20 @@ static int checkstride(YADIFContext *yadif, const AVFrame *a, const AVFrame *b)
     return 0;
 }
 
-static void fixstride(AVFilterLink *link, AVFrame *f)
+static void fixstride(AVFrame *f)
 {
-    AVFrame *dst = ff_default_get_video_buffer(link, f->width, f->height);
+    /* Not allocated from the link pool, which belongs to the source filter
+     * and may be in use on another thread with frame threading. */
+    AVFrame *dst = av_frame_alloc();
     if(!dst)
         return;
+    dst->format = f->format;
+    dst->width  = f->width;
+    dst->height = f->height;
+    if (av_frame_get_buffer(dst, 0) < 0) {
+        av_frame_free(&dst);
+        return;
+    }
     av_frame_copy_props(dst, f);
     av_image_copy2(dst->data, dst->linesize,
                    f->data, f->linesize,
@@ -128,12 +137,12 @@ int ff_yadif_filter_frame(AVFilterLink *link, AVFrame *frame)
 
     if (checkstride(yadif, yadif->next, yadif->cur)) {
         av_log(ctx, AV_LOG_VERBOSE, "Reallocating frame due to differing stride\n");
-        fixstride(link, yadif->next);
+        fixstride(yadif->next);
     }
     if (checkstride(yadif, yadif->next, yadif->cur))
-        fixstride(link, yadif->cur);
+        fixstride(yadif->cur);
     if (yadif->prev && checkstride(yadif, yadif->next, yadif->prev))
-        fixstride(link, yadif->prev);
+        fixstride(yadif->prev);
     if (checkstride(yadif, yadif->next, yadif->cur) || (yadif->prev && checkstride(yadif, yadif->next, yadif->prev))) {
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate frame\n");
         return -1;
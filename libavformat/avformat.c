@@ -69,6 +69,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     av_bsf_free(&sti->extract_extradata.bsf);
 
     if (sti->info) {
+        avpriv_packet_list_free(&sti->info->decode_queue);
         av_freep(&sti->info->duration_error);
         av_freep(&sti->info);
     }
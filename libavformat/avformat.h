@@ -1870,6 +1870,26 @@ typedef struct AVFormatContext {
      * @return 0 on success, a negative AVERROR code on failure
      */
     int (*io_close2)(struct AVFormatContext *s, AVIOContext *pb);
+
+    /**
+     * Number of threads avformat_find_stream_info() uses to decode the
+     * packets of different streams in parallel. 1 decodes all streams on
+     * the calling thread, 0 picks a number based on the available CPUs.
+     * The results of the analysis do not depend on the number of threads.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int analyze_threads;
+
+    /**
+     * Directory in which avformat_find_stream_info() caches its results for
+     * local files. When the same unmodified file is opened again, the codec
+     * parameters, frame rates and durations are restored from the cache and
+     * the analysis is skipped.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    char *stream_info_cache;
 } AVFormatContext;
 
 /**
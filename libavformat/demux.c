@@ -31,6 +31,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/time.h"
 #include "libavutil/timestamp.h"
 
@@ -1318,6 +1319,8 @@ fail:
     return ret;
 }
 
+static void analyze_threads_run(struct AnalyzeThreadContext *at);
+
 static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
 {
     FFFormatContext *const si = ffformatcontext(s);
@@ -1333,6 +1336,8 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
         if (ret < 0) {
             if (ret == AVERROR(EAGAIN))
                 return ret;
+            if (si->analyze_threads)
+                analyze_threads_run(si->analyze_threads);
             /* flush the parsers */
             for (unsigned i = 0; i < s->nb_streams; i++) {
                 AVStream *const st  = s->streams[i];
@@ -1350,6 +1355,13 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
 
         st->event_flags |= AVSTREAM_EVENT_FLAG_NEW_PACKETS;
 
+        /* The parser and the timestamps of the packet depend on the state of
+         * the decoder, and a parameter change below replaces it. Decode the
+         * packets queued for the parallel analysis first, as the serial
+         * analysis would have. */
+        if (si->analyze_threads && sti->info && sti->info->decode_queue.head)
+            analyze_threads_run(si->analyze_threads);
+
         /* update context if required */
         if (sti->need_context_update) {
             if (avcodec_is_open(sti->avctx)) {
@@ -2068,9 +2080,23 @@ static int has_codec_parameters(const AVStream *st, const char **errmsg_ptr)
     return 1;
 }
 
+/**
+ * Check whether decoding more packets of the stream cannot provide any
+ * further information. nb_frames is the number of packets of the stream
+ * that were read before the next one to be decoded.
+ */
+static int decoding_done(AVStream *st, int nb_frames)
+{
+    const AVCodecContext *const avctx = ffstream(st)->avctx;
+
+    return has_codec_parameters(st, NULL) && has_decode_delay_been_guessed(st) &&
+           (nb_frames || !(avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF));
+}
+
 /* returns 1 or 0 if or if not decoded data was returned, or a negative error */
 static int try_decode_frame(AVFormatContext *s, AVStream *st,
-                            const AVPacket *pkt, AVDictionary **options)
+                            const AVPacket *pkt, int nb_frames,
+                            AVDictionary **options)
 {
     FFStream *const sti = ffstream(st);
     AVCodecContext *const avctx = sti->avctx;
@@ -2130,10 +2156,7 @@ static int try_decode_frame(AVFormatContext *s, AVStream *st,
     }
 
     while ((pkt_to_send || (!pkt->data && got_picture)) &&
-           ret >= 0 &&
-           (!has_codec_parameters(st, NULL) || !has_decode_delay_been_guessed(st) ||
-            (!sti->codec_info_nb_frames &&
-             (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF)))) {
+           ret >= 0 && !decoding_done(st, nb_frames)) {
         got_picture = 0;
         if (avctx->codec_type == AVMEDIA_TYPE_VIDEO ||
             avctx->codec_type == AVMEDIA_TYPE_AUDIO) {
@@ -2171,6 +2194,226 @@ fail:
     return ret;
 }
 
+/**
+ * Check whether the stream has an open decoder that cannot provide any
+ * further information.
+ */
+static int analyze_done(AVStream *st, int nb_frames)
+{
+    const FFStream *const sti = ffstream(st);
+
+    return avcodec_is_open(sti->avctx) && sti->info->found_decoder == 1 &&
+           decoding_done(st, nb_frames);
+}
+
+/**
+ * Decode one packet for the stream analysis and account for the time spent.
+ */
+static int analyze_decode_packet(AVFormatContext *s, AVStream *st,
+                                 const AVPacket *pkt, int nb_frames,
+                                 AVDictionary **options, int64_t start_time)
+{
+    FFStreamInfo *const info = ffstream(st)->info;
+    int64_t t;
+    int ret;
+
+    if (analyze_done(st, nb_frames))
+        return 0;
+
+    t   = av_gettime_relative();
+    ret = try_decode_frame(s, st, pkt, nb_frames, options);
+
+    info->decode_time += av_gettime_relative() - t;
+    if (pkt->data)
+        info->nb_decode_packets++;
+    if (!info->params_found_packets && has_codec_parameters(st, NULL)) {
+        info->params_found_time    = av_gettime_relative() - start_time;
+        info->params_found_packets = nb_frames + 1;
+    }
+    return ret;
+}
+
+/**
+ * Maximum number of packets queued before they are decoded in parallel.
+ */
+#define ANALYZE_BATCH_SIZE 32
+
+/**
+ * State for decoding the packets of different streams in parallel during
+ * avformat_find_stream_info(). Packets are queued per stream while reading
+ * and each batch is decoded with one job per stream, so that a decoder is
+ * never used by two threads at once and sees its packets in order.
+ *
+ * The batch is decoded before anything that depends on the state of a
+ * decoder with queued packets: reading the next packet of its stream, see
+ * read_frame_internal(), and checking whether the analysis of its stream is
+ * complete, see find_incomplete_stream(). The results are thus the same as
+ * with the serial analysis.
+ */
+typedef struct AnalyzeThreadContext {
+    AVFormatContext *ic;
+    AVDictionary   **options;
+    int              orig_nb_streams;
+    int64_t          start_time;
+
+    AVSliceThread   *thread;
+    int              nb_threads;
+
+    /* indices of the streams to decode in the next batch */
+    unsigned        *jobs;
+    unsigned         jobs_size;
+    int              nb_jobs;
+    int              nb_queued;
+
+    /* if set, the decoders are flushed with this packet instead */
+    const AVPacket  *flush_pkt;
+
+    /* wall clock time spent in batches */
+    int64_t          decode_time;
+} AnalyzeThreadContext;
+
+static void analyze_thread_worker(void *priv, int jobnr, int threadnr,
+                                  int nb_jobs, int nb_threads)
+{
+    AnalyzeThreadContext *const at = priv;
+    AVStream *const st  = at->ic->streams[at->jobs[jobnr]];
+    FFStream *const sti = ffstream(st);
+    FFStreamInfo *const info = sti->info;
+    AVDictionary **options = at->options && st->index < at->orig_nb_streams ?
+                             &at->options[st->index] : NULL;
+    int nb_frames = info->decode_queue_first;
+
+    if (at->flush_pkt) {
+        if (analyze_decode_packet(at->ic, st, at->flush_pkt, sti->codec_info_nb_frames,
+                                  options, at->start_time) < 0)
+            av_log(at->ic, AV_LOG_INFO,
+                   "decoding for stream %d failed\n", st->index);
+        return;
+    }
+
+    for (PacketListEntry *pktl = info->decode_queue.head; pktl; pktl = pktl->next) {
+        /* Stop as soon as the stream is known and drop the remaining packets. */
+        if (analyze_done(st, nb_frames))
+            break;
+        analyze_decode_packet(at->ic, st, &pktl->pkt, nb_frames++,
+                              options, at->start_time);
+    }
+    avpriv_packet_list_free(&info->decode_queue);
+}
+
+static int analyze_threads_add_job(AnalyzeThreadContext *at, unsigned stream_index)
+{
+    unsigned *jobs = av_fast_realloc(at->jobs, &at->jobs_size,
+                                     (at->nb_jobs + 1) * sizeof(*at->jobs));
+    if (!jobs)
+        return AVERROR(ENOMEM);
+    at->jobs = jobs;
+    at->jobs[at->nb_jobs++] = stream_index;
+    return 0;
+}
+
+static void analyze_threads_run(AnalyzeThreadContext *at)
+{
+    int64_t t;
+
+    if (!at->nb_jobs)
+        return;
+
+    t = av_gettime_relative();
+    avpriv_slicethread_execute(at->thread, at->nb_jobs, 0);
+    at->decode_time += av_gettime_relative() - t;
+
+    at->nb_jobs   = 0;
+    at->nb_queued = 0;
+}
+
+/**
+ * Queue a packet for decoding by a worker thread and decode the queued
+ * packets once enough of them have been collected.
+ */
+static int analyze_threads_queue(AnalyzeThreadContext *at, AVStream *st,
+                                 const AVPacket *pkt)
+{
+    FFStream *const sti = ffstream(st);
+    FFStreamInfo *const info = sti->info;
+    int first = !info->decode_queue.head;
+    int ret;
+
+    /* Nothing left to learn from decoding this stream. */
+    if (first && analyze_done(st, sti->codec_info_nb_frames))
+        return 0;
+
+    ret = avpriv_packet_list_put(&info->decode_queue, (AVPacket *)pkt,
+                                 av_packet_ref, 0);
+    if (ret < 0)
+        return ret;
+    if (first) {
+        info->decode_queue_first = sti->codec_info_nb_frames;
+        ret = analyze_threads_add_job(at, st->index);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (++at->nb_queued >= ANALYZE_BATCH_SIZE)
+        analyze_threads_run(at);
+    return 0;
+}
+
+static int analyze_threads_flush(AnalyzeThreadContext *at, const AVPacket *flush_pkt)
+{
+    AVFormatContext *const ic = at->ic;
+    int ret;
+
+    analyze_threads_run(at);
+
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        if (ffstream(ic->streams[i])->info->found_decoder == 1) {
+            ret = analyze_threads_add_job(at, i);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    at->flush_pkt = flush_pkt;
+    analyze_threads_run(at);
+    at->flush_pkt = NULL;
+    return 0;
+}
+
+static void log_analyze_stats(AVFormatContext *ic, const AnalyzeThreadContext *at,
+                              int64_t read_time)
+{
+    int64_t decode_time = 0;
+
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        const FFStream *const sti = cffstream(ic->streams[i]);
+        const FFStreamInfo *const info = sti->info;
+
+        if (!info)
+            continue;
+        decode_time += info->decode_time;
+        if (info->params_found_packets)
+            av_log(ic, AV_LOG_VERBOSE, "Stream #%u: codec parameters known after "
+                   "%.1f ms and %d packets, %d packets decoded in %.1f ms\n",
+                   i, info->params_found_time / 1000.0, info->params_found_packets,
+                   info->nb_decode_packets, info->decode_time / 1000.0);
+        else
+            av_log(ic, AV_LOG_VERBOSE, "Stream #%u: codec parameters not known, "
+                   "%d packets decoded in %.1f ms\n",
+                   i, info->nb_decode_packets, info->decode_time / 1000.0);
+    }
+
+    if (at->thread)
+        av_log(ic, AV_LOG_VERBOSE, "Stream analysis took %.1f ms: %.1f ms reading, "
+               "%.1f ms decoding %.1f ms worth of packets on %d threads\n",
+               (av_gettime_relative() - at->start_time) / 1000.0, read_time / 1000.0,
+               at->decode_time / 1000.0, decode_time / 1000.0, at->nb_threads);
+    else
+        av_log(ic, AV_LOG_VERBOSE, "Stream analysis took %.1f ms: %.1f ms reading, "
+               "%.1f ms decoding\n",
+               (av_gettime_relative() - at->start_time) / 1000.0, read_time / 1000.0,
+               decode_time / 1000.0);
+}
+
 static int chapter_start_cmp(const void *p1, const void *p2)
 {
     const AVChapter *const ch1 = *(AVChapter**)p1;
@@ -2496,6 +2739,106 @@ static int extract_extradata(FFFormatContext *si, AVStream *st, const AVPacket *
     return 0;
 }
 
+/**
+ * Check whether avformat_find_stream_info() needs more packets to analyze
+ * the stream.
+ *
+ * @return 0 if the analysis of the stream is complete,
+ *         1 if it needs more packets, but decoding may still complete it,
+ *         2 if it needs more packets whatever the state of its decoder
+ */
+static int stream_needs_packets(AVFormatContext *ic, AVStream *st)
+{
+    FFStream *const sti = ffstream(st);
+    const AVCodecContext *const avctx = sti->avctx;
+    int fps_analyze_framecount = 20;
+    int fps_count_fixed;
+    int count;
+
+    /* whether fps_analyze_framecount is known without the frame rate
+     * exported by the decoder, see tb_unreliable() */
+    fps_count_fixed = ic->fps_probe_size >= 0 ||
+                      (st->disposition & AV_DISPOSITION_ATTACHED_PIC) ||
+                      avctx->codec_tag == AV_RL32("mp4v") ||
+                      avctx->codec_id == AV_CODEC_ID_MPEG2VIDEO ||
+                      avctx->codec_id == AV_CODEC_ID_GIF ||
+                      avctx->codec_id == AV_CODEC_ID_HEVC ||
+                      avctx->codec_id == AV_CODEC_ID_H264;
+
+    /* If the timebase is coarse (like the usual millisecond precision
+     * of mkv), we need to analyze more frames to reliably arrive at
+     * the correct fps. */
+    if (av_q2d(st->time_base) > 0.0005)
+        fps_analyze_framecount *= 2;
+    if (!tb_unreliable(ic, st))
+        fps_analyze_framecount = 0;
+    if (ic->fps_probe_size >= 0)
+        fps_analyze_framecount = ic->fps_probe_size;
+    if (st->disposition & AV_DISPOSITION_ATTACHED_PIC)
+        fps_analyze_framecount = 0;
+    /* variable fps and no guess at the real fps */
+    count = (ic->iformat->flags & AVFMT_NOTIMESTAMPS) ?
+               sti->info->codec_info_duration_fields/2 :
+               sti->info->duration_count;
+
+    /* conditions that do not depend on the decoder */
+    if (!(st->r_frame_rate.num && st->avg_frame_rate.num) &&
+        st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+        fps_count_fixed && count < fps_analyze_framecount)
+        return 2;
+    if (sti->first_dts == AV_NOPTS_VALUE &&
+        (!(ic->iformat->flags & AVFMT_NOTIMESTAMPS) || sti->need_parsing == AVSTREAM_PARSE_FULL_RAW) &&
+        sti->codec_info_nb_frames < ((st->disposition & AV_DISPOSITION_ATTACHED_PIC) ? 1 : ic->max_ts_probe) &&
+        (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO ||
+         st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO))
+        return 2;
+
+    if (!has_codec_parameters(st, NULL))
+        return 1;
+    if (!(st->r_frame_rate.num && st->avg_frame_rate.num) &&
+        st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        if (count < fps_analyze_framecount)
+            return 1;
+    }
+    // Look at the first 3 frames if there is evidence of frame delay
+    // but the decoder delay is not set.
+    if (sti->info->frame_delay_evidence && count < 2 && avctx->has_b_frames == 0)
+        return 1;
+    if (!avctx->extradata &&
+        (!sti->extract_extradata.inited || sti->extract_extradata.bsf) &&
+        extract_extradata_check(st))
+        return 1;
+    return 0;
+}
+
+/**
+ * Find the first stream whose analysis is not complete yet.
+ *
+ * The state of a decoder with packets queued for the parallel analysis may
+ * be stale. The queued packets are decoded first whenever that state could
+ * change the result, so that the same stream is found as in the serial
+ * analysis.
+ *
+ * @return index of the stream, or the number of streams if all are complete
+ */
+static unsigned find_incomplete_stream(AVFormatContext *ic, AnalyzeThreadContext *at)
+{
+    unsigned i;
+
+    for (i = 0; i < ic->nb_streams; i++) {
+        AVStream *const st = ic->streams[i];
+        int needs = stream_needs_packets(ic, st);
+
+        if (needs != 2 && at->thread && ffstream(st)->info->decode_queue.head) {
+            analyze_threads_run(at);
+            needs = stream_needs_packets(ic, st);
+        }
+        if (needs)
+            break;
+    }
+    return i;
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     FFFormatContext *const si = ffformatcontext(ic);
@@ -2512,6 +2855,15 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t probesize = ic->probesize;
     int eof_reached = 0;
     int *missing_streams = av_opt_ptr(ic->iformat->priv_class, ic->priv_data, "missing_streams");
+    int64_t read_time = 0;
+    char *cache_url;
+    int cache_hit = 0;
+    AnalyzeThreadContext at = {
+        .ic              = ic,
+        .options         = options,
+        .orig_nb_streams = orig_nb_streams,
+        .start_time      = av_gettime_relative(),
+    };
 
     flush_codecs = probesize > 0;
 
@@ -2535,6 +2887,21 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                avio_tell(ic->pb), ctx->bytes_read, ctx->seek_count, ic->nb_streams);
     }
 
+    cache_url = ff_stream_info_cache_url(ic);
+    if (cache_url) {
+        ret = ff_stream_info_cache_load(ic, cache_url);
+        if (ret > 0) {
+            av_log(ic, AV_LOG_VERBOSE, "Stream info restored from %s\n", cache_url);
+            cache_hit = 1;
+            ret = 0;
+            goto update_streams;
+        }
+        if (ret < 0)
+            av_log(ic, AV_LOG_WARNING, "Could not read stream info cache %s: %s\n",
+                   cache_url, av_err2str(ret));
+        ret = 0;
+    }
+
     for (unsigned i = 0; i < ic->nb_streams; i++) {
         const AVCodec *codec;
         AVDictionary *thread_opt = NULL;
@@ -2591,9 +2958,21 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             av_dict_free(&thread_opt);
     }
 
+    if (ic->analyze_threads != 1) {
+        ret = avpriv_slicethread_create(&at.thread, &at, analyze_thread_worker,
+                                        NULL, ic->analyze_threads);
+        if (ret > 1) {
+            at.nb_threads = ret;
+            si->analyze_threads = &at;
+        } else
+            avpriv_slicethread_free(&at.thread);
+        ret = 0;
+    }
+
     read_size = 0;
     for (;;) {
         const AVPacket *pkt;
+        int64_t t;
         AVStream *st;
         FFStream *sti;
         AVCodecContext *avctx;
@@ -2606,49 +2985,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         }
 
         /* check if one codec still needs to be handled */
-        for (i = 0; i < ic->nb_streams; i++) {
-            AVStream *const st  = ic->streams[i];
-            FFStream *const sti = ffstream(st);
-            int fps_analyze_framecount = 20;
-            int count;
-
-            if (!has_codec_parameters(st, NULL))
-                break;
-            /* If the timebase is coarse (like the usual millisecond precision
-             * of mkv), we need to analyze more frames to reliably arrive at
-             * the correct fps. */
-            if (av_q2d(st->time_base) > 0.0005)
-                fps_analyze_framecount *= 2;
-            if (!tb_unreliable(ic, st))
-                fps_analyze_framecount = 0;
-            if (ic->fps_probe_size >= 0)
-                fps_analyze_framecount = ic->fps_probe_size;
-            if (st->disposition & AV_DISPOSITION_ATTACHED_PIC)
-                fps_analyze_framecount = 0;
-            /* variable fps and no guess at the real fps */
-            count = (ic->iformat->flags & AVFMT_NOTIMESTAMPS) ?
-                       sti->info->codec_info_duration_fields/2 :
-                       sti->info->duration_count;
-            if (!(st->r_frame_rate.num && st->avg_frame_rate.num) &&
-                st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                if (count < fps_analyze_framecount)
-                    break;
-            }
-            // Look at the first 3 frames if there is evidence of frame delay
-            // but the decoder delay is not set.
-            if (sti->info->frame_delay_evidence && count < 2 && sti->avctx->has_b_frames == 0)
-                break;
-            if (!sti->avctx->extradata &&
-                (!sti->extract_extradata.inited || sti->extract_extradata.bsf) &&
-                extract_extradata_check(st))
-                break;
-            if (sti->first_dts == AV_NOPTS_VALUE &&
-                (!(ic->iformat->flags & AVFMT_NOTIMESTAMPS) || sti->need_parsing == AVSTREAM_PARSE_FULL_RAW) &&
-                sti->codec_info_nb_frames < ((st->disposition & AV_DISPOSITION_ATTACHED_PIC) ? 1 : ic->max_ts_probe) &&
-                (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO ||
-                 st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO))
-                break;
-        }
+        i = find_incomplete_stream(ic, &at);
         analyzed_all_streams = 0;
         if (!missing_streams || !*missing_streams)
             if (i == ic->nb_streams) {
@@ -2684,7 +3021,9 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
         /* NOTE: A new stream can be added there if no header in file
          * (AVFMTCTX_NOHEADER). */
+        t = av_gettime_relative();
         ret = read_frame_internal(ic, pkt1);
+        read_time += av_gettime_relative() - t;
         if (ret == AVERROR(EAGAIN))
             continue;
 
@@ -2820,8 +3159,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+        if (at.thread) {
+            ret = analyze_threads_queue(&at, st, pkt);
+            if (ret < 0)
+                goto unref_then_goto_end;
+        } else
+            analyze_decode_packet(ic, st, pkt, sti->codec_info_nb_frames,
+                                  (options && i < orig_nb_streams) ? &options[i] : NULL,
+                                  at.start_time);
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(pkt1);
@@ -2830,6 +3175,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         count++;
     }
 
+    /* decode what is left of the last batch */
+    if (at.thread)
+        analyze_threads_run(&at);
+
     if (eof_reached) {
         for (unsigned stream_index = 0; stream_index < ic->nb_streams; stream_index++) {
             AVStream *const st = ic->streams[stream_index];
@@ -2860,15 +3209,21 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         int err = 0;
         av_packet_unref(empty_pkt);
 
-        for (unsigned i = 0; i < ic->nb_streams; i++) {
+        if (at.thread) {
+            ret = analyze_threads_flush(&at, empty_pkt);
+            if (ret < 0)
+                goto find_stream_info_err;
+        }
+
+        for (unsigned i = 0; i < ic->nb_streams && !at.thread; i++) {
             AVStream *const st  = ic->streams[i];
             FFStream *const sti = ffstream(st);
 
             /* flush the decoders */
             if (sti->info->found_decoder == 1) {
-                err = try_decode_frame(ic, st, empty_pkt,
-                                        (options && i < orig_nb_streams)
-                                        ? &options[i] : NULL);
+                err = analyze_decode_packet(ic, st, empty_pkt, sti->codec_info_nb_frames,
+                                            (options && i < orig_nb_streams)
+                                            ? &options[i] : NULL, at.start_time);
 
                 if (err < 0) {
                     av_log(ic, AV_LOG_INFO,
@@ -3010,6 +3365,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         }
     }
 
+update_streams:
     ret = compute_chapters_end(ic);
     if (ret < 0)
         goto find_stream_info_err;
@@ -3072,13 +3428,29 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
     }
 
+    /* Streams created while reading packets cannot be restored later. */
+    if (cache_url && !cache_hit && ic->nb_streams == orig_nb_streams) {
+        int err = ff_stream_info_cache_store(ic, cache_url);
+        if (err < 0)
+            av_log(ic, AV_LOG_WARNING, "Could not write stream info cache %s: %s\n",
+                   cache_url, av_err2str(err));
+    }
+
 find_stream_info_err:
+    if (!cache_hit)
+        log_analyze_stats(ic, &at, read_time);
+    si->analyze_threads = NULL;
+    avpriv_slicethread_free(&at.thread);
+    av_freep(&at.jobs);
+    av_freep(&cache_url);
+
     for (unsigned i = 0; i < ic->nb_streams; i++) {
         AVStream *const st  = ic->streams[i];
         FFStream *const sti = ffstream(st);
         int err;
 
         if (sti->info) {
+            avpriv_packet_list_free(&sti->info->decode_queue);
             av_freep(&sti->info->duration_error);
             av_freep(&sti->info);
         }
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include "libavutil/rational.h"
 #include "libavcodec/packet.h"
+#include "libavcodec/packet_internal.h"
 #include "avformat.h"
 
 struct AVDeviceInfoList;
@@ -162,6 +163,31 @@ typedef struct FFStreamInfo {
     int     fps_first_dts_idx;
     int64_t fps_last_dts;
     int     fps_last_dts_idx;
+
+    /**
+     * Packets waiting to be decoded by a worker thread when streams are
+     * analyzed in parallel.
+     */
+    PacketList decode_queue;
+    /**
+     * Number of packets of the stream read before the first queued one.
+     */
+    int decode_queue_first;
+
+    /**
+     * Number of packets passed to the decoder while analyzing.
+     */
+    int nb_decode_packets;
+
+    /**
+     * Statistics of the stream analysis: time spent decoding, time since
+     * the start of the analysis at which all codec parameters were known,
+     * both in microseconds, and the number of packets read until then
+     * (0 while the parameters are still unknown).
+     */
+    int64_t decode_time;
+    int64_t params_found_time;
+    int     params_found_packets;
 } FFStreamInfo;
 
 /**
@@ -249,6 +275,21 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
 
 void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance);
 
+/**
+ * Check whether the I/O buffers of s are worth configuring for its index,
+ * i.e. whether the input is not known to be local.
+ */
+int ff_buffers_configurable(AVFormatContext *s);
+
+/**
+ * Enlarge the I/O buffer of s so that samples of different streams up to
+ * pos_delta bytes apart can be read without seeking, and skip up to skip
+ * bytes by reading instead of seeking. This is the second half of
+ * ff_configure_buffers_for_index(), for demuxers that do not keep all
+ * samples in index_entries.
+ */
+void ff_configure_buffers(AVFormatContext *s, int64_t pos_delta, int64_t skip);
+
 /**
  * Ensure the index uses less memory than the maximum specified in
  * AVFormatContext.max_index_size by discarding entries if it grows
@@ -349,4 +390,30 @@ int ff_find_stream_index(const AVFormatContext *s, int id);
 
 int ff_buffer_packet(AVFormatContext *s, AVPacket *pkt);
 
+/**
+ * Get the location of the stream info cache entry for the input.
+ *
+ * The entry is identified by the file identity (path, device, inode, size
+ * and modification time), the demuxer, the analysis limits and the streams
+ * created when reading the header, so it must be called before any stream
+ * is analyzed.
+ *
+ * @return an allocated URL, or NULL if caching is disabled or the input
+ *         is not a local file
+ */
+char *ff_stream_info_cache_url(AVFormatContext *s);
+
+/**
+ * Restore the results of avformat_find_stream_info() from the cache.
+ *
+ * @return 1 if the streams were restored, 0 if there is no usable cache
+ *         entry, a negative AVERROR code on error
+ */
+int ff_stream_info_cache_load(AVFormatContext *s, const char *url);
+
+/**
+ * Store the results of avformat_find_stream_info() in the cache.
+ */
+int ff_stream_info_cache_store(AVFormatContext *s, const char *url);
+
 #endif /* AVFORMAT_DEMUX_H */
@@ -26,6 +26,7 @@
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
 #include "avio.h"
+#include "file_aio.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
 #endif
@@ -99,6 +100,11 @@ typedef struct FileContext {
     DIR *dir;
 #endif
     int64_t initial_pos;
+    int aio;
+    int aio_depth;
+    int aio_chunk_size;
+    int direct;
+    FileAIOContext *aio_ctx;
 } FileContext;
 
 static const AVOption file_options[] = {
@@ -106,6 +112,14 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "aio", "use asynchronous read-ahead and write-behind", offsetof(FileContext, aio), AV_OPT_TYPE_INT, { .i64 = FILE_AIO_NONE }, FILE_AIO_NONE, FILE_AIO_THREADS, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, .unit = "aio" },
+        { "none",     "synchronous I/O",                          0, AV_OPT_TYPE_CONST, { .i64 = FILE_AIO_NONE     }, 0, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, .unit = "aio" },
+        { "auto",     "io_uring if available, threads otherwise", 0, AV_OPT_TYPE_CONST, { .i64 = FILE_AIO_AUTO     }, 0, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, .unit = "aio" },
+        { "io_uring", "io_uring",                                 0, AV_OPT_TYPE_CONST, { .i64 = FILE_AIO_IO_URING }, 0, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, .unit = "aio" },
+        { "threads",  "a pool of I/O threads",                    0, AV_OPT_TYPE_CONST, { .i64 = FILE_AIO_THREADS  }, 0, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, .unit = "aio" },
+    { "aio_depth", "number of asynchronous requests in flight", offsetof(FileContext, aio_depth), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, 64, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "aio_chunk_size", "size of each asynchronous request", offsetof(FileContext, aio_chunk_size), AV_OPT_TYPE_INT, { .i64 = 1 << 20 }, FILE_AIO_ALIGN, 1 << 28, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "direct", "bypass the page cache for asynchronous reads", offsetof(FileContext, direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -141,6 +155,8 @@ static int file_read(URLContext *h, unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (CONFIG_FILE_PROTOCOL && c->aio_ctx)
+        return ff_file_aio_read(c->aio_ctx, buf, size);
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -154,6 +170,8 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (CONFIG_FILE_PROTOCOL && c->aio_ctx)
+        return ff_file_aio_write(c->aio_ctx, buf, size);
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
@@ -219,13 +237,16 @@ static int fd_dup(URLContext *h, int oldfd)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret;
+    int ret, aio_ret = 0;
+
+    if (CONFIG_FILE_PROTOCOL && c->aio_ctx)
+        aio_ret = ff_file_aio_close(&c->aio_ctx);
 
     if (c->initial_pos >= 0 && !h->is_streamed)
         lseek(c->fd, c->initial_pos, SEEK_SET);
 
     ret = close(c->fd);
-    return (ret == -1) ? AVERROR(errno) : 0;
+    return (ret == -1) ? AVERROR(errno) : aio_ret;
 }
 
 /* XXX: use llseek */
@@ -234,6 +255,9 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+    if (CONFIG_FILE_PROTOCOL && c->aio_ctx)
+        return ff_file_aio_seek(c->aio_ctx, pos, whence);
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -322,6 +346,23 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    /* The requests use positioned I/O, so this only works on regular files
+     * accessed in one direction. */
+    if (c->aio != FILE_AIO_NONE) {
+        if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || c->follow ||
+            (flags & AVIO_FLAG_READ_WRITE) == AVIO_FLAG_READ_WRITE) {
+            av_log(h, AV_LOG_WARNING, "Asynchronous I/O needs a regular file "
+                   "opened either for reading or for writing, using synchronous I/O\n");
+        } else {
+            int ret = ff_file_aio_open(&c->aio_ctx, h, fd, flags & AVIO_FLAG_WRITE,
+                                       c->aio, c->aio_depth, c->aio_chunk_size,
+                                       c->direct, 0);
+            if (ret < 0)
+                av_log(h, AV_LOG_WARNING, "Asynchronous I/O unavailable (%s), "
+                       "using synchronous I/O\n", av_err2str(ret));
+        }
+    }
+
     return 0;
 }
 
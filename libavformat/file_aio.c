@@ -0,0 +1,639 @@
+/*
+ * Asynchronous file I/O with read-ahead and write-behind
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* for O_DIRECT */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if CONFIG_LIBURING
+#include <liburing.h>
+#endif
+
+#include "libavutil/error.h"
+#include "libavutil/log.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+#include "avio.h"
+#include "file_aio.h"
+
+#define HAVE_AIO_THREADS (HAVE_THREADS && HAVE_PREAD)
+
+enum RequestState {
+    REQ_IDLE,
+    REQ_QUEUED,     ///< waiting for a worker thread
+    REQ_RUNNING,
+    REQ_DONE,
+};
+
+typedef struct FileAIORequest {
+    uint8_t *buf;
+    int64_t  offset;
+    int      size;              ///< number of bytes to transfer
+    int      done;              ///< number of bytes transferred so far
+    int      result;            ///< bytes transferred or AVERROR code, once done
+    enum RequestState state;
+} FileAIORequest;
+
+struct FileAIOContext {
+    void *logctx;
+    int fd;
+    int write;
+    int depth;
+    int chunk_size;
+
+    uint8_t *buffer;
+    FileAIORequest *reqs;
+    int head;                   ///< index of the oldest submitted request
+    int nb_submitted;           ///< number of submitted requests from head on
+
+    int64_t pos;                ///< file position as seen by the caller
+    int64_t next_offset;        ///< reading: offset of the next read to submit
+    FileAIORequest *fill;       ///< writing: request being filled, not submitted
+    int error;                  ///< writing: first error of a background write
+
+#if CONFIG_LIBURING
+    int uring_init;
+    int uring_stuck;            ///< requests may still be in flight in the kernel
+    struct io_uring ring;
+#endif
+#if HAVE_AIO_THREADS
+    int threads_init;
+    pthread_t *threads;
+    int nb_threads;
+    int abort;
+    pthread_mutex_t mutex;
+    pthread_cond_t  work_cond;  ///< signalled when a request is queued
+    pthread_cond_t  done_cond;  ///< signalled when a request completes
+#endif
+};
+
+#if CONFIG_LIBURING || HAVE_AIO_THREADS
+/**
+ * Account for a partial transfer of res bytes (or an error) and tell
+ * whether the request is complete. Reads stop short only at the end of
+ * the file.
+ */
+static int update_request(FileAIOContext *ctx, FileAIORequest *req, int res)
+{
+    if (res < 0) {
+        req->result = res;
+        return 1;
+    }
+    req->done += res;
+    if (req->done < req->size && res > 0)
+        return 0;
+    req->result = req->done;
+    if (ctx->write && req->done < req->size)
+        req->result = AVERROR(EIO);
+    return 1;
+}
+#endif
+
+#if CONFIG_LIBURING
+static int uring_init(FileAIOContext *ctx)
+{
+    int ret = io_uring_queue_init(ctx->depth, &ctx->ring, 0);
+    if (ret < 0)
+        return AVERROR(-ret);
+    ctx->uring_init = 1;
+    return 0;
+}
+
+static void uring_submit(FileAIOContext *ctx, FileAIORequest *req)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ctx->ring);
+    int ret;
+
+    if (!sqe) {
+        ret = AVERROR(EBUSY);
+        goto fail;
+    }
+    if (ctx->write)
+        io_uring_prep_write(sqe, ctx->fd, req->buf + req->done,
+                            req->size - req->done, req->offset + req->done);
+    else
+        io_uring_prep_read(sqe, ctx->fd, req->buf + req->done,
+                           req->size - req->done, req->offset + req->done);
+    io_uring_sqe_set_data(sqe, req);
+
+    ret = io_uring_submit(&ctx->ring);
+    if (ret >= 0)
+        return;
+    ret = AVERROR(-ret);
+fail:
+    req->result = ret;
+    req->state  = REQ_DONE;
+}
+
+/**
+ * Fail all requests in flight after the completion queue returned an error.
+ * They are cancelled and their completions reaped, as the kernel may write to
+ * their buffers until then.
+ */
+static void uring_cancel_all(FileAIOContext *ctx, int err)
+{
+    int nb_running = 0;
+
+    for (int i = 0; i < ctx->depth; i++) {
+        FileAIORequest *r = &ctx->reqs[i];
+        struct io_uring_sqe *sqe;
+
+        if (r->state != REQ_RUNNING)
+            continue;
+        nb_running++;
+
+        sqe = io_uring_get_sqe(&ctx->ring);
+        if (sqe) {
+            io_uring_prep_cancel(sqe, r, 0);
+            io_uring_sqe_set_data(sqe, NULL);
+        }
+    }
+    io_uring_submit(&ctx->ring);
+
+    /* a cancelled request completes with -ECANCELED, one that could not be
+     * cancelled anymore with its actual result */
+    while (nb_running) {
+        struct io_uring_cqe *cqe;
+        FileAIORequest *r;
+        int ret = io_uring_wait_cqe(&ctx->ring, &cqe);
+
+        if (ret == -EINTR)
+            continue;
+        if (ret < 0)
+            break;
+
+        r = io_uring_cqe_get_data(cqe);
+        io_uring_cqe_seen(&ctx->ring, cqe);
+        if (r && r->state == REQ_RUNNING) {
+            r->result = err;
+            r->state  = REQ_DONE;
+            nb_running--;
+        }
+    }
+
+    if (nb_running) {
+        av_log(ctx->logctx, AV_LOG_ERROR, "%d I/O requests could not be "
+               "cancelled, leaking their buffers\n", nb_running);
+        ctx->uring_stuck = 1;
+        for (int i = 0; i < ctx->depth; i++) {
+            if (ctx->reqs[i].state == REQ_RUNNING) {
+                ctx->reqs[i].result = err;
+                ctx->reqs[i].state  = REQ_DONE;
+            }
+        }
+    }
+}
+
+static void uring_wait(FileAIOContext *ctx, FileAIORequest *req)
+{
+    while (req->state != REQ_DONE) {
+        struct io_uring_cqe *cqe;
+        FileAIORequest *r;
+        int ret = io_uring_wait_cqe(&ctx->ring, &cqe);
+
+        if (ret == -EINTR)
+            continue;
+        if (ret < 0) {
+            uring_cancel_all(ctx, AVERROR(-ret));
+            break;
+        }
+
+        r   = io_uring_cqe_get_data(cqe);
+        ret = cqe->res;
+        io_uring_cqe_seen(&ctx->ring, cqe);
+
+        if (ret == -EINTR || ret == -EAGAIN)
+            uring_submit(ctx, r);
+        else if (update_request(ctx, r, ret < 0 ? AVERROR(-ret) : ret))
+            r->state = REQ_DONE;
+        else
+            uring_submit(ctx, r);
+    }
+}
+#endif /* CONFIG_LIBURING */
+
+#if HAVE_AIO_THREADS
+static int transfer(FileAIOContext *ctx, FileAIORequest *req)
+{
+    for (;;) {
+        uint8_t *buf   = req->buf    + req->done;
+        size_t   size  = req->size   - req->done;
+        off_t    off   = req->offset + req->done;
+        ssize_t  ret   = ctx->write ? pwrite(ctx->fd, buf, size, off)
+                                    : pread (ctx->fd, buf, size, off);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (update_request(ctx, req, ret < 0 ? AVERROR(errno) : ret))
+            return req->result;
+    }
+}
+
+static void *worker(void *arg)
+{
+    FileAIOContext *ctx = arg;
+
+    pthread_mutex_lock(&ctx->mutex);
+    for (;;) {
+        FileAIORequest *req = NULL;
+
+        for (int i = 0; i < ctx->depth && !req; i++)
+            if (ctx->reqs[i].state == REQ_QUEUED)
+                req = &ctx->reqs[i];
+        if (!req) {
+            if (ctx->abort)
+                break;
+            pthread_cond_wait(&ctx->work_cond, &ctx->mutex);
+            continue;
+        }
+
+        req->state = REQ_RUNNING;
+        pthread_mutex_unlock(&ctx->mutex);
+        transfer(ctx, req);
+        pthread_mutex_lock(&ctx->mutex);
+        req->state = REQ_DONE;
+        pthread_cond_broadcast(&ctx->done_cond);
+    }
+    pthread_mutex_unlock(&ctx->mutex);
+
+    return NULL;
+}
+#endif /* HAVE_AIO_THREADS */
+
+static int threads_init(FileAIOContext *ctx)
+{
+#if HAVE_AIO_THREADS
+    int ret;
+
+    if ((ret = pthread_mutex_init(&ctx->mutex, NULL)))
+        return AVERROR(ret);
+    if ((ret = pthread_cond_init(&ctx->work_cond, NULL))) {
+        pthread_mutex_destroy(&ctx->mutex);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&ctx->done_cond, NULL))) {
+        pthread_cond_destroy(&ctx->work_cond);
+        pthread_mutex_destroy(&ctx->mutex);
+        return AVERROR(ret);
+    }
+    ctx->threads_init = 1;
+
+    /* the transfers block, so one thread per request in flight */
+    ctx->threads = av_calloc(ctx->depth, sizeof(*ctx->threads));
+    if (!ctx->threads)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < ctx->depth; i++) {
+        ret = pthread_create(&ctx->threads[i], NULL, worker, ctx);
+        if (ret)
+            return AVERROR(ret);
+        ctx->nb_threads++;
+    }
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+static void submit(FileAIOContext *ctx, FileAIORequest *req)
+{
+    req->done   = 0;
+    req->result = 0;
+#if CONFIG_LIBURING
+    if (ctx->uring_init) {
+        req->state = REQ_RUNNING;
+        uring_submit(ctx, req);
+        return;
+    }
+#endif
+#if HAVE_AIO_THREADS
+    pthread_mutex_lock(&ctx->mutex);
+    req->state = REQ_QUEUED;
+    pthread_cond_signal(&ctx->work_cond);
+    pthread_mutex_unlock(&ctx->mutex);
+#endif
+}
+
+static int wait_request(FileAIOContext *ctx, FileAIORequest *req)
+{
+#if CONFIG_LIBURING
+    if (ctx->uring_init) {
+        uring_wait(ctx, req);
+        return req->result;
+    }
+#endif
+#if HAVE_AIO_THREADS
+    pthread_mutex_lock(&ctx->mutex);
+    while (req->state != REQ_DONE)
+        pthread_cond_wait(&ctx->done_cond, &ctx->mutex);
+    pthread_mutex_unlock(&ctx->mutex);
+#endif
+    return req->result;
+}
+
+static int retire_head(FileAIOContext *ctx)
+{
+    FileAIORequest *req = &ctx->reqs[ctx->head];
+    int ret = wait_request(ctx, req);
+
+    ctx->head  = (ctx->head + 1) % ctx->depth;
+    ctx->nb_submitted--;
+
+    if (ctx->write && ret < 0 && !ctx->error) {
+        av_log(ctx->logctx, AV_LOG_ERROR, "Error writing at offset %"PRId64": %s\n",
+               req->offset, av_err2str(ret));
+        ctx->error = ret;
+    }
+    return ret;
+}
+
+static void drain(FileAIOContext *ctx)
+{
+    while (ctx->nb_submitted)
+        retire_head(ctx);
+}
+
+/**
+ * Drop all reads and start reading ahead again from the current position.
+ */
+static void restart_reads(FileAIOContext *ctx)
+{
+    drain(ctx);
+    ctx->next_offset = ctx->pos & ~(int64_t)(FILE_AIO_ALIGN - 1);
+}
+
+static void read_ahead(FileAIOContext *ctx)
+{
+    while (ctx->nb_submitted < ctx->depth) {
+        FileAIORequest *req = &ctx->reqs[(ctx->head + ctx->nb_submitted) % ctx->depth];
+
+        req->offset = ctx->next_offset;
+        req->size   = ctx->chunk_size;
+        ctx->next_offset += ctx->chunk_size;
+        ctx->nb_submitted++;
+        submit(ctx, req);
+    }
+}
+
+static void submit_fill(FileAIOContext *ctx)
+{
+    if (!ctx->fill)
+        return;
+    ctx->nb_submitted++;
+    submit(ctx, ctx->fill);
+    ctx->fill = NULL;
+}
+
+static void enable_direct_io(FileAIOContext *ctx)
+{
+#if defined(O_DIRECT) && HAVE_FCNTL
+    int flags = fcntl(ctx->fd, F_GETFL);
+    if (flags == -1 || fcntl(ctx->fd, F_SETFL, flags | O_DIRECT) == -1)
+        av_log(ctx->logctx, AV_LOG_WARNING, "Could not enable O_DIRECT: %s\n",
+               av_err2str(AVERROR(errno)));
+#elif defined(F_NOCACHE)
+    if (fcntl(ctx->fd, F_NOCACHE, 1) == -1)
+        av_log(ctx->logctx, AV_LOG_WARNING, "Could not disable caching: %s\n",
+               av_err2str(AVERROR(errno)));
+#else
+    av_log(ctx->logctx, AV_LOG_WARNING, "Direct I/O is not supported on this system\n");
+#endif
+}
+
+int ff_file_aio_open(FileAIOContext **pctx, void *logctx, int fd, int write,
+                     enum FileAIOBackend backend, int depth, int chunk_size,
+                     int direct, int64_t pos)
+{
+    FileAIOContext *ctx;
+    uint8_t *base;
+    int ret;
+
+    ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    *pctx = ctx;
+
+    ctx->logctx     = logctx;
+    ctx->fd         = fd;
+    ctx->write      = write;
+    ctx->depth      = depth;
+    ctx->chunk_size = FFALIGN(chunk_size, FILE_AIO_ALIGN);
+    ctx->pos        = pos;
+    ctx->next_offset = pos & ~(int64_t)(FILE_AIO_ALIGN - 1);
+
+    ctx->buffer = av_malloc((size_t)ctx->chunk_size * depth + FILE_AIO_ALIGN - 1);
+    ctx->reqs   = av_calloc(depth, sizeof(*ctx->reqs));
+    if (!ctx->buffer || !ctx->reqs) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    base = (uint8_t *)FFALIGN((uintptr_t)ctx->buffer, FILE_AIO_ALIGN);
+    for (int i = 0; i < depth; i++)
+        ctx->reqs[i].buf = base + (size_t)i * ctx->chunk_size;
+
+    ret = AVERROR(ENOSYS);
+#if CONFIG_LIBURING
+    if (backend != FILE_AIO_THREADS) {
+        ret = uring_init(ctx);
+        if (ret < 0)
+            av_log(logctx, backend == FILE_AIO_AUTO ? AV_LOG_VERBOSE : AV_LOG_WARNING,
+                   "io_uring unavailable (%s), falling back to threads\n", av_err2str(ret));
+    }
+#else
+    if (backend == FILE_AIO_IO_URING)
+        av_log(logctx, AV_LOG_WARNING,
+               "io_uring support not compiled in, falling back to threads\n");
+#endif
+    if (ret < 0)
+        ret = threads_init(ctx);
+    if (ret < 0)
+        goto fail;
+
+    /* Only switch the descriptor to direct I/O once nothing can fail, as
+     * the synchronous fallback does not use aligned buffers. */
+    if (direct && !write)
+        enable_direct_io(ctx);
+
+    return 0;
+fail:
+    ff_file_aio_close(pctx);
+    return ret;
+}
+
+int ff_file_aio_read(FileAIOContext *ctx, uint8_t *buf, int size)
+{
+    for (;;) {
+        FileAIORequest *req;
+        int64_t end;
+        int ret;
+
+        read_ahead(ctx);
+        req = &ctx->reqs[ctx->head];
+        ret = wait_request(ctx, req);
+        if (ret < 0) {
+            restart_reads(ctx);
+            return ret;
+        }
+
+        end = req->offset + ret;
+        if (ctx->pos < end) {
+            int len = FFMIN(size, end - ctx->pos);
+            memcpy(buf, req->buf + (ctx->pos - req->offset), len);
+            ctx->pos += len;
+            return len;
+        }
+        if (ret < req->size) {
+            /* read again from here next time, in case the file grows */
+            restart_reads(ctx);
+            return AVERROR_EOF;
+        }
+        retire_head(ctx);
+    }
+}
+
+int ff_file_aio_write(FileAIOContext *ctx, const uint8_t *buf, int size)
+{
+    FileAIORequest *req = ctx->fill;
+    int len;
+
+    if (ctx->error)
+        return ctx->error;
+
+    if (!req) {
+        if (ctx->nb_submitted == ctx->depth && retire_head(ctx) < 0)
+            return ctx->error;
+        req = ctx->fill = &ctx->reqs[(ctx->head + ctx->nb_submitted) % ctx->depth];
+        req->offset = ctx->pos;
+        req->size   = 0;
+    }
+
+    len = FFMIN(size, ctx->chunk_size - req->size);
+    memcpy(req->buf + req->size, buf, len);
+    req->size += len;
+    ctx->pos  += len;
+
+    if (req->size == ctx->chunk_size)
+        submit_fill(ctx);
+
+    return len;
+}
+
+int64_t ff_file_aio_seek(FileAIOContext *ctx, int64_t pos, int whence)
+{
+    if (ctx->write) {
+        /* later writes must not overtake earlier ones to the same range */
+        submit_fill(ctx);
+        drain(ctx);
+        if (ctx->error)
+            return ctx->error;
+    }
+
+    switch (whence) {
+    case AVSEEK_SIZE:
+    case SEEK_END: {
+        struct stat st;
+        if (fstat(ctx->fd, &st) < 0)
+            return AVERROR(errno);
+        if (whence == AVSEEK_SIZE)
+            return st.st_size;
+        pos += st.st_size;
+        break;
+    }
+    case SEEK_CUR:
+        pos += ctx->pos;
+        break;
+    case SEEK_SET:
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    ctx->pos = pos;
+    if (!ctx->write) {
+        /* keep the reads that are still ahead of the new position */
+        while (ctx->nb_submitted && pos < ctx->next_offset &&
+               pos >= ctx->reqs[ctx->head].offset + ctx->chunk_size)
+            retire_head(ctx);
+        if (ctx->nb_submitted && (pos < ctx->reqs[ctx->head].offset ||
+                                  pos >= ctx->next_offset))
+            restart_reads(ctx);
+        else if (!ctx->nb_submitted)
+            ctx->next_offset = pos & ~(int64_t)(FILE_AIO_ALIGN - 1);
+    }
+
+    return pos;
+}
+
+int ff_file_aio_close(FileAIOContext **pctx)
+{
+    FileAIOContext *ctx = *pctx;
+    int ret;
+
+    if (!ctx)
+        return 0;
+
+    if (ctx->reqs) {
+        submit_fill(ctx);
+        drain(ctx);
+    }
+    ret = ctx->error;
+
+#if CONFIG_LIBURING
+    /* the kernel may still write to the ring and the buffers */
+    if (ctx->uring_stuck) {
+        ctx->buffer = NULL;
+        ctx->uring_init = 0;
+    }
+    if (ctx->uring_init)
+        io_uring_queue_exit(&ctx->ring);
+#endif
+#if HAVE_AIO_THREADS
+    if (ctx->threads_init) {
+        pthread_mutex_lock(&ctx->mutex);
+        ctx->abort = 1;
+        pthread_cond_broadcast(&ctx->work_cond);
+        pthread_mutex_unlock(&ctx->mutex);
+        for (int i = 0; i < ctx->nb_threads; i++)
+            pthread_join(ctx->threads[i], NULL);
+        pthread_cond_destroy(&ctx->done_cond);
+        pthread_cond_destroy(&ctx->work_cond);
+        pthread_mutex_destroy(&ctx->mutex);
+    }
+    av_freep(&ctx->threads);
+#endif
+    av_freep(&ctx->reqs);
+    av_freep(&ctx->buffer);
+    av_freep(pctx);
+
+    return ret;
+}
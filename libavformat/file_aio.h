@@ -0,0 +1,77 @@
+/*
+ * Asynchronous file I/O with read-ahead and write-behind
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_FILE_AIO_H
+#define AVFORMAT_FILE_AIO_H
+
+#include <stdint.h>
+
+/**
+ * Required alignment of file offsets, sizes and buffers for O_DIRECT.
+ */
+#define FILE_AIO_ALIGN 4096
+
+enum FileAIOBackend {
+    FILE_AIO_NONE,
+    FILE_AIO_AUTO,
+    FILE_AIO_IO_URING,
+    FILE_AIO_THREADS,
+};
+
+typedef struct FileAIOContext FileAIOContext;
+
+/**
+ * Set up asynchronous I/O on a regular file.
+ *
+ * Reading keeps up to depth reads of chunk_size bytes in flight ahead of
+ * the current position; writing collects data into chunks of chunk_size
+ * bytes and keeps up to depth of them being written in the background.
+ *
+ * @param fd         file descriptor, must stay open until ff_file_aio_close()
+ * @param write      nonzero to set up for writing, zero for reading
+ * @param backend    one of FILE_AIO_AUTO, FILE_AIO_IO_URING, FILE_AIO_THREADS
+ * @param chunk_size size of each request, rounded up to FILE_AIO_ALIGN
+ * @param direct     nonzero to bypass the page cache when reading, if the
+ *                   system supports it
+ * @param pos        initial file position
+ * @return 0 on success, a negative AVERROR code if no backend is available
+ */
+int ff_file_aio_open(FileAIOContext **pctx, void *logctx, int fd, int write,
+                     enum FileAIOBackend backend, int depth, int chunk_size,
+                     int direct, int64_t pos);
+
+int ff_file_aio_read(FileAIOContext *ctx, uint8_t *buf, int size);
+
+int ff_file_aio_write(FileAIOContext *ctx, const uint8_t *buf, int size);
+
+/**
+ * Seek like lseek(), with AVSEEK_SIZE also supported. When writing, all
+ * pending data is written out first.
+ */
+int64_t ff_file_aio_seek(FileAIOContext *ctx, int64_t pos, int whence);
+
+/**
+ * Write out pending data, wait for all requests and free the context.
+ *
+ * @return the first error of a background write, or 0
+ */
+int ff_file_aio_close(FileAIOContext **pctx);
+
+#endif /* AVFORMAT_FILE_AIO_H */
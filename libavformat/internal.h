@@ -183,6 +183,12 @@ typedef struct FFFormatContext {
      * Contexts and child contexts do not contain a metadata option
      */
     int metafree;
+
+    /**
+     * State of the parallel stream analysis while avformat_find_stream_info()
+     * decodes with several threads, NULL otherwise.
+     */
+    struct AnalyzeThreadContext *analyze_threads;
 } FFFormatContext;
 
 static av_always_inline FFFormatContext *ffformatcontext(AVFormatContext *s)
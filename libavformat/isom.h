@@ -164,6 +164,21 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * Position in the sample tables of a track, used to resolve samples on
+ * demand instead of building a full index.
+ */
+typedef struct MOVSampleCursor {
+    unsigned int sample;       ///< sample number
+    unsigned int chunk;        ///< chunk containing the sample
+    unsigned int chunk_sample; ///< sample number within the chunk
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    int64_t offset;            ///< file offset of the sample
+    int64_t dts;
+} MOVSampleCursor;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int refcount;
@@ -267,6 +282,13 @@ typedef struct MOVStreamContext {
     } cenc;
 
     struct IAMFDemuxContext *iamf;
+
+    int index_pending;    ///< index building deferred until the end of the moov atom
+    int lazy_index;       ///< samples are resolved from the sample tables, index_entries is unused
+    unsigned int lazy_nb_samples;
+    MOVSampleCursor lazy_cursor;
+    MOVSampleCursor *lazy_checkpoints; ///< cursor state every MOV_LAZY_INDEX_INTERVAL samples
+    AVIndexEntry lazy_entry;           ///< last sample returned by the lazy index
 } MOVStreamContext;
 
 typedef struct HEIFItem {
@@ -356,6 +378,9 @@ typedef struct MOVContext {
     int thmb_item_id;
     int64_t idat_offset;
     int interleaved_read;
+    int in_moov;
+    int index_threads;
+    int lazy_index;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
@@ -45,6 +45,7 @@
 #include "libavutil/aes_ctr.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/sha.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/spherical.h"
 #include "libavutil/stereo3d.h"
 #include "libavutil/timecode.h"
@@ -84,6 +85,7 @@ typedef struct MOVParseTableEntry {
 static int mov_read_default(MOVContext *c, AVIOContext *pb, MOVAtom atom);
 static int mov_read_mfra(MOVContext *c, AVIOContext *f);
 static void mov_free_stream_context(AVFormatContext *s, AVStream *st);
+static int mov_build_pending_indexes(MOVContext *c);
 static int64_t add_ctts_entry(MOVCtts** ctts_data, unsigned int* ctts_count, unsigned int* allocated_size,
                               int count, int duration);
 
@@ -1430,7 +1432,12 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     }
 
-    if ((ret = mov_read_default(c, pb, atom)) < 0)
+    c->in_moov++;
+    ret = mov_read_default(c, pb, atom);
+    c->in_moov--;
+    if (ret < 0)
+        return ret;
+    if ((ret = mov_build_pending_indexes(c)) < 0)
         return ret;
     /* we parsed the 'moov' atom, we can terminate the parsing as soon as we find the 'mdat' */
     /* so we don't parse the whole file if over a network */
@@ -3887,6 +3894,45 @@ static int64_t add_ctts_entry(MOVCtts** ctts_data, unsigned int* ctts_count, uns
 }
 
 #define MAX_REORDER_DELAY 16
+
+/**
+ * Insert a pts into the circular buffer of the last MAX_REORDER_DELAY + 1
+ * timestamps, keeping it sorted.
+ *
+ * @return number of positions the pts had to be moved by
+ */
+static int mov_reorder_pts(int64_t *pts_buf, int *buf_start, int64_t pts)
+{
+    int j, r, num_swaps = 0;
+
+    // Point j to the last elem of the buffer and insert the current pts there.
+    j = *buf_start;
+    *buf_start = *buf_start + 1;
+    if (*buf_start == MAX_REORDER_DELAY + 1)
+        *buf_start = 0;
+
+    pts_buf[j] = pts;
+
+    // The timestamps that are already in the sorted buffer, and are greater than the
+    // current pts, are exactly the timestamps that need to be buffered to output PTS
+    // in correct sorted order.
+    // Hence the video delay (which is the buffer size used to sort DTS and output PTS),
+    // can be computed as the maximum no. of swaps any particular timestamp needs to
+    // go through, to keep this buffer in sorted order.
+    while (j != *buf_start) {
+        r = j - 1;
+        if (r < 0) r = MAX_REORDER_DELAY;
+        if (pts_buf[j] < pts_buf[r]) {
+            FFSWAP(int64_t, pts_buf[j], pts_buf[r]);
+            ++num_swaps;
+        } else {
+            break;
+        }
+        j = r;
+    }
+    return num_swaps;
+}
+
 static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
 {
     MOVStreamContext *msc = st->priv_data;
@@ -3895,7 +3941,7 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
     int ctts_sample = 0;
     int64_t pts_buf[MAX_REORDER_DELAY + 1]; // Circular buffer to sort pts.
     int buf_start = 0;
-    int j, r, num_swaps;
+    int j, num_swaps;
 
     for (j = 0; j < MAX_REORDER_DELAY + 1; j++)
         pts_buf[j] = INT64_MIN;
@@ -3904,32 +3950,8 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
         st->codecpar->codec_id == AV_CODEC_ID_H264) {
         st->codecpar->video_delay = 0;
         for (int ind = 0; ind < sti->nb_index_entries && ctts_ind < msc->ctts_count; ++ind) {
-            // Point j to the last elem of the buffer and insert the current pts there.
-            j = buf_start;
-            buf_start = (buf_start + 1);
-            if (buf_start == MAX_REORDER_DELAY + 1)
-                buf_start = 0;
-
-            pts_buf[j] = sti->index_entries[ind].timestamp + msc->ctts_data[ctts_ind].duration;
-
-            // The timestamps that are already in the sorted buffer, and are greater than the
-            // current pts, are exactly the timestamps that need to be buffered to output PTS
-            // in correct sorted order.
-            // Hence the video delay (which is the buffer size used to sort DTS and output PTS),
-            // can be computed as the maximum no. of swaps any particular timestamp needs to
-            // go through, to keep this buffer in sorted order.
-            num_swaps = 0;
-            while (j != buf_start) {
-                r = j - 1;
-                if (r < 0) r = MAX_REORDER_DELAY;
-                if (pts_buf[j] < pts_buf[r]) {
-                    FFSWAP(int64_t, pts_buf[j], pts_buf[r]);
-                    ++num_swaps;
-                } else {
-                    break;
-                }
-                j = r;
-            }
+            num_swaps = mov_reorder_pts(pts_buf, &buf_start,
+                                        sti->index_entries[ind].timestamp + msc->ctts_data[ctts_ind].duration);
             st->codecpar->video_delay = FFMAX(st->codecpar->video_delay, num_swaps);
 
             ctts_sample++;
@@ -4371,6 +4393,454 @@ static int build_open_gop_key_points(AVStream *st)
     return 0;
 }
 
+/* number of samples between two saved cursor states of a lazy index */
+#define MOV_LAZY_INDEX_INTERVAL 1024
+
+static unsigned int mov_lazy_sample_size(const MOVStreamContext *sc, unsigned int sample)
+{
+    return sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[sample];
+}
+
+static void mov_lazy_enter_chunk(const MOVStreamContext *sc, MOVSampleCursor *cur)
+{
+    while (mov_stsc_index_valid(cur->stsc_index, sc->stsc_count) &&
+           cur->chunk + 1 == sc->stsc_data[cur->stsc_index + 1].first)
+        cur->stsc_index++;
+    cur->offset       = sc->chunk_offsets[cur->chunk];
+    cur->chunk_sample = 0;
+}
+
+/* Step over the current sample, without moving on to the next chunk. */
+static void mov_lazy_cursor_step(const MOVStreamContext *sc, MOVSampleCursor *cur)
+{
+    cur->offset += mov_lazy_sample_size(sc, cur->sample);
+    cur->dts    += sc->stts_data[cur->stts_index].duration;
+    cur->sample++;
+    cur->chunk_sample++;
+    if (cur->stts_index + 1 < sc->stts_count &&
+        ++cur->stts_sample == sc->stts_data[cur->stts_index].count) {
+        cur->stts_sample = 0;
+        cur->stts_index++;
+    }
+}
+
+/* Move the cursor to the next sample, which must exist. */
+static void mov_lazy_cursor_next(const MOVStreamContext *sc, MOVSampleCursor *cur)
+{
+    mov_lazy_cursor_step(sc, cur);
+    while (cur->chunk_sample >= sc->stsc_data[cur->stsc_index].count &&
+           cur->chunk + 1 < sc->chunk_count) {
+        cur->chunk++;
+        mov_lazy_enter_chunk(sc, cur);
+    }
+}
+
+static void mov_lazy_cursor_seek(MOVStreamContext *sc, unsigned int sample)
+{
+    MOVSampleCursor *cur = &sc->lazy_cursor;
+
+    if (sample < cur->sample ||
+        sample / MOV_LAZY_INDEX_INTERVAL != cur->sample / MOV_LAZY_INDEX_INTERVAL)
+        *cur = sc->lazy_checkpoints[sample / MOV_LAZY_INDEX_INTERVAL];
+    while (cur->sample < sample)
+        mov_lazy_cursor_next(sc, cur);
+}
+
+/* Compute the dts of a sample from the time-to-sample table alone. */
+static int64_t mov_lazy_sample_dts(const MOVStreamContext *sc, unsigned int sample)
+{
+    const MOVSampleCursor *cp = &sc->lazy_checkpoints[sample / MOV_LAZY_INDEX_INTERVAL];
+    unsigned int stts_index  = cp->stts_index;
+    unsigned int stts_sample = cp->stts_sample;
+    unsigned int left = sample - cp->sample;
+    int64_t dts = cp->dts;
+
+    while (left) {
+        unsigned int n = left;
+        if (stts_index + 1 < sc->stts_count)
+            n = FFMIN(n, sc->stts_data[stts_index].count - stts_sample);
+        dts  += (int64_t)n * sc->stts_data[stts_index].duration;
+        left -= n;
+        if (left) {
+            stts_index++;
+            stts_sample = 0;
+        }
+    }
+    return dts;
+}
+
+/**
+ * Find the first keyframe at or after a sample, or the last one at or
+ * before it if backward is set.
+ *
+ * @return sample number of the keyframe, -1 if there is none
+ */
+static int mov_lazy_find_keyframe(const AVStream *st, int sample, int backward)
+{
+    const MOVStreamContext *sc = st->priv_data;
+    unsigned int key_off = sc->keyframe_count && sc->keyframes[0] > 0;
+    unsigned int target, lo = 0, hi = sc->keyframe_count;
+
+    if (sample < 0 || sample >= sc->lazy_nb_samples)
+        return -1;
+
+    if (sc->keyframe_absent) {
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+            return sample;
+        /* only the first sample of the first chunk is a keyframe */
+        if (sc->lazy_checkpoints[0].chunk)
+            return -1;
+        return backward || !sample ? 0 : -1;
+    }
+    if (!sc->keyframe_count)
+        return sample;
+
+    target = sample + key_off;
+    while (lo < hi) {
+        unsigned int mid = (lo + hi) >> 1;
+        if ((unsigned)sc->keyframes[mid] < target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < sc->keyframe_count && (unsigned)sc->keyframes[lo] == target)
+        return sample;
+    if (backward)
+        return lo ? sc->keyframes[lo - 1] - key_off : -1;
+    if (lo == sc->keyframe_count ||
+        (unsigned)sc->keyframes[lo] - key_off >= sc->lazy_nb_samples)
+        return -1;
+    return sc->keyframes[lo] - key_off;
+}
+
+/**
+ * Resolve a sample of a lazily indexed track. The returned entry stays valid
+ * until the next call for the same track.
+ */
+static AVIndexEntry *mov_lazy_get_sample(AVStream *st, unsigned int sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *e = &sc->lazy_entry;
+
+    mov_lazy_cursor_seek(sc, sample);
+    e->pos          = sc->lazy_cursor.offset;
+    e->timestamp    = sc->lazy_cursor.dts;
+    e->size         = mov_lazy_sample_size(sc, sample);
+    e->min_distance = 0;
+    e->flags        = mov_lazy_find_keyframe(st, sample, 0) == sample ? AVINDEX_KEYFRAME : 0;
+    return e;
+}
+
+/* Same as ff_index_search_timestamp() on the samples of a lazy index. */
+static int mov_lazy_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
+{
+    const MOVStreamContext *sc = st->priv_data;
+    int nb_samples = sc->lazy_nb_samples;
+    int a = -1, b = nb_samples, m;
+
+    if (b && mov_lazy_sample_dts(sc, b - 1) < wanted_timestamp)
+        a = b - 1;
+
+    while (b - a > 1) {
+        int64_t timestamp;
+
+        m = (a + b) >> 1;
+        timestamp = mov_lazy_sample_dts(sc, m);
+        if (timestamp >= wanted_timestamp)
+            b = m;
+        if (timestamp <= wanted_timestamp)
+            a = m;
+    }
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        m = mov_lazy_find_keyframe(st, m, flags & AVSEEK_FLAG_BACKWARD);
+
+    if (m == nb_samples)
+        return -1;
+    return m;
+}
+
+/**
+ * Walk the sample tables once to check that they can be resolved on demand
+ * and to derive what mov_build_index() would compute from the full index.
+ */
+static int mov_lazy_index_init(MOVContext *mov, AVStream *st, int64_t current_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVSampleCursor cur = { .dts = current_dts };
+    MOVSampleCursor *checkpoints;
+    unsigned int nb_checkpoints = 0;
+    unsigned int ctts_ind = 0, ctts_sample = 0;
+    int64_t pts_buf[MAX_REORDER_DELAY + 1];
+    int buf_start = 0, video_delay = -1;
+    uint64_t stream_size = 0;
+
+    if (st->codecpar->video_delay <= 0 && sc->ctts_data &&
+        st->codecpar->codec_id == AV_CODEC_ID_H264) {
+        for (int i = 0; i < MAX_REORDER_DELAY + 1; i++)
+            pts_buf[i] = INT64_MIN;
+        video_delay = 0;
+    }
+
+    checkpoints = av_malloc_array(sc->sample_count / MOV_LAZY_INDEX_INTERVAL + 1,
+                                  sizeof(*checkpoints));
+    if (!checkpoints)
+        return AVERROR(ENOMEM);
+
+    for (; cur.chunk < sc->chunk_count; cur.chunk++) {
+        int64_t next_offset = cur.chunk + 1 < sc->chunk_count ? sc->chunk_offsets[cur.chunk + 1] : INT64_MAX;
+
+        mov_lazy_enter_chunk(sc, &cur);
+        /* leave invalid stsz sample sizes to the full index */
+        if ((next_offset > cur.offset && sc->sample_size > 0 && sc->sample_size < sc->stsz_sample_size &&
+             sc->stsc_data[cur.stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - cur.offset) ||
+            (sc->stsz_sample_size > 0 && sc->stsz_sample_size < sc->sample_size))
+            goto fail;
+
+        while (cur.chunk_sample < sc->stsc_data[cur.stsc_index].count) {
+            unsigned int sample_size;
+
+            if (cur.sample >= sc->sample_count)
+                goto fail;
+            sample_size = mov_lazy_sample_size(sc, cur.sample);
+            if (cur.offset > INT64_MAX - sample_size || sample_size > 0x3FFFFFFF)
+                goto fail;
+
+            if (!(cur.sample % MOV_LAZY_INDEX_INTERVAL))
+                checkpoints[nb_checkpoints++] = cur;
+
+            if (video_delay >= 0 && ctts_ind < sc->ctts_count) {
+                int num_swaps = mov_reorder_pts(pts_buf, &buf_start,
+                                                cur.dts + sc->ctts_data[ctts_ind].duration);
+                video_delay = FFMAX(video_delay, num_swaps);
+                if (++ctts_sample == sc->ctts_data[ctts_ind].count) {
+                    ctts_ind++;
+                    ctts_sample = 0;
+                }
+            }
+
+            stream_size += sample_size;
+            mov_lazy_cursor_step(sc, &cur);
+        }
+    }
+    if (!cur.sample)
+        goto fail;
+
+    sc->lazy_checkpoints = checkpoints;
+    sc->lazy_nb_samples  = cur.sample;
+    sc->lazy_cursor      = checkpoints[0];
+
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: resolving %u samples on demand\n",
+           st->index, sc->lazy_nb_samples);
+
+    if (st->duration > 0)
+        st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
+
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        cur = checkpoints[0];
+        for (unsigned int i = 0; i < FFMIN(99, sc->lazy_nb_samples); i++) {
+            if (i)
+                mov_lazy_cursor_next(sc, &cur);
+            ff_rfps_add_frame(mov->fc, st, cur.dts);
+        }
+
+        if (st->start_time == AV_NOPTS_VALUE) {
+            st->start_time = checkpoints[0].dts + sc->dts_shift;
+            if (sc->ctts_data && sc->ctts_count)
+                st->start_time += sc->ctts_data[0].duration;
+        }
+
+        if (video_delay >= 0) {
+            st->codecpar->video_delay = video_delay;
+            av_log(mov->fc, AV_LOG_DEBUG, "Setting codecpar->delay to %d for stream st: %d\n",
+                   st->codecpar->video_delay, st->index);
+        }
+    }
+
+    return 0;
+fail:
+    av_free(checkpoints);
+    return AVERROR_INVALIDDATA;
+}
+
+/**
+ * Turn a lazy index into a regular one, for code that needs to modify the
+ * index entries.
+ */
+static int mov_lazy_index_expand(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    MOVCtts *ctts_data = NULL;
+    unsigned int ctts_count = 0, ctts_allocated_size = 0;
+    AVIndexEntry *entries;
+
+    entries = av_malloc_array(sc->lazy_nb_samples, sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+
+    // Expand ctts entries such that we have a 1-1 mapping with samples
+    if (sc->ctts_data) {
+        ctts_data = av_fast_realloc(NULL, &ctts_allocated_size,
+                                    sc->sample_count * sizeof(*ctts_data));
+        if (!ctts_data) {
+            av_free(entries);
+            return AVERROR(ENOMEM);
+        }
+        memset(ctts_data, 0, ctts_allocated_size);
+        for (unsigned int i = 0; i < sc->ctts_count && ctts_count < sc->sample_count; i++)
+            for (unsigned int j = 0; j < sc->ctts_data[i].count && ctts_count < sc->sample_count; j++)
+                add_ctts_entry(&ctts_data, &ctts_count, &ctts_allocated_size,
+                               1, sc->ctts_data[i].duration);
+        av_free(sc->ctts_data);
+        sc->ctts_data           = ctts_data;
+        sc->ctts_count          = ctts_count;
+        sc->ctts_allocated_size = ctts_allocated_size;
+    }
+
+    for (unsigned int i = 0; i < sc->lazy_nb_samples; i++)
+        entries[i] = *mov_lazy_get_sample(st, i);
+
+    sti->index_entries                = entries;
+    sti->nb_index_entries             = sc->lazy_nb_samples;
+    sti->index_entries_allocated_size = sc->lazy_nb_samples * sizeof(*entries);
+
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: building the full index\n", st->index);
+
+    sc->lazy_index = 0;
+    av_freep(&sc->lazy_checkpoints);
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+
+    return 0;
+}
+
+static int mov_get_nb_samples(const AVStream *st)
+{
+    const MOVStreamContext *sc = st->priv_data;
+    return sc->lazy_index ? sc->lazy_nb_samples : cffstream(st)->nb_index_entries;
+}
+
+static AVIndexEntry *mov_get_sample(AVStream *st, int sample)
+{
+    const MOVStreamContext *sc = st->priv_data;
+    if (sc->lazy_index)
+        return mov_lazy_get_sample(st, sample);
+    return &ffstream(st)->index_entries[sample];
+}
+
+static int64_t mov_get_sample_dts(const AVStream *st, int sample)
+{
+    const MOVStreamContext *sc = st->priv_data;
+    if (sc->lazy_index)
+        return mov_lazy_sample_dts(sc, sample);
+    return cffstream(st)->index_entries[sample].timestamp;
+}
+
+/* Sequential walk over the samples of a track, with or without a lazy index. */
+typedef struct MOVSampleWalk {
+    AVStream *st;
+    MOVSampleCursor cur;
+    int sample;
+    int nb_samples;
+    int64_t pos;
+    int64_t timestamp;
+    int size;
+} MOVSampleWalk;
+
+static void mov_sample_walk_load(MOVSampleWalk *w)
+{
+    const MOVStreamContext *sc = w->st->priv_data;
+
+    if (w->sample >= w->nb_samples)
+        return;
+    if (sc->lazy_index) {
+        w->pos       = w->cur.offset;
+        w->timestamp = w->cur.dts;
+        w->size      = mov_lazy_sample_size(sc, w->sample);
+    } else {
+        const AVIndexEntry *e = &cffstream(w->st)->index_entries[w->sample];
+        w->pos       = e->pos;
+        w->timestamp = e->timestamp;
+        w->size      = e->size;
+    }
+}
+
+static void mov_sample_walk_init(MOVSampleWalk *w, AVStream *st)
+{
+    const MOVStreamContext *sc = st->priv_data;
+
+    w->st         = st;
+    w->sample     = 0;
+    w->nb_samples = mov_get_nb_samples(st);
+    if (sc->lazy_index && w->nb_samples)
+        w->cur = sc->lazy_checkpoints[0];
+    mov_sample_walk_load(w);
+}
+
+static void mov_sample_walk_next(MOVSampleWalk *w)
+{
+    const MOVStreamContext *sc = w->st->priv_data;
+
+    if (++w->sample < w->nb_samples && sc->lazy_index)
+        mov_lazy_cursor_next(sc, &w->cur);
+    mov_sample_walk_load(w);
+}
+
+/**
+ * Same as ff_configure_buffers_for_index(), but also taking the samples of
+ * tracks with a lazy index into account, which have no index entries.
+ */
+static void mov_configure_buffers(AVFormatContext *s, int64_t time_tolerance)
+{
+    int64_t pos_delta = 0, skip = 0;
+    int lazy = 0;
+
+    for (unsigned i = 0; i < s->nb_streams; i++)
+        lazy |= ((MOVStreamContext *)s->streams[i]->priv_data)->lazy_index;
+    if (!lazy) {
+        ff_configure_buffers_for_index(s, time_tolerance);
+        return;
+    }
+
+    if (!ff_buffers_configurable(s))
+        return;
+
+    for (unsigned ist1 = 0; ist1 < s->nb_streams; ist1++) {
+        for (unsigned ist2 = 0; ist2 < s->nb_streams; ist2++) {
+            MOVSampleWalk w1, w2;
+
+            if (ist1 == ist2)
+                continue;
+
+            mov_sample_walk_init(&w1, s->streams[ist1]);
+            mov_sample_walk_init(&w2, s->streams[ist2]);
+            for (; w1.sample < w1.nb_samples; mov_sample_walk_next(&w1)) {
+                int64_t e1_pts = av_rescale_q(w1.timestamp, w1.st->time_base, AV_TIME_BASE_Q);
+
+                if (w1.size < (1 << 23))
+                    skip = FFMAX(skip, w1.size);
+
+                for (; w2.sample < w2.nb_samples; mov_sample_walk_next(&w2)) {
+                    int64_t e2_pts = av_rescale_q(w2.timestamp, w2.st->time_base, AV_TIME_BASE_Q);
+                    int64_t cur_delta;
+                    if (e2_pts < e1_pts || e2_pts - (uint64_t)e1_pts < time_tolerance)
+                        continue;
+                    cur_delta = FFABS(w1.pos - w2.pos);
+                    if (cur_delta < (1 << 23))
+                        pos_delta = FFMAX(pos_delta, cur_delta);
+                    break;
+                }
+            }
+        }
+    }
+
+    ff_configure_buffers(s, pos_delta, skip);
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -4454,6 +4924,11 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
 
         if (!sc->sample_count || sti->nb_index_entries)
             return;
+        if (sc->lazy_index) {
+            if (mov_lazy_index_init(mov, st, current_dts) >= 0)
+                return;
+            sc->lazy_index = 0;
+        }
         if (sc->sample_count >= UINT_MAX / sizeof(*sti->index_entries) - sti->nb_index_entries)
             return;
         if (av_reallocp_array(&sti->index_entries,
@@ -4854,6 +5329,127 @@ static int mov_update_iamf_streams(MOVContext *c, const AVStream *st)
     return 0;
 }
 
+/* Free the sample tables which are not needed once the index is built. */
+static void mov_free_sample_tables(MOVStreamContext *sc)
+{
+    if (!sc->lazy_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+    }
+    av_freep(&sc->stps_data);
+    av_freep(&sc->elst_data);
+    av_freep(&sc->rap_group);
+    av_freep(&sc->sync_group);
+    av_freep(&sc->sgpd_sync);
+}
+
+/**
+ * Check whether the samples of a track can be resolved from its sample
+ * tables with the same result as building the full index.
+ */
+static int mov_lazy_index_usable(const MOVContext *c, const AVStream *st)
+{
+    const MOVStreamContext *sc = st->priv_data;
+
+    if (st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
+        st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+        return 0;
+    /* fragments, edits and extra random access information modify the index */
+    if (c->trex_count || sc->iamf || sc->stps_count ||
+        sc->rap_group_count || sc->sync_group_count)
+        return 0;
+    if (sc->elst_count && !c->ignore_editlist && c->advanced_editlist)
+        return 0;
+    if (!sc->sample_count || !sc->chunk_count || !sc->stsc_count || !sc->stts_count ||
+        (!sc->stsz_sample_size && !sc->sample_sizes))
+        return 0;
+    /* old uncompressed audio chunk demuxing */
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+        sc->stts_count == 1 && sc->stts_data[0].duration == 1)
+        return 0;
+
+    for (unsigned int i = 0; i < c->nb_chapter_tracks; i++)
+        if (c->chapter_tracks[i] == sc->id)
+            return 0;
+    if (sc->pseudo_stream_id != -1)
+        for (unsigned int i = 0; i < sc->stsc_count; i++)
+            if (sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+                return 0;
+    for (unsigned int i = 0; i + 1 < sc->stts_count; i++)
+        if (!sc->stts_data[i].count)
+            return 0;
+    for (unsigned int i = 1; i < sc->keyframe_count; i++)
+        if ((unsigned)sc->keyframes[i] <= (unsigned)sc->keyframes[i - 1])
+            return 0;
+
+    return 1;
+}
+
+typedef struct MOVIndexJobs {
+    MOVContext *c;
+    AVStream **streams;
+} MOVIndexJobs;
+
+static void mov_build_index_worker(void *priv, int jobnr, int threadnr,
+                                   int nb_jobs, int nb_threads)
+{
+    MOVIndexJobs *jobs = priv;
+    AVStream *st = jobs->streams[jobnr];
+
+    mov_build_index(jobs->c, st);
+    mov_free_sample_tables(st->priv_data);
+}
+
+/**
+ * Build the index of all tracks whose index building was deferred, using
+ * several threads if requested. The tracks are independent of each other.
+ */
+static int mov_build_pending_indexes(MOVContext *c)
+{
+    MOVIndexJobs jobs = { .c = c };
+    AVSliceThread *thread = NULL;
+    int nb_jobs = 0;
+
+    for (unsigned int i = 0; i < c->fc->nb_streams; i++) {
+        MOVStreamContext *sc = c->fc->streams[i]->priv_data;
+        nb_jobs += sc->index_pending;
+    }
+    if (!nb_jobs)
+        return 0;
+
+    jobs.streams = av_malloc_array(nb_jobs, sizeof(*jobs.streams));
+    if (!jobs.streams)
+        return AVERROR(ENOMEM);
+
+    nb_jobs = 0;
+    for (unsigned int i = 0; i < c->fc->nb_streams; i++) {
+        AVStream *st = c->fc->streams[i];
+        MOVStreamContext *sc = st->priv_data;
+
+        if (!sc->index_pending)
+            continue;
+        sc->index_pending = 0;
+        sc->lazy_index    = c->lazy_index && mov_lazy_index_usable(c, st);
+        jobs.streams[nb_jobs++] = st;
+    }
+
+    if (nb_jobs > 1 && c->index_threads != 1 &&
+        avpriv_slicethread_create(&thread, &jobs, mov_build_index_worker,
+                                  NULL, c->index_threads ? FFMIN(c->index_threads, nb_jobs) : 0) > 1) {
+        avpriv_slicethread_execute(thread, nb_jobs, 0);
+    } else {
+        for (int i = 0; i < nb_jobs; i++)
+            mov_build_index_worker(&jobs, i, 0, nb_jobs, 1);
+    }
+
+    avpriv_slicethread_free(&thread);
+    av_free(jobs.streams);
+
+    return 0;
+}
+
 static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     AVStream *st;
@@ -4908,6 +5504,10 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
      * In these files, trun atoms may be streamed in.
      */
     if (!sc->stts_count && c->advanced_editlist) {
+        /* tracks before this one are still expected to use the edit lists */
+        ret = mov_build_pending_indexes(c);
+        if (ret < 0)
+            return ret;
 
         av_log(c->fc, AV_LOG_VERBOSE, "advanced_editlist does not work with fragmented "
                                       "MP4. disabling.\n");
@@ -4915,7 +5515,12 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         c->advanced_editlist_autodisabled = 1;
     }
 
-    mov_build_index(c, st);
+    /* build the index at the end of the moov atom, when all tracks and
+     * movie-level boxes are known */
+    if (c->in_moov && !sc->iamf && (c->index_threads != 1 || c->lazy_index))
+        sc->index_pending = 1;
+    else
+        mov_build_index(c, st);
 
     if (sc->iamf) {
         ret = mov_update_iamf_streams(c, st);
@@ -4991,16 +5596,8 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             ffstream(st)->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
-    av_freep(&sc->elst_data);
-    av_freep(&sc->rap_group);
-    av_freep(&sc->sync_group);
-    av_freep(&sc->sgpd_sync);
+    if (!sc->index_pending)
+        mov_free_sample_tables(sc);
 
     return 0;
 }
@@ -5473,7 +6070,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts, pts = AV_NOPTS_VALUE;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i;
+    int flags, distance, i, ret;
     int64_t prev_dts = AV_NOPTS_VALUE;
     int next_frag_index = -1, index_entry_pos;
     size_t requested_size;
@@ -5501,6 +6098,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if (sc->lazy_index && (ret = mov_lazy_index_expand(c, st)) < 0)
+        return ret;
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -9044,6 +9643,7 @@ static void mov_free_stream_context(AVFormatContext *s, AVStream *st)
     av_freep(&sc->open_key_samples);
     av_freep(&sc->display_matrix);
     av_freep(&sc->index_ranges);
+    av_freep(&sc->lazy_checkpoints);
 
     if (sc->extradata)
         for (int i = 0; i < sc->stsd_count; i++)
@@ -9755,7 +10355,7 @@ static int mov_read_header(AVFormatContext *s)
             break;
         }
     }
-    ff_configure_buffers_for_index(s, AV_TIME_BASE);
+    mov_configure_buffers(s, AV_TIME_BASE);
 
     for (i = 0; i < mov->frag_index.nb_items; i++)
         if (mov->frag_index.item[i].moof_offset <= mov->fragment.moof_offset)
@@ -9773,10 +10373,9 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     int no_interleave = !mov->interleaved_read || !(s->pb->seekable & AVIO_SEEKABLE_NORMAL);
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
-        FFStream *const avsti = ffstream(avst);
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avsti->nb_index_entries) {
-            AVIndexEntry *current_sample = &avsti->index_entries[msc->current_sample];
+        if (msc->pb && msc->current_sample < mov_get_nb_samples(avst)) {
+            AVIndexEntry *current_sample = mov_get_sample(avst, msc->current_sample);
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             uint64_t dtsdiff = best_dts > dts ? best_dts - (uint64_t)dts : ((uint64_t)dts - best_dts);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
@@ -9902,8 +10501,8 @@ static int mov_finalize_packet(AVFormatContext *s, AVStream *st, AVIndexEntry *s
             sc->ctts_sample = 0;
         }
     } else {
-        int64_t next_dts = (sc->current_sample < ffstream(st)->nb_index_entries) ?
-            ffstream(st)->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample < mov_get_nb_samples(st)) ?
+            mov_get_sample_dts(st, sc->current_sample) : st->duration;
 
         if (next_dts >= pkt->dts)
             pkt->duration = next_dts - pkt->dts;
@@ -10103,7 +10702,6 @@ static int is_open_key_sample(const MOVStreamContext *sc, int sample)
 static int can_seek_to_key_sample(AVStream *st, int sample, int64_t requested_pts)
 {
     MOVStreamContext *sc = st->priv_data;
-    FFStream *const sti = ffstream(st);
     int64_t key_sample_dts, key_sample_pts;
 
     if (st->codecpar->codec_id != AV_CODEC_ID_HEVC)
@@ -10112,7 +10710,7 @@ static int can_seek_to_key_sample(AVStream *st, int sample, int64_t requested_pt
     if (sample >= sc->sample_offsets_count)
         return 1;
 
-    key_sample_dts = sti->index_entries[sample].timestamp;
+    key_sample_dts = mov_get_sample_dts(st, sample);
     key_sample_pts = key_sample_dts + sc->sample_offsets[sample] + sc->dts_shift;
 
     /*
@@ -10129,7 +10727,6 @@ static int can_seek_to_key_sample(AVStream *st, int sample, int64_t requested_pt
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
-    FFStream *const sti = ffstream(st);
     int sample, time_sample, ret;
     unsigned int i;
 
@@ -10142,9 +10739,12 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
         return ret;
 
     for (;;) {
-        sample = av_index_search_timestamp(st, timestamp, flags);
+        if (sc->lazy_index)
+            sample = mov_lazy_search_timestamp(st, timestamp, flags);
+        else
+            sample = av_index_search_timestamp(st, timestamp, flags);
         av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-        if (sample < 0 && sti->nb_index_entries && timestamp < sti->index_entries[0].timestamp)
+        if (sample < 0 && mov_get_nb_samples(st) && timestamp < mov_get_sample_dts(st, 0))
             sample = 0;
         if (sample < 0) /* not sure what to do */
             return AVERROR_INVALIDDATA;
@@ -10191,9 +10791,8 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
 static int64_t mov_get_skip_samples(AVStream *st, int sample)
 {
     MOVStreamContext *sc = st->priv_data;
-    FFStream *const sti = ffstream(st);
-    int64_t first_ts = sti->index_entries[0].timestamp;
-    int64_t ts = sti->index_entries[sample].timestamp;
+    int64_t first_ts = mov_get_sample_dts(st, 0);
+    int64_t ts = mov_get_sample_dts(st, sample);
     int64_t off;
 
     if (st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
@@ -10209,7 +10808,6 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 {
     MOVContext *mc = s->priv_data;
     AVStream *st;
-    FFStream *sti;
     int sample;
     int i;
 
@@ -10217,15 +10815,14 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return AVERROR_INVALIDDATA;
 
     st = s->streams[stream_index];
-    sti = ffstream(st);
     sample = mov_seek_stream(s, st, sample_time, flags);
     if (sample < 0)
         return sample;
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = sti->index_entries[sample].timestamp;
-        sti->skip_samples = mov_get_skip_samples(st, sample);
+        int64_t seek_timestamp = mov_get_sample_dts(st, sample);
+        ffstream(st)->skip_samples = mov_get_skip_samples(st, sample);
 
         for (i = 0; i < s->nb_streams; i++) {
             AVStream *const st  = s->streams[i];
@@ -10312,6 +10909,8 @@ static const AVOption mov_options[] = {
         {.i64 = 0}, 0, 1, FLAGS },
     { "max_stts_delta", "treat offsets above this value as invalid", OFFSET(max_stts_delta), AV_OPT_TYPE_INT, {.i64 = UINT_MAX-48000*10 }, 0, UINT_MAX, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "interleaved_read", "Interleave packets from multiple tracks at demuxer level", OFFSET(interleaved_read), AV_OPT_TYPE_BOOL, {.i64 = 1 }, 0, 1, .flags = AV_OPT_FLAG_DECODING_PARAM },
+    { "index_threads", "Number of threads used to build the track indexes (0 = auto)", OFFSET(index_threads), AV_OPT_TYPE_INT, {.i64 = 1 }, 0, INT_MAX, .flags = AV_OPT_FLAG_DECODING_PARAM },
+    { "lazy_index", "Resolve sample positions from the sample tables on demand instead of building a full index", OFFSET(lazy_index), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, .flags = AV_OPT_FLAG_DECODING_PARAM },
 
     { NULL },
 };
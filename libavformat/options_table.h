@@ -108,6 +108,8 @@ static const AVOption avformat_options[] = {
 {"max_streams", "maximum number of streams", OFFSET(max_streams), AV_OPT_TYPE_INT, { .i64 = 1000 }, 0, INT_MAX, D },
 {"skip_estimate_duration_from_pts", "skip duration calculation in estimate_timings_from_pts", OFFSET(skip_estimate_duration_from_pts), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, D},
 {"max_probe_packets", "Maximum number of packets to probe a codec", OFFSET(max_probe_packets), AV_OPT_TYPE_INT, { .i64 = 2500 }, 0, INT_MAX, D },
+{"analyze_threads", "number of threads decoding streams in parallel during stream analysis, at most one per stream", OFFSET(analyze_threads), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, INT_MAX, D },
+{"stream_info_cache", "directory in which to cache the results of stream analysis", OFFSET(stream_info_cache), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
 {NULL},
 };
 
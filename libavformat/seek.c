@@ -170,15 +170,10 @@ int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
     return m;
 }
 
-void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
+int ff_buffers_configurable(AVFormatContext *s)
 {
-    int64_t pos_delta = 0;
-    int64_t skip = 0;
     //We could use URLProtocol flags here but as many user applications do not use URLProtocols this would be unreliable
     const char *proto = avio_find_protocol_name(s->url);
-    FFIOContext *ctx;
-
-    av_assert0(time_tolerance >= 0);
 
     if (!proto) {
         av_log(s, AV_LOG_INFO,
@@ -187,7 +182,38 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
                "optimally without knowing the protocol\n");
     }
 
-    if (proto && !(strcmp(proto, "file") && strcmp(proto, "pipe") && strcmp(proto, "cache")))
+    return !proto || (strcmp(proto, "file") && strcmp(proto, "pipe") && strcmp(proto, "cache"));
+}
+
+void ff_configure_buffers(AVFormatContext *s, int64_t pos_delta, int64_t skip)
+{
+    FFIOContext *ctx = ffiocontext(s->pb);
+
+    pos_delta *= 2;
+    /* XXX This could be adjusted depending on protocol*/
+    if (s->pb->buffer_size < pos_delta) {
+        av_log(s, AV_LOG_VERBOSE, "Reconfiguring buffers to size %"PRId64"\n", pos_delta);
+
+        /* realloc the buffer and the original data will be retained */
+        if (ffio_realloc_buf(s->pb, pos_delta)) {
+            av_log(s, AV_LOG_ERROR, "Realloc buffer fail.\n");
+            return;
+        }
+
+        ctx->short_seek_threshold = FFMAX(ctx->short_seek_threshold, pos_delta/2);
+    }
+
+    ctx->short_seek_threshold = FFMAX(ctx->short_seek_threshold, skip);
+}
+
+void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
+{
+    int64_t pos_delta = 0;
+    int64_t skip = 0;
+
+    av_assert0(time_tolerance >= 0);
+
+    if (!ff_buffers_configurable(s))
         return;
 
     for (unsigned ist1 = 0; ist1 < s->nb_streams; ist1++) {
@@ -222,22 +248,7 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
         }
     }
 
-    pos_delta *= 2;
-    ctx = ffiocontext(s->pb);
-    /* XXX This could be adjusted depending on protocol*/
-    if (s->pb->buffer_size < pos_delta) {
-        av_log(s, AV_LOG_VERBOSE, "Reconfiguring buffers to size %"PRId64"\n", pos_delta);
-
-        /* realloc the buffer and the original data will be retained */
-        if (ffio_realloc_buf(s->pb, pos_delta)) {
-            av_log(s, AV_LOG_ERROR, "Realloc buffer fail.\n");
-            return;
-        }
-
-        ctx->short_seek_threshold = FFMAX(ctx->short_seek_threshold, pos_delta/2);
-    }
-
-    ctx->short_seek_threshold = FFMAX(ctx->short_seek_threshold, skip);
+    ff_configure_buffers(s, pos_delta, skip);
 }
 
 int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
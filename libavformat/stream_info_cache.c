@@ -0,0 +1,444 @@
+/*
+ * Cache of avformat_find_stream_info() results
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+/* for st_mtim */
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#include <sys/stat.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/mem.h"
+#include "libavutil/random_seed.h"
+#include "libavutil/sha.h"
+#include "libavcodec/avcodec.h"
+#include "libavcodec/codec_par.h"
+#include "libavcodec/packet.h"
+
+#include "avformat.h"
+#include "avio_internal.h"
+#include "demux.h"
+#include "internal.h"
+#include "os_support.h"
+#include "url.h"
+#include "version.h"
+
+#define CACHE_MAGIC   MKBETAG('F', 'F', 'S', 'I')
+#define CACHE_VERSION 1
+
+#define MAX_EXTRADATA_SIZE (1 << 28)
+#define MAX_CHANNELS       (1 << 16)
+
+typedef struct CachedStream {
+    AVCodecParameters *par;
+    int64_t    start_time;
+    int64_t    duration;
+    int64_t    nb_frames;
+    int        disposition;
+    AVRational sample_aspect_ratio;
+    AVRational avg_frame_rate;
+    AVRational r_frame_rate;
+    int        codec_info_nb_frames;
+} CachedStream;
+
+char *ff_stream_info_cache_url(AVFormatContext *s)
+{
+    const char *proto, *path = s->url;
+    uint8_t digest[20];
+    char hex[2 * sizeof(digest) + 1];
+    struct AVSHA *sha;
+    struct stat st;
+    int64_t mtime_nsec = 0;
+    AVBPrint bp;
+
+    if (!s->stream_info_cache || !*s->stream_info_cache || !s->pb)
+        return NULL;
+
+    /* Only local files have an identity that can be checked cheaply. */
+    proto = avio_find_protocol_name(s->url);
+    if (!proto || strcmp(proto, "file"))
+        return NULL;
+    av_strstart(path, "file:", &path);
+    if (stat(path, &st) < 0 || !S_ISREG(st.st_mode))
+        return NULL;
+#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+
+    sha = av_sha_alloc();
+    if (!sha)
+        return NULL;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&bp, "%s\n%"PRIu64" %"PRIu64" %"PRId64" %"PRId64".%09"PRId64"\n",
+               path, (uint64_t)st.st_dev, (uint64_t)st.st_ino,
+               (int64_t)st.st_size, (int64_t)st.st_mtime, mtime_nsec);
+    /* results depend on the demuxer, the analysis limits and the streams
+     * the header created */
+    av_bprintf(&bp, "%s %"PRId64" %"PRId64" %d %d %d %d\n",
+               s->iformat->name, s->probesize, s->max_analyze_duration,
+               s->fps_probe_size, s->max_ts_probe, s->max_probe_packets,
+               s->flags & (AVFMT_FLAG_NOPARSE | AVFMT_FLAG_IGNDTS | AVFMT_FLAG_GENPTS));
+    for (unsigned i = 0; i < s->nb_streams; i++) {
+        const AVStream *const st = s->streams[i];
+        av_bprintf(&bp, "%d %d %d %d/%d\n", st->id, st->codecpar->codec_type,
+                   st->codecpar->codec_id, st->time_base.num, st->time_base.den);
+    }
+
+    if (!av_bprint_is_complete(&bp)) {
+        av_bprint_finalize(&bp, NULL);
+        av_free(sha);
+        return NULL;
+    }
+
+    av_sha_init(sha, 160);
+    av_sha_update(sha, bp.str, bp.len);
+    av_sha_final(sha, digest);
+    av_bprint_finalize(&bp, NULL);
+    av_free(sha);
+
+    ff_data_to_hex(hex, digest, sizeof(digest), 1);
+    hex[2 * sizeof(digest)] = 0;
+
+    return av_asprintf("%s/%s.ffsi", s->stream_info_cache, hex);
+}
+
+static void write_rational(AVIOContext *pb, AVRational q)
+{
+    avio_wb32(pb, q.num);
+    avio_wb32(pb, q.den);
+}
+
+static AVRational read_rational(AVIOContext *pb)
+{
+    AVRational q;
+    q.num = avio_rb32(pb);
+    q.den = avio_rb32(pb);
+    return q;
+}
+
+static void write_codecpar(AVIOContext *pb, const AVCodecParameters *par)
+{
+    const AVChannelLayout *const ch_layout = &par->ch_layout;
+
+    avio_wb32(pb, par->codec_type);
+    avio_wb32(pb, par->codec_id);
+    avio_wb32(pb, par->codec_tag);
+    avio_wb32(pb, par->format);
+    avio_wb64(pb, par->bit_rate);
+    avio_wb32(pb, par->bits_per_coded_sample);
+    avio_wb32(pb, par->bits_per_raw_sample);
+    avio_wb32(pb, par->profile);
+    avio_wb32(pb, par->level);
+    avio_wb32(pb, par->width);
+    avio_wb32(pb, par->height);
+    write_rational(pb, par->sample_aspect_ratio);
+    write_rational(pb, par->framerate);
+    avio_wb32(pb, par->field_order);
+    avio_wb32(pb, par->color_range);
+    avio_wb32(pb, par->color_primaries);
+    avio_wb32(pb, par->color_trc);
+    avio_wb32(pb, par->color_space);
+    avio_wb32(pb, par->chroma_location);
+    avio_wb32(pb, par->video_delay);
+    avio_wb32(pb, par->sample_rate);
+    avio_wb32(pb, par->block_align);
+    avio_wb32(pb, par->frame_size);
+    avio_wb32(pb, par->initial_padding);
+    avio_wb32(pb, par->trailing_padding);
+    avio_wb32(pb, par->seek_preroll);
+
+    avio_wb32(pb, ch_layout->order);
+    avio_wb32(pb, ch_layout->nb_channels);
+    if (ch_layout->order == AV_CHANNEL_ORDER_CUSTOM) {
+        for (int i = 0; i < ch_layout->nb_channels; i++)
+            avio_wb32(pb, ch_layout->u.map[i].id);
+    } else {
+        avio_wb64(pb, ch_layout->u.mask);
+    }
+
+    avio_wb32(pb, par->extradata_size);
+    avio_write(pb, par->extradata, par->extradata_size);
+
+    avio_wb32(pb, par->nb_coded_side_data);
+    for (int i = 0; i < par->nb_coded_side_data; i++) {
+        const AVPacketSideData *const sd = &par->coded_side_data[i];
+        avio_wb32(pb, sd->type);
+        avio_wb32(pb, sd->size);
+        avio_write(pb, sd->data, sd->size);
+    }
+}
+
+static int read_codecpar(void *logctx, AVIOContext *pb, AVCodecParameters *par)
+{
+    AVChannelLayout *const ch_layout = &par->ch_layout;
+    int order, nb_channels, size, nb_side_data, ret;
+
+    par->codec_type            = avio_rb32(pb);
+    par->codec_id              = avio_rb32(pb);
+    par->codec_tag             = avio_rb32(pb);
+    par->format                = avio_rb32(pb);
+    par->bit_rate              = avio_rb64(pb);
+    par->bits_per_coded_sample = avio_rb32(pb);
+    par->bits_per_raw_sample   = avio_rb32(pb);
+    par->profile               = avio_rb32(pb);
+    par->level                 = avio_rb32(pb);
+    par->width                 = avio_rb32(pb);
+    par->height                = avio_rb32(pb);
+    par->sample_aspect_ratio   = read_rational(pb);
+    par->framerate             = read_rational(pb);
+    par->field_order           = avio_rb32(pb);
+    par->color_range           = avio_rb32(pb);
+    par->color_primaries       = avio_rb32(pb);
+    par->color_trc             = avio_rb32(pb);
+    par->color_space           = avio_rb32(pb);
+    par->chroma_location       = avio_rb32(pb);
+    par->video_delay           = avio_rb32(pb);
+    par->sample_rate           = avio_rb32(pb);
+    par->block_align           = avio_rb32(pb);
+    par->frame_size            = avio_rb32(pb);
+    par->initial_padding       = avio_rb32(pb);
+    par->trailing_padding      = avio_rb32(pb);
+    par->seek_preroll          = avio_rb32(pb);
+
+    order       = avio_rb32(pb);
+    nb_channels = avio_rb32(pb);
+    if (nb_channels < 0 || nb_channels > MAX_CHANNELS)
+        return AVERROR_INVALIDDATA;
+    av_channel_layout_uninit(ch_layout);
+    if (order == AV_CHANNEL_ORDER_CUSTOM) {
+        ret = av_channel_layout_custom_init(ch_layout, nb_channels);
+        if (ret < 0)
+            return ret;
+        for (int i = 0; i < nb_channels; i++)
+            ch_layout->u.map[i].id = avio_rb32(pb);
+    } else {
+        ch_layout->order       = order;
+        ch_layout->nb_channels = nb_channels;
+        ch_layout->u.mask      = avio_rb64(pb);
+    }
+    if (nb_channels && !av_channel_layout_check(ch_layout))
+        return AVERROR_INVALIDDATA;
+
+    size = avio_rb32(pb);
+    if (size < 0 || size > MAX_EXTRADATA_SIZE)
+        return AVERROR_INVALIDDATA;
+    if (size) {
+        ret = ff_get_extradata(logctx, par, pb, size);
+        if (ret < 0)
+            return ret;
+    }
+
+    nb_side_data = avio_rb32(pb);
+    if (nb_side_data < 0 || nb_side_data > AV_PKT_DATA_NB)
+        return AVERROR_INVALIDDATA;
+    for (int i = 0; i < nb_side_data; i++) {
+        enum AVPacketSideDataType type = avio_rb32(pb);
+        AVPacketSideData *sd;
+
+        size = avio_rb32(pb);
+        if ((unsigned)type >= AV_PKT_DATA_NB ||
+            size < 0 || size > MAX_EXTRADATA_SIZE)
+            return AVERROR_INVALIDDATA;
+        sd = av_packet_side_data_new(&par->coded_side_data, &par->nb_coded_side_data,
+                                     type, size, 0);
+        if (!sd)
+            return AVERROR(ENOMEM);
+        if (avio_read(pb, sd->data, size) != size)
+            return AVERROR_INVALIDDATA;
+    }
+
+    return 0;
+}
+
+int ff_stream_info_cache_load(AVFormatContext *s, const char *url)
+{
+    CachedStream *streams = NULL;
+    AVIOContext *pb = NULL;
+    int64_t start_time, duration, bit_rate;
+    int duration_estimation_method;
+    unsigned nb_streams;
+    int ret;
+
+    ret = ffio_open_whitelist(&pb, url, AVIO_FLAG_READ, &s->interrupt_callback,
+                              NULL, s->protocol_whitelist, s->protocol_blacklist);
+    if (ret < 0)
+        return ret == AVERROR(ENOENT) ? 0 : ret;
+
+    if (avio_rb32(pb) != CACHE_MAGIC ||
+        avio_rb32(pb) != CACHE_VERSION ||
+        avio_rb32(pb) != LIBAVFORMAT_VERSION_INT ||
+        avio_rb32(pb) != avcodec_version()) {
+        ret = 0;
+        goto end;
+    }
+
+    /* Streams the demuxer did not create when reading the header cannot
+     * be restored. */
+    nb_streams = avio_rb32(pb);
+    if (nb_streams != s->nb_streams) {
+        ret = 0;
+        goto end;
+    }
+
+    start_time                 = avio_rb64(pb);
+    duration                   = avio_rb64(pb);
+    bit_rate                   = avio_rb64(pb);
+    duration_estimation_method = avio_rb32(pb);
+
+    streams = av_calloc(nb_streams, sizeof(*streams));
+    if (!streams) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (unsigned i = 0; i < nb_streams; i++) {
+        CachedStream *const cs = &streams[i];
+
+        cs->start_time           = avio_rb64(pb);
+        cs->duration             = avio_rb64(pb);
+        cs->nb_frames            = avio_rb64(pb);
+        cs->disposition          = avio_rb32(pb);
+        cs->sample_aspect_ratio  = read_rational(pb);
+        cs->avg_frame_rate       = read_rational(pb);
+        cs->r_frame_rate         = read_rational(pb);
+        cs->codec_info_nb_frames = avio_rb32(pb);
+
+        cs->par = avcodec_parameters_alloc();
+        if (!cs->par) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = read_codecpar(s, pb, cs->par);
+        if (ret < 0)
+            goto fail;
+    }
+    if (avio_rb32(pb) != CACHE_MAGIC || pb->eof_reached || pb->error) {
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
+    }
+
+    /* Everything was read successfully, now update the context. */
+    for (unsigned i = 0; i < nb_streams; i++) {
+        const CachedStream *const cs = &streams[i];
+        AVStream *const st  = s->streams[i];
+        FFStream *const sti = ffstream(st);
+
+        ret = avcodec_parameters_copy(st->codecpar, cs->par);
+        if (ret < 0)
+            goto end;
+
+        st->start_time          = cs->start_time;
+        st->duration            = cs->duration;
+        st->nb_frames           = cs->nb_frames;
+        st->disposition         = cs->disposition;
+        st->sample_aspect_ratio = cs->sample_aspect_ratio;
+        st->avg_frame_rate      = cs->avg_frame_rate;
+        st->r_frame_rate        = cs->r_frame_rate;
+
+        sti->codec_info_nb_frames = cs->codec_info_nb_frames;
+        sti->need_context_update  = 1;
+        /* the codec is known, do not probe it from the packet data again */
+        if (sti->request_probe > 0) {
+            sti->request_probe = -1;
+            sti->probe_packets = 0;
+            av_freep(&sti->probe_data.buf);
+            sti->probe_data.buf_size = 0;
+        }
+    }
+    s->start_time                 = start_time;
+    s->duration                   = duration;
+    s->bit_rate                   = bit_rate;
+    s->duration_estimation_method = duration_estimation_method;
+    ret = 1;
+    goto end;
+
+fail:
+    av_log(s, AV_LOG_WARNING, "Ignoring invalid stream info cache file %s\n", url);
+    ret = 0;
+end:
+    if (streams) {
+        for (unsigned i = 0; i < nb_streams; i++)
+            avcodec_parameters_free(&streams[i].par);
+        av_free(streams);
+    }
+    avio_closep(&pb);
+    return ret;
+}
+
+int ff_stream_info_cache_store(AVFormatContext *s, const char *url)
+{
+    AVIOContext *pb = NULL;
+    char *tmp_url;
+    int ret;
+
+    ret = ff_mkdir_p(s->stream_info_cache);
+    if (ret < 0 && errno != EEXIST)
+        return AVERROR(errno);
+
+    /* Write to a unique temporary file first so that concurrent readers
+     * and writers never see a partial file. */
+    tmp_url = av_asprintf("%s.%08"PRIx32".tmp", url, av_get_random_seed());
+    if (!tmp_url)
+        return AVERROR(ENOMEM);
+
+    ret = ffio_open_whitelist(&pb, tmp_url, AVIO_FLAG_WRITE, &s->interrupt_callback,
+                              NULL, s->protocol_whitelist, s->protocol_blacklist);
+    if (ret < 0)
+        goto end;
+
+    avio_wb32(pb, CACHE_MAGIC);
+    avio_wb32(pb, CACHE_VERSION);
+    avio_wb32(pb, LIBAVFORMAT_VERSION_INT);
+    avio_wb32(pb, avcodec_version());
+
+    avio_wb32(pb, s->nb_streams);
+    avio_wb64(pb, s->start_time);
+    avio_wb64(pb, s->duration);
+    avio_wb64(pb, s->bit_rate);
+    avio_wb32(pb, s->duration_estimation_method);
+
+    for (unsigned i = 0; i < s->nb_streams; i++) {
+        const AVStream *const st = s->streams[i];
+
+        avio_wb64(pb, st->start_time);
+        avio_wb64(pb, st->duration);
+        avio_wb64(pb, st->nb_frames);
+        avio_wb32(pb, st->disposition);
+        write_rational(pb, st->sample_aspect_ratio);
+        write_rational(pb, st->avg_frame_rate);
+        write_rational(pb, st->r_frame_rate);
+        avio_wb32(pb, cffstream(st)->codec_info_nb_frames);
+        write_codecpar(pb, st->codecpar);
+    }
+    avio_wb32(pb, CACHE_MAGIC);
+
+    ret = avio_closep(&pb);
+    if (ret >= 0)
+        ret = ff_rename(tmp_url, url, s);
+    if (ret < 0)
+        ffurl_delete(tmp_url);
+
+end:
+    av_free(tmp_url);
+    return ret;
+}
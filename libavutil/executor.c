@@ -17,11 +17,13 @@
  * License along with FFmpeg; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include "error.h"
 #include "internal.h"
 #include "mem.h"
 #include "thread.h"
 
 #include "executor.h"
+#include "executor_internal.h"
 
 #if !HAVE_THREADS
 
@@ -199,3 +201,131 @@ void av_executor_execute(AVExecutor *e, AVTask *t)
         /* nothing */;
 #endif
 }
+
+struct FFSharedExecutor {
+    AVExecutor *e;
+    int thread_count;
+    unsigned refs;
+};
+
+// protects shared_executor and the references to all shared executors
+static AVMutex shared_lock = AV_MUTEX_INITIALIZER;
+static FFSharedExecutor *shared_executor;
+
+static int shared_priority_higher(const AVTask *a, const AVTask *b)
+{
+    // keep submission order
+    return 1;
+}
+
+static int shared_ready(const AVTask *t, void *user_data)
+{
+    return 1;
+}
+
+static int shared_run(AVTask *t, void *local_context, void *user_data)
+{
+    FFSharedTask *st = (FFSharedTask*)t;
+    st->run(st);
+    return 0;
+}
+
+static void shared_unref_locked(FFSharedExecutor **pse)
+{
+    FFSharedExecutor *se = *pse;
+
+    *pse = NULL;
+    if (!se || --se->refs)
+        return;
+    av_executor_free(&se->e);
+    av_free(se);
+}
+
+FFSharedExecutor *avpriv_executor_shared_alloc(int thread_count)
+{
+    const AVTaskCallbacks cb = {
+        .user_data       = &shared_executor,
+        .priority_higher = shared_priority_higher,
+        .ready           = shared_ready,
+        .run             = shared_run,
+    };
+    FFSharedExecutor *se;
+
+    if (!HAVE_THREADS || thread_count <= 0)
+        return NULL;
+
+    se = av_mallocz(sizeof(*se));
+    if (!se)
+        return NULL;
+    se->e = av_executor_alloc(&cb, thread_count);
+    if (!se->e) {
+        av_free(se);
+        return NULL;
+    }
+    se->thread_count = thread_count;
+    se->refs         = 1;
+
+    return se;
+}
+
+int av_executor_set_shared_thread_count(int thread_count)
+{
+    FFSharedExecutor *se = NULL;
+
+    if (thread_count < 0)
+        return AVERROR(EINVAL);
+#if !HAVE_THREADS
+    if (thread_count)
+        return AVERROR(ENOSYS);
+#endif
+
+    if (thread_count) {
+        se = avpriv_executor_shared_alloc(thread_count);
+        if (!se)
+            return AVERROR(ENOMEM);
+    }
+
+    ff_mutex_lock(&shared_lock);
+    shared_unref_locked(&shared_executor);
+    shared_executor = se;
+    ff_mutex_unlock(&shared_lock);
+
+    return 0;
+}
+
+FFSharedExecutor *ff_executor_shared_ref(int *thread_count)
+{
+    FFSharedExecutor *se;
+
+    ff_mutex_lock(&shared_lock);
+    se = shared_executor;
+    if (se) {
+        se->refs++;
+        *thread_count = se->thread_count;
+    }
+    ff_mutex_unlock(&shared_lock);
+
+    return se;
+}
+
+FFSharedExecutor *ff_executor_shared_addref(FFSharedExecutor *se, int *thread_count)
+{
+    ff_mutex_lock(&shared_lock);
+    se->refs++;
+    *thread_count = se->thread_count;
+    ff_mutex_unlock(&shared_lock);
+
+    return se;
+}
+
+void avpriv_executor_shared_unref(FFSharedExecutor **se)
+{
+    ff_mutex_lock(&shared_lock);
+    shared_unref_locked(se);
+    ff_mutex_unlock(&shared_lock);
+}
+
+void ff_executor_shared_execute(FFSharedExecutor *se, FFSharedTask *t)
+{
+    av_executor_execute(se->e, &t->task);
+}
@@ -64,4 +64,18 @@ void av_executor_free(AVExecutor **e);
  */
 void av_executor_execute(AVExecutor *e, AVTask *t);
 
+/**
+ * Set the number of worker threads of the process-wide shared executor.
+ *
+ * While a shared executor is configured, slice threading contexts created in
+ * libavcodec and libavfilter run their jobs on its worker threads instead of
+ * spawning threads of their own, so the total number of slice worker threads
+ * in the process is bounded by thread_count. Contexts created earlier keep
+ * using the executor they were created with.
+ *
+ * @param thread_count number of shared worker threads, 0 to disable sharing
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_executor_set_shared_thread_count(int thread_count);
+
 #endif //AVUTIL_EXECUTOR_H
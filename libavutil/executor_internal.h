@@ -0,0 +1,69 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_EXECUTOR_INTERNAL_H
+#define AVUTIL_EXECUTOR_INTERNAL_H
+
+#include "executor.h"
+
+typedef struct FFSharedExecutor FFSharedExecutor;
+
+/**
+ * A task submitted to the shared executor. Tasks are run in FIFO order.
+ */
+typedef struct FFSharedTask {
+    AVTask task;
+    void (*run)(struct FFSharedTask *t);
+} FFSharedTask;
+
+/**
+ * Get a reference to the currently configured shared executor.
+ * @param thread_count the number of shared worker threads is returned here
+ * @return the shared executor, or NULL if sharing is disabled
+ */
+FFSharedExecutor *ff_executor_shared_ref(int *thread_count);
+
+/**
+ * Allocate a shared executor that is separate from the process-wide one, e.g.
+ * to bound the number of slice threads used by a group of contexts.
+ * @param thread_count number of worker threads
+ * @return the executor with one reference, or NULL on failure or if threads
+ *         are not supported
+ */
+FFSharedExecutor *avpriv_executor_shared_alloc(int thread_count);
+
+/**
+ * Get another reference to a shared executor.
+ * @param thread_count the number of worker threads of se is returned here
+ * @return se
+ */
+FFSharedExecutor *ff_executor_shared_addref(FFSharedExecutor *se, int *thread_count);
+
+/**
+ * Release a reference obtained with ff_executor_shared_ref(),
+ * ff_executor_shared_addref() or avpriv_executor_shared_alloc().
+ * The executor is freed when its last reference goes away.
+ */
+void avpriv_executor_shared_unref(FFSharedExecutor **se);
+
+/**
+ * Queue a task on the shared executor.
+ */
+void ff_executor_shared_execute(FFSharedExecutor *se, FFSharedTask *t);
+
+#endif /* AVUTIL_EXECUTOR_INTERNAL_H */
@@ -18,6 +18,7 @@
 
 #include <stdatomic.h>
 #include "cpu.h"
+#include "executor_internal.h"
 #include "internal.h"
 #include "slicethread.h"
 #include "mem.h"
@@ -36,6 +37,12 @@ typedef struct WorkerContext {
     int             done;
 } WorkerContext;
 
+typedef struct SharedWorker {
+    FFSharedTask    task;
+    AVSliceThread   *ctx;
+    int             queued;
+} SharedWorker;
+
 struct AVSliceThread {
     WorkerContext   *workers;
     int             nb_threads;
@@ -52,20 +59,138 @@ struct AVSliceThread {
     void            *priv;
     void            (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
     void            (*main_func)(void *priv);
+
+    /* shared executor mode, the fields below are protected by done_mutex */
+    FFSharedExecutor *shared;
+    SharedWorker    *shared_workers;
+    int             nb_shared_workers;
+    int             next_slot;
+    int             nb_done_slots;
 };
 
-static int run_jobs(AVSliceThread *ctx)
+static unsigned run_slot(AVSliceThread *ctx, unsigned first_job)
 {
     unsigned nb_jobs    = ctx->nb_jobs;
     unsigned nb_active_threads = ctx->nb_active_threads;
-    unsigned first_job    = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
     unsigned current_job  = first_job;
 
     do {
         ctx->worker_func(ctx->priv, current_job, first_job, nb_jobs, nb_active_threads);
     } while ((current_job = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs);
 
-    return current_job == nb_jobs + nb_active_threads - 1;
+    return current_job;
+}
+
+static int run_jobs(AVSliceThread *ctx)
+{
+    unsigned first_job    = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
+    unsigned current_job  = run_slot(ctx, first_job);
+
+    return current_job == ctx->nb_jobs + ctx->nb_active_threads - 1;
+}
+
+/* Claim the thread slots of the current execution that nobody has started
+ * yet and run jobs in them. All jobs come from current_job in order, so any
+ * job that is started only depends on jobs that are already running and the
+ * execution progresses with however many threads end up taking part.
+ * Must be called with done_mutex held. */
+static void run_shared_slots(AVSliceThread *ctx)
+{
+    while (ctx->next_slot < ctx->nb_active_threads) {
+        unsigned nb_jobs = ctx->nb_jobs;
+        unsigned nb_active_threads = ctx->nb_active_threads;
+        unsigned slot = ctx->next_slot++;
+        unsigned job;
+
+        pthread_mutex_unlock(&ctx->done_mutex);
+        while ((job = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs)
+            ctx->worker_func(ctx->priv, job, slot, nb_jobs, nb_active_threads);
+        pthread_mutex_lock(&ctx->done_mutex);
+
+        if (++ctx->nb_done_slots == ctx->nb_active_threads)
+            pthread_cond_broadcast(&ctx->done_cond);
+    }
+}
+
+static void shared_worker_run(FFSharedTask *t)
+{
+    SharedWorker  *w   = (SharedWorker*)t;
+    AVSliceThread *ctx = w->ctx;
+
+    pthread_mutex_lock(&ctx->done_mutex);
+    run_shared_slots(ctx);
+    w->queued = 0;
+    pthread_cond_broadcast(&ctx->done_cond);
+    pthread_mutex_unlock(&ctx->done_mutex);
+}
+
+static int shared_create(AVSliceThread *ctx, FFSharedExecutor *shared,
+                         int nb_workers)
+{
+    ctx->shared = shared;
+    if (nb_workers &&
+        !(ctx->shared_workers = av_calloc(nb_workers, sizeof(*ctx->shared_workers))))
+        return AVERROR(ENOMEM);
+    ctx->nb_shared_workers = nb_workers;
+
+    for (int i = 0; i < nb_workers; i++) {
+        SharedWorker *w = &ctx->shared_workers[i];
+        w->task.run = shared_worker_run;
+        w->ctx      = ctx;
+    }
+
+    return 0;
+}
+
+static void shared_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
+{
+    int nb_workers;
+
+    /* Workers queued for an earlier execution may still be pending on the
+     * shared executor; they help with the current one once they run, so all
+     * bookkeeping is reset under the lock. */
+    pthread_mutex_lock(&ctx->done_mutex);
+    ctx->nb_jobs           = nb_jobs;
+    ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
+    ctx->next_slot         = 0;
+    ctx->nb_done_slots     = 0;
+    atomic_store_explicit(&ctx->current_job, 0, memory_order_relaxed);
+
+    nb_workers = ctx->nb_active_threads;
+    if (!ctx->main_func || !execute_main)
+        nb_workers--;
+    for (int i = 0; i < ctx->nb_shared_workers && nb_workers > 0; i++, nb_workers--) {
+        SharedWorker *w = &ctx->shared_workers[i];
+        if (w->queued)
+            continue;
+        w->queued = 1;
+        ff_executor_shared_execute(ctx->shared, &w->task);
+    }
+    pthread_mutex_unlock(&ctx->done_mutex);
+
+    if (ctx->main_func && execute_main)
+        ctx->main_func(ctx->priv);
+
+    /* the caller always helps, so progress never depends on a free
+     * shared worker being available */
+    pthread_mutex_lock(&ctx->done_mutex);
+    run_shared_slots(ctx);
+    while (ctx->nb_done_slots < ctx->nb_active_threads)
+        pthread_cond_wait(&ctx->done_cond, &ctx->done_mutex);
+    pthread_mutex_unlock(&ctx->done_mutex);
+}
+
+static void shared_free(AVSliceThread *ctx)
+{
+    pthread_mutex_lock(&ctx->done_mutex);
+    for (int i = 0; i < ctx->nb_shared_workers; i++) {
+        while (ctx->shared_workers[i].queued)
+            pthread_cond_wait(&ctx->done_cond, &ctx->done_mutex);
+    }
+    pthread_mutex_unlock(&ctx->done_mutex);
+
+    av_freep(&ctx->shared_workers);
+    avpriv_executor_shared_unref(&ctx->shared);
 }
 
 static void *attribute_align_arg thread_worker(void *v)
@@ -95,10 +220,12 @@ static void *attribute_align_arg thread_worker(void *v)
     }
 }
 
-int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
+/* takes ownership of the shared reference */
+static int slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
-                              int nb_threads)
+                              int nb_threads, FFSharedExecutor *shared,
+                              int nb_shared_threads)
 {
     AVSliceThread *ctx;
     int nb_workers, i;
@@ -112,15 +239,28 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
             nb_threads = 1;
     }
 
+    if (shared)
+        nb_threads = FFMIN(nb_threads, nb_shared_threads + 1);
+
     nb_workers = nb_threads;
     if (!main_func)
         nb_workers--;
 
     *pctx = ctx = av_mallocz(sizeof(*ctx));
-    if (!ctx)
+    if (!ctx) {
+        avpriv_executor_shared_unref(&shared);
         return AVERROR(ENOMEM);
+    }
 
-    if (nb_workers && !(ctx->workers = av_calloc(nb_workers, sizeof(*ctx->workers)))) {
+    if (shared) {
+        int ret = shared_create(ctx, shared, nb_workers);
+        if (ret < 0) {
+            avpriv_executor_shared_unref(&ctx->shared);
+            av_freep(pctx);
+            return ret;
+        }
+        nb_workers = 0;
+    } else if (nb_workers && !(ctx->workers = av_calloc(nb_workers, sizeof(*ctx->workers)))) {
         av_freep(pctx);
         return AVERROR(ENOMEM);
     }
@@ -165,11 +305,40 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return nb_threads;
 }
 
+int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
+                              void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                              void (*main_func)(void *priv),
+                              int nb_threads)
+{
+    int nb_shared_threads = 0;
+    FFSharedExecutor *shared = ff_executor_shared_ref(&nb_shared_threads);
+
+    return slicethread_create(pctx, priv, worker_func, main_func, nb_threads,
+                              shared, nb_shared_threads);
+}
+
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     void (*main_func)(void *priv),
+                                     int nb_threads, FFSharedExecutor *executor)
+{
+    int nb_shared_threads;
+    FFSharedExecutor *shared = ff_executor_shared_addref(executor, &nb_shared_threads);
+
+    return slicethread_create(pctx, priv, worker_func, main_func, nb_threads,
+                              shared, nb_shared_threads);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     int nb_workers, i, is_last = 0;
 
     av_assert0(nb_jobs > 0);
+    if (ctx->shared) {
+        shared_execute(ctx, nb_jobs, execute_main);
+        return;
+    }
+
     ctx->nb_jobs           = nb_jobs;
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
@@ -209,6 +378,14 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+    if (ctx->shared) {
+        shared_free(ctx);
+        pthread_cond_destroy(&ctx->done_cond);
+        pthread_mutex_destroy(&ctx->done_mutex);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
@@ -246,6 +423,15 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return AVERROR(ENOSYS);
 }
 
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     void (*main_func)(void *priv),
+                                     int nb_threads, FFSharedExecutor *executor)
+{
+    *pctx = NULL;
+    return AVERROR(ENOSYS);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     av_assert0(0);
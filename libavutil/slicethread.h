@@ -20,6 +20,7 @@
 #define AVUTIL_SLICETHREAD_H
 
 typedef struct AVSliceThread AVSliceThread;
+struct FFSharedExecutor;
 
 /**
  * Create slice threading context.
@@ -35,6 +36,21 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*main_func)(void *priv),
                               int nb_threads);
 
+/**
+ * Create a slice threading context that runs its jobs on the worker threads
+ * of the given executor, which may be shared with other contexts, instead of
+ * on threads of its own. The caller of avpriv_slicethread_execute() always
+ * takes part, so contexts never wait for a free worker.
+ * @param executor executor from avpriv_executor_shared_alloc(), the context
+ *                 keeps its own reference to it
+ * @see avpriv_slicethread_create() for the other parameters
+ * @return return number of threads or negative AVERROR on failure
+ */
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     void (*main_func)(void *priv),
+                                     int nb_threads, struct FFSharedExecutor *executor);
+
 /**
  * Execute slice threading.
  * @param ctx slice threading context
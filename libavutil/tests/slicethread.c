@@ -0,0 +1,210 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Run jobs which wait for the previous job to finish, like wavefront
+ * decoding does, with fewer threads than jobs, on dedicated threads, on
+ * the shared executor while its workers are busy, and from several threads
+ * at once on one private executor, like frame threads with a common slice
+ * thread pool do.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/executor.h"
+#include "libavutil/executor_internal.h"
+#include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
+
+#define NB_JOBS    32
+#define NB_CALLERS 4
+
+typedef struct TestContext {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    int done[NB_JOBS];
+    int thread_used[NB_JOBS];
+    int error;
+} TestContext;
+
+typedef struct BlockingTask {
+    FFSharedTask     task;
+    pthread_mutex_t  mutex;
+    pthread_cond_t   cond;
+    int              running;
+    int              release;
+} BlockingTask;
+
+static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    TestContext *tc = priv;
+
+    pthread_mutex_lock(&tc->mutex);
+    if (threadnr < 0 || threadnr >= nb_threads || tc->thread_used[threadnr]++)
+        tc->error = 1;
+    while (jobnr > 0 && !tc->done[jobnr - 1])
+        pthread_cond_wait(&tc->cond, &tc->mutex);
+    tc->done[jobnr] = 1;
+    tc->thread_used[threadnr]--;
+    pthread_cond_broadcast(&tc->cond);
+    pthread_mutex_unlock(&tc->mutex);
+}
+
+static void blocking_run(FFSharedTask *t)
+{
+    BlockingTask *b = (BlockingTask*)t;
+
+    pthread_mutex_lock(&b->mutex);
+    b->running = 1;
+    pthread_cond_broadcast(&b->cond);
+    while (!b->release)
+        pthread_cond_wait(&b->cond, &b->mutex);
+    pthread_mutex_unlock(&b->mutex);
+}
+
+static void release_task(BlockingTask *b)
+{
+    pthread_mutex_lock(&b->mutex);
+    b->release = 1;
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->mutex);
+}
+
+static void run_iterations(AVSliceThread *thread, TestContext *tc)
+{
+    for (int iter = 0; iter < 4 && !tc->error; iter++) {
+        for (int i = 0; i < NB_JOBS; i++)
+            tc->done[i] = 0;
+        avpriv_slicethread_execute(thread, NB_JOBS, 0);
+        for (int i = 0; i < NB_JOBS; i++)
+            if (!tc->done[i])
+                tc->error = 1;
+    }
+}
+
+static int run_test(const char *name, int nb_threads, BlockingTask *blocker)
+{
+    AVSliceThread *thread;
+    TestContext tc = { 0 };
+    int ret;
+
+    pthread_mutex_init(&tc.mutex, NULL);
+    pthread_cond_init(&tc.cond, NULL);
+
+    ret = avpriv_slicethread_create(&thread, &tc, worker_func, NULL, nb_threads);
+    if (ret < 0) {
+        fprintf(stderr, "%s: creating the slice threads failed\n", name);
+        return 1;
+    }
+
+    run_iterations(thread, &tc);
+    /* queued shared workers can only finish once the executor is free */
+    if (blocker)
+        release_task(blocker);
+    avpriv_slicethread_free(&thread);
+
+    pthread_cond_destroy(&tc.cond);
+    pthread_mutex_destroy(&tc.mutex);
+
+    printf("%s: %s\n", name, tc.error ? "failed" : "ok");
+    return tc.error;
+}
+
+typedef struct Caller {
+    pthread_t      thread;
+    AVSliceThread *slices;
+    TestContext    tc;
+} Caller;
+
+static void *caller_run(void *arg)
+{
+    Caller *c = arg;
+
+    run_iterations(c->slices, &c->tc);
+    return NULL;
+}
+
+static int run_pool_test(const char *name, int nb_pool_threads)
+{
+    FFSharedExecutor *pool = avpriv_executor_shared_alloc(nb_pool_threads);
+    Caller callers[NB_CALLERS] = { 0 };
+    int error = !pool;
+
+    for (int i = 0; i < NB_CALLERS; i++) {
+        Caller *c = &callers[i];
+
+        pthread_mutex_init(&c->tc.mutex, NULL);
+        pthread_cond_init(&c->tc.cond, NULL);
+        if (!error && avpriv_slicethread_create_shared(&c->slices, &c->tc, worker_func,
+                                                       NULL, nb_pool_threads + 1, pool) < 0)
+            error = 1;
+    }
+    /* the contexts hold their own references */
+    avpriv_executor_shared_unref(&pool);
+
+    for (int i = 0; i < NB_CALLERS && !error; i++)
+        if (pthread_create(&callers[i].thread, NULL, caller_run, &callers[i]))
+            error = 1;
+    for (int i = 0; i < NB_CALLERS; i++) {
+        Caller *c = &callers[i];
+
+        if (!error)
+            pthread_join(c->thread, NULL);
+        error |= c->tc.error;
+        avpriv_slicethread_free(&c->slices);
+        pthread_cond_destroy(&c->tc.cond);
+        pthread_mutex_destroy(&c->tc.mutex);
+    }
+
+    printf("%s: %s\n", name, error ? "failed" : "ok");
+    return error;
+}
+
+int main(void)
+{
+    FFSharedExecutor *se;
+    BlockingTask b = { .task.run = blocking_run };
+    int nb_shared_threads, ret = 0;
+
+    ret |= run_test("dedicated threads", 4, NULL);
+
+    if (av_executor_set_shared_thread_count(1) < 0)
+        return 1;
+    ret |= run_test("shared executor", 4, NULL);
+
+    /* keep the shared worker busy, so the caller has to run all jobs */
+    se = ff_executor_shared_ref(&nb_shared_threads);
+    pthread_mutex_init(&b.mutex, NULL);
+    pthread_cond_init(&b.cond, NULL);
+    ff_executor_shared_execute(se, &b.task);
+    pthread_mutex_lock(&b.mutex);
+    while (!b.running)
+        pthread_cond_wait(&b.cond, &b.mutex);
+    pthread_mutex_unlock(&b.mutex);
+
+    ret |= run_test("shared executor, busy worker", 4, &b);
+
+    avpriv_executor_shared_unref(&se);
+    av_executor_set_shared_thread_count(0);
+    pthread_cond_destroy(&b.cond);
+    pthread_mutex_destroy(&b.mutex);
+
+    ret |= run_pool_test("private executor, concurrent contexts", 2);
+
+    return ret;
+}
@@ -346,9 +346,74 @@ static int set_compensation(ResampleContext *c, int sample_delta, int compensati
     return 0;
 }
 
-static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
-    int i;
+typedef struct ResampleJob {
+    AudioData *dst;
+    const AudioData *src;
+    int dst_size;
+    int64_t index;
+    int64_t incr;
+    int (*resample_func)(struct ResampleContext *c, void *dst,
+                         const void *src, int n, int update_ctx);
+} ResampleJob;
+
+static void resample_one_channel(SwrContext *s, void *arg, int ch)
+{
+    ResampleContext *c = s->resample;
+    const ResampleJob *job = arg;
+
+    c->dsp.resample_one(job->dst->ch[ch], job->src->ch[ch], job->dst_size,
+                        job->index, job->incr);
+}
+
+/* channels only read the filter state, it is advanced once afterwards */
+static void resample_channel(SwrContext *s, void *arg, int ch)
+{
+    ResampleContext *c = s->resample;
+    const ResampleJob *job = arg;
+
+    job->resample_func(c, job->dst->ch[ch], job->src->ch[ch], job->dst_size, 0);
+}
+
+/**
+ * Advance index and frac by n output samples, the same way resample_common()
+ * and resample_linear() do with update_ctx set.
+ * @return number of input samples consumed
+ */
+static int advance_filter_state(ResampleContext *c, int n)
+{
+    int index = c->index;
+    int frac  = c->frac;
+    int sample_index = 0;
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    for (int i = 0; i < n; i++) {
+        frac  += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+
+    c->frac  = frac;
+    c->index = index;
+
+    return sample_index;
+}
+
+static int multiple_resample(SwrContext *s, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
+    ResampleContext *c = s->resample;
     int64_t max_src_size = (INT64_MAX/2 / c->phase_count) / c->src_incr;
+    ResampleJob job = { .dst = dst, .src = src };
 
     if (c->compensation_distance)
         dst_size = FFMIN(dst_size, c->compensation_distance);
@@ -363,33 +428,38 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
 
         dst_size = FFMAX(FFMIN(dst_size, new_size), 0);
         if (dst_size > 0) {
-            for (i = 0; i < dst->ch_count; i++) {
-                c->dsp.resample_one(dst->ch[i], src->ch[i], dst_size, index2, incr);
-                if (i+1 == dst->ch_count) {
-                    c->index += dst_size * c->dst_incr_div;
-                    c->index += (c->frac + dst_size * (int64_t)c->dst_incr_mod) / c->src_incr;
-                    av_assert2(c->index >= 0);
-                    *consumed = c->index;
-                    c->frac   = (c->frac + dst_size * (int64_t)c->dst_incr_mod) % c->src_incr;
-                    c->index = 0;
-                }
-            }
+            job.dst_size = dst_size;
+            job.index    = index2;
+            job.incr     = incr;
+            swri_execute_channels(s, resample_one_channel, &job, dst->ch_count, dst_size);
+
+            c->index += dst_size * c->dst_incr_div;
+            c->index += (c->frac + dst_size * (int64_t)c->dst_incr_mod) / c->src_incr;
+            av_assert2(c->index >= 0);
+            *consumed = c->index;
+            c->frac   = (c->frac + dst_size * (int64_t)c->dst_incr_mod) % c->src_incr;
+            c->index = 0;
         }
     } else {
         int64_t end_index = (1LL + src_size - c->filter_length) * c->phase_count;
         int64_t delta_frac = (end_index - c->index) * c->src_incr - c->frac;
         int delta_n = (delta_frac + c->dst_incr - 1) / c->dst_incr;
-        int (*resample_func)(struct ResampleContext *c, void *dst,
-                             const void *src, int n, int update_ctx);
 
         dst_size = FFMAX(FFMIN(dst_size, delta_n), 0);
         if (dst_size > 0) {
             /* resample_linear and resample_common should have same behavior
              * when frac and dst_incr_mod are zero */
-            resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
-                            c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            job.resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
+                                c->dsp.resample_linear : c->dsp.resample_common;
+            job.dst_size      = dst_size;
+
+            if (swri_channel_jobs(s, dst->ch_count, dst_size) > 1) {
+                swri_execute_channels(s, resample_channel, &job, dst->ch_count, dst_size);
+                *consumed = advance_filter_state(c, dst_size);
+            } else {
+                for (int i = 0; i < dst->ch_count; i++)
+                    *consumed = job.resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            }
         }
     }
 
@@ -24,6 +24,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/internal.h"
+#include "libavutil/slicethread.h"
 
 #include <float.h>
 
@@ -112,6 +113,7 @@ static void clear_context(SwrContext *s){
     swri_audio_convert_free(&s->out_convert);
     swri_audio_convert_free(&s->full_convert);
     swri_rematrix_free(s);
+    avpriv_slicethread_free(&s->slicethread);
 
     s->delayed_samples_fixup = 0;
     s->flushed = 0;
@@ -136,6 +138,34 @@ av_cold void swr_close(SwrContext *s){
     clear_context(s);
 }
 
+static void channel_worker(void *priv, int jobnr, int threadnr,
+                           int nb_jobs, int nb_threads)
+{
+    SwrContext *s = priv;
+    const int start = s->job_channels *  jobnr      / nb_jobs;
+    const int end   = s->job_channels * (jobnr + 1) / nb_jobs;
+
+    for (int ch = start; ch < end; ch++)
+        s->job_func(s, s->job_arg, ch);
+}
+
+void swri_execute_channels(SwrContext *s, swri_channel_func *func, void *arg,
+                           int nb_channels, int nb_samples)
+{
+    int nb_jobs = swri_channel_jobs(s, nb_channels, nb_samples);
+
+    if (nb_jobs < 2) {
+        for (int ch = 0; ch < nb_channels; ch++)
+            func(s, arg, ch);
+        return;
+    }
+
+    s->job_func     = func;
+    s->job_arg      = arg;
+    s->job_channels = nb_channels;
+    avpriv_slicethread_execute(s->slicethread, nb_jobs, 0);
+}
+
 av_cold int swr_init(struct SwrContext *s){
     int ret;
     char l1[1024], l2[1024];
@@ -391,6 +421,19 @@ av_assert0(s->out.ch_count);
             goto fail;
     }
 
+    s->nb_threads_used = 1;
+    if (s->nb_threads != 1 && (s->resample || s->rematrix) &&
+        FFMAX(s->used_ch_layout.nb_channels, s->out.ch_count) > 1) {
+        ret = avpriv_slicethread_create(&s->slicethread, s, channel_worker,
+                                        NULL, s->nb_threads);
+        if (ret == AVERROR(ENOSYS)) {
+            ret = 0;
+        } else if (ret < 0) {
+            goto fail;
+        } else
+            s->nb_threads_used = ret;
+    }
+
     return 0;
 fail:
     swr_close(s);
@@ -516,7 +559,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
         int ret, size, consumed;
         if(!s->resample_in_constraint && s->in_buffer_count){
             buf_set(&tmp, &s->in_buffer, s->in_buffer_index);
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
+            ret= s->resampler->multiple_resample(s, &out, out_count, &tmp, s->in_buffer_count, &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -536,7 +579,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
 
         if((s->flushed || in_count > padless) && !s->in_buffer_count){
             s->in_buffer_index=0;
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
+            ret= s->resampler->multiple_resample(s, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -23,6 +23,7 @@
 
 #include "swresample.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/macros.h"
 #include "config.h"
 
 #define SWR_CH_MAX 64
@@ -42,6 +43,8 @@ typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, vo
 
 typedef void (mix_any_func_type)(uint8_t **out, const uint8_t **in1, void *coeffp, integer len);
 
+typedef void (swri_channel_func)(struct SwrContext *s, void *arg, int ch);
+
 typedef struct AudioData{
     uint8_t *ch[SWR_CH_MAX];    ///< samples buffer per channel
     uint8_t *data;              ///< samples buffer
@@ -71,7 +74,7 @@ struct DitherContext {
 typedef struct ResampleContext * (* resample_init_func)(struct ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta, double precision, int cheby, int exact_rational);
 typedef void    (* resample_free_func)(struct ResampleContext **c);
-typedef int     (* multiple_resample_func)(struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
+typedef int     (* multiple_resample_func)(struct SwrContext *s, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
 typedef int     (* resample_flush_func)(struct SwrContext *c);
 typedef int     (* set_compensation_func)(struct ResampleContext *c, int sample_delta, int compensation_distance);
 typedef int64_t (* get_delay_func)(struct SwrContext *s, int64_t base);
@@ -182,12 +185,48 @@ struct SwrContext {
 
     mix_any_func_type *mix_any_f;
 
+    int nb_threads;                                 ///< number of threads for channel-parallel processing, 0 for auto
+    int nb_threads_used;                            ///< number of threads actually running, resolved from nb_threads by swr_init()
+    struct AVSliceThread *slicethread;              ///< worker threads, NULL when processing on the calling thread only
+    swri_channel_func *job_func;                    ///< per-channel function run by swri_execute_channels()
+    void *job_arg;                                  ///< opaque argument passed to job_func
+    int job_channels;                               ///< number of channels job_func is run on
+
     /* TODO: callbacks for ASM optimizations */
 };
 
 av_warn_unused_result
 int swri_realloc_audio(AudioData *a, int count);
 
+/**
+ * Minimum amount of work, in channels times samples, given to one thread.
+ * Calls processing less than twice this run on the calling thread, as waking
+ * up the workers would cost more than it saves.
+ */
+#define SWR_THREAD_JOB_SAMPLES 8192
+
+/**
+ * Return the number of jobs swri_execute_channels() splits nb_channels
+ * channels of nb_samples samples each into, 1 if it runs them all on the
+ * calling thread.
+ */
+static inline int swri_channel_jobs(const SwrContext *s, int nb_channels, int nb_samples)
+{
+    int64_t work = (int64_t)nb_channels * nb_samples;
+
+    if (!s->slicethread)
+        return 1;
+    return FFMAX(FFMIN3(s->nb_threads_used, nb_channels, work / SWR_THREAD_JOB_SAMPLES), 1);
+}
+
+/**
+ * Run func once for every channel in [0, nb_channels), spreading the channels
+ * over the worker threads if there is enough work for more than one thread,
+ * see swri_channel_jobs(). Returns once all calls are done.
+ */
+void swri_execute_channels(SwrContext *s, swri_channel_func *func, void *arg,
+                           int nb_channels, int nb_samples);
+
 void swri_noise_shaping_int16 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
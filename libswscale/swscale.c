@@ -1130,16 +1130,51 @@ unsigned int sws_receive_slice_alignment(const struct SwsContext *c)
     return c->dst_slice_align;
 }
 
+/**
+ * Return the number of source rows, counted from the top of the frame, that
+ * have to be available before output rows [0, dst_end) can be produced.
+ */
+static int src_rows_needed(const SwsContext *c, int dst_end)
+{
+    const int macro_height = isBayer(c->srcFormat) ? 2 : (1 << c->chrSrcVSubSample);
+    int lum_last, chr_last, lum_end, chr_end;
+
+    /* the intermediate passes of cascaded scalers consume the whole frame */
+    if (c->cascaded_context[0])
+        return c->srcH;
+
+    if (c->convert_unscaled)
+        return FFMIN(FFALIGN(dst_end, macro_height), c->srcH);
+
+    /* same windows as used by the enough_lines check in swscale() */
+    lum_last = FFMIN((dst_end - 1) | ((1 << c->chrDstVSubSample) - 1), c->dstH - 1);
+    chr_last = (dst_end - 1) >> c->chrDstVSubSample;
+
+    lum_end = FFMAX(1 - c->vLumFilterSize, c->vLumFilterPos[lum_last]) + c->vLumFilterSize;
+    chr_end = FFMAX(1 - c->vChrFilterSize, c->vChrFilterPos[chr_last]) + c->vChrFilterSize;
+    chr_end = FFMIN(chr_end, c->chrSrcH) << c->chrSrcVSubSample;
+
+    return FFMIN(FFALIGN(FFMAX(lum_end, chr_end), macro_height), c->srcH);
+}
+
 int sws_receive_slice(struct SwsContext *c, unsigned int slice_start,
                       unsigned int slice_height)
 {
+    const SwsContext *sc = c->nb_slice_ctx ? c->slice_ctx[0] : c;
+    const int macro_height = isBayer(sc->srcFormat) ? 2 : (1 << sc->chrSrcVSubSample);
     unsigned int align = sws_receive_slice_alignment(c);
     uint8_t *dst[4];
+    int src_avail;
+
+    /* only the rows received contiguously from the top of the frame can be
+     * used; wait until they cover everything this output slice depends on */
+    if (!c->src_ranges.nb_ranges || c->src_ranges.ranges[0].start != 0)
+        return AVERROR(EAGAIN);
 
-    /* wait until complete input has been received */
-    if (!(c->src_ranges.nb_ranges == 1        &&
-          c->src_ranges.ranges[0].start == 0 &&
-          c->src_ranges.ranges[0].len == c->srcH))
+    src_avail = c->src_ranges.ranges[0].len;
+    if (src_avail < c->srcH)
+        src_avail &= ~(macro_height - 1);
+    if (src_avail < src_rows_needed(sc, av_clip(slice_start + slice_height, 1, sc->dstH)))
         return AVERROR(EAGAIN);
 
     if ((slice_start > 0 || slice_height < c->dstH) &&
@@ -1154,6 +1189,7 @@ int sws_receive_slice(struct SwsContext *c, unsigned int slice_start,
         int nb_jobs = c->slice_ctx[0]->dither == SWS_DITHER_ED ? 1 : c->nb_slice_ctx;
         int ret = 0;
 
+        c->src_slice_height = src_avail;
         c->dst_slice_start  = slice_start;
         c->dst_slice_height = slice_height;
 
@@ -1172,12 +1208,13 @@ int sws_receive_slice(struct SwsContext *c, unsigned int slice_start,
     }
 
     for (int i = 0; i < FF_ARRAY_ELEMS(dst); i++) {
-        ptrdiff_t offset = c->frame_dst->linesize[i] * (slice_start >> c->chrDstVSubSample);
+        const int vshift = (i == 1 || i == 2) ? c->chrDstVSubSample : 0;
+        ptrdiff_t offset = c->frame_dst->linesize[i] * (slice_start >> vshift);
         dst[i] = FF_PTR_ADD(c->frame_dst->data[i], offset);
     }
 
     return scale_internal(c, (const uint8_t * const *)c->frame_src->data,
-                          c->frame_src->linesize, 0, c->srcH,
+                          c->frame_src->linesize, 0, src_avail,
                           dst, c->frame_dst->linesize, slice_start, slice_height);
 }
 
@@ -1198,6 +1235,82 @@ int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src)
     return ret;
 }
 
+/* number of source rows handed to every output before moving on */
+#define MULTI_BAND_HEIGHT 16
+
+/* contexts that need the whole source at once are scaled frame by frame */
+static int scale_whole_frame(const SwsContext *c)
+{
+    return c->slicethread || c->cascaded_context[0];
+}
+
+int sws_scale_frame_multi(struct SwsContext **c, AVFrame **dst, int nb_dst,
+                          const AVFrame *src)
+{
+    int started, ret = 0;
+
+    if (nb_dst <= 0)
+        return AVERROR(EINVAL);
+
+    for (int i = 0; i < nb_dst; i++) {
+        if (c[i]->srcW != src->width || c[i]->srcH != src->height ||
+            c[i]->srcFormat != src->format) {
+            av_log(c[i], AV_LOG_ERROR, "Context %d was not configured for this source\n", i);
+            return AVERROR(EINVAL);
+        }
+    }
+
+    for (started = 0; started < nb_dst; started++) {
+        ret = sws_frame_start(c[started], dst[started], src);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (int i = 0; i < nb_dst; i++) {
+        if (!scale_whole_frame(c[i]))
+            continue;
+        ret = sws_send_slice(c[i], 0, src->height);
+        if (ret >= 0)
+            ret = sws_receive_slice(c[i], 0, dst[i]->height);
+        if (ret < 0)
+            goto end;
+    }
+
+    /* Feed the remaining outputs the same band of source rows in turn, so
+     * that it is still cache resident when the next output reads it. */
+    for (int y = 0; y < src->height; y += MULTI_BAND_HEIGHT) {
+        const int h = FFMIN(MULTI_BAND_HEIGHT, src->height - y);
+
+        for (int i = 0; i < nb_dst; i++) {
+            const uint8_t *band[4] = { NULL };
+
+            if (scale_whole_frame(c[i]))
+                continue;
+
+            for (int p = 0; p < FF_ARRAY_ELEMS(band) && src->data[p]; p++) {
+                const int vshift = (p == 1 || p == 2) ? c[i]->chrSrcVSubSample : 0;
+
+                if (p == 1 && usePal(c[i]->srcFormat))
+                    band[p] = src->data[p];
+                else
+                    band[p] = src->data[p] + src->linesize[p] * (y >> vshift);
+            }
+
+            ret = scale_internal(c[i], band, src->linesize, y, h,
+                                 dst[i]->data, dst[i]->linesize, 0, c[i]->dstH);
+            if (ret < 0)
+                goto end;
+        }
+    }
+    ret = 0;
+
+end:
+    for (int i = 0; i < started; i++)
+        sws_frame_end(c[i]);
+
+    return ret;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -1239,7 +1352,7 @@ void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
         }
 
         err = scale_internal(c, (const uint8_t * const *)parent->frame_src->data,
-                             parent->frame_src->linesize, 0, c->srcH,
+                             parent->frame_src->linesize, 0, parent->src_slice_height,
                              dst, parent->frame_dst->linesize,
                              parent->dst_slice_start + slice_start, slice_end - slice_start);
     }
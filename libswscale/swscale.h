@@ -243,6 +243,27 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
  */
 int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src);
 
+/**
+ * Scale one source frame into several destination frames in one pass.
+ *
+ * The source rows are handed to all the scalers in small bands, so that each
+ * band is read from memory once and reused from cache by every output, rather
+ * than walking the whole source once per output as repeated sws_scale_frame()
+ * calls would. Scalers that need the complete source at once (e.g. with
+ * slice threading or internal cascading) fall back to scaling the whole frame.
+ *
+ * @param c      Array of nb_dst scaling contexts, all configured for the
+ *               dimensions and pixel format of src. c[i] writes into dst[i].
+ * @param dst    Array of nb_dst destination frames. See the documentation of
+ *               sws_frame_start() for more details.
+ * @param nb_dst Number of outputs.
+ * @param src    The source frame.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_scale_frame_multi(struct SwsContext **c, AVFrame **dst, int nb_dst,
+                          const AVFrame *src);
+
 /**
  * Initialize the scaling process for a given pair of source/destination frames.
  * Must be called before any calls to sws_send_slice() and sws_receive_slice().
@@ -307,6 +328,12 @@ int sws_send_slice(struct SwsContext *c, unsigned int slice_start,
  *                     (i.e. when slice_start+slice_height is equal to output
  *                     frame height)
  *
+ * The output slice can be produced as soon as all the source rows it depends
+ * on have been signalled with sws_send_slice(), counted contiguously from the
+ * top of the frame; the rest of the source does not have to be ready yet. This
+ * allows scaling the top of a frame while its bottom is still being produced,
+ * e.g. by a decoder reporting rows through draw_horiz_band.
+ *
  * @return a non-negative number if the data was successfully written into the output
  *         AVERROR(EAGAIN) if more input data needs to be provided before the
  *                         output can be produced
@@ -397,6 +424,27 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context,
                                         int flags, SwsFilter *srcFilter,
                                         SwsFilter *dstFilter, const double *param);
 
+/**
+ * Get the statistics of the process-wide cache of scaling filters.
+ *
+ * Filter coefficients computed during context initialization are kept in a
+ * cache shared by all contexts, so that creating contexts with the same
+ * sizes, flags and formats repeatedly does not recompute them.
+ *
+ * @param hits   if not NULL, set to the number of filters served from the cache
+ * @param misses if not NULL, set to the number of filters that had to be computed
+ */
+void sws_get_filter_cache_stats(uint64_t *hits, uint64_t *misses);
+
+/**
+ * Free all the scaling filters held in the process-wide cache.
+ *
+ * The cache is bounded in size, but its entries stay allocated until they
+ * are evicted or this function is called, e.g. before exiting. The hit and
+ * miss counters are not reset.
+ */
+void sws_flush_filter_cache(void);
+
 /**
  * Convert an 8-bit paletted frame into a frame with a color depth of 32 bits.
  *
@@ -310,6 +310,7 @@ typedef struct SwsContext {
     int              nb_slice_ctx;
 
     // values passed to current sws_receive_slice() call
+    int src_slice_height;
     int dst_slice_start;
     int dst_slice_height;
 
@@ -0,0 +1,74 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Create contexts with the same and with different parameters, and print
+ * how many of their filters were served from the filter cache.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "libavutil/pixfmt.h"
+#include "libswscale/swscale.h"
+
+static int create(const char *name, int src_w, int src_h, int dst_w, int dst_h,
+                  int flags, const double *param)
+{
+    static uint64_t last_hits, last_misses;
+    struct SwsContext *sws;
+    uint64_t hits, misses;
+
+    sws = sws_getContext(src_w, src_h, AV_PIX_FMT_YUV420P,
+                         dst_w, dst_h, AV_PIX_FMT_YUV420P, flags, NULL, NULL, param);
+    if (!sws) {
+        fprintf(stderr, "%s: failed to create the context\n", name);
+        return 1;
+    }
+    sws_freeContext(sws);
+
+    sws_get_filter_cache_stats(&hits, &misses);
+    printf("%-16s hits %"PRIu64" misses %"PRIu64"\n", name,
+           hits - last_hits, misses - last_misses);
+    last_hits   = hits;
+    last_misses = misses;
+    return 0;
+}
+
+int main(void)
+{
+    static const double huge[2] = { 30, SWS_PARAM_DEFAULT };
+    int ret = 0;
+
+    ret |= create("first",       1920, 1080, 320, 180, SWS_LANCZOS, NULL);
+    ret |= create("same",        1920, 1080, 320, 180, SWS_LANCZOS, NULL);
+    ret |= create("other size",  1920, 1080, 640, 360, SWS_LANCZOS, NULL);
+    ret |= create("other flags", 1920, 1080, 320, 180, SWS_BICUBIC, NULL);
+    ret |= create("first again", 1920, 1080, 320, 180, SWS_LANCZOS, NULL);
+
+    sws_flush_filter_cache();
+    ret |= create("after flush", 1920, 1080, 320, 180, SWS_LANCZOS, NULL);
+    ret |= create("same",        1920, 1080, 320, 180, SWS_LANCZOS, NULL);
+
+    /* the 240-tap horizontal luma filter is too large to be cached */
+    ret |= create("huge",       16384, 16, 4096, 16, SWS_LANCZOS, huge);
+    ret |= create("huge again", 16384, 16, 4096, 16, SWS_LANCZOS, huge);
+
+    sws_flush_filter_cache();
+    return ret;
+}
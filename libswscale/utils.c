@@ -795,6 +795,197 @@ done:
     return ret;
 }
 
+/*
+ * Process-wide cache of the filters computed by initFilter(). The filters
+ * only depend on the arguments of initFilter(), which capture the sizes,
+ * flags, chroma subsampling and siting of the formats involved, so contexts
+ * created over and over with the same parameters share the computation.
+ * The cache is bounded both in entries and in bytes, filters too large to
+ * be worth keeping are not cached, and sws_flush_filter_cache() frees it.
+ */
+#define FILTER_CACHE_SIZE      64
+#define FILTER_CACHE_MAX_BYTES (4 << 20)
+
+typedef struct FilterCacheKey {
+    int xInc, srcW, dstW, filterAlign, one, flags, cpu_flags;
+    int srcPos, dstPos;
+    double param[2];
+} FilterCacheKey;
+
+typedef struct FilterCacheEntry {
+    FilterCacheKey key;
+    int16_t  *filter;
+    int32_t  *filterPos;
+    int       filterSize;
+    size_t    size;
+    uint64_t  last_use;
+} FilterCacheEntry;
+
+static AVMutex filter_cache_lock = AV_MUTEX_INITIALIZER;
+static FilterCacheEntry filter_cache[FILTER_CACHE_SIZE];
+static uint64_t filter_cache_clock;
+static size_t   filter_cache_bytes;
+static uint64_t filter_cache_hits, filter_cache_misses;
+
+static int filter_cache_get(const FilterCacheKey *key, int16_t **outFilter,
+                            int32_t **filterPos, int *outFilterSize)
+{
+    int ret = 0;
+
+    ff_mutex_lock(&filter_cache_lock);
+    for (int i = 0; i < FILTER_CACHE_SIZE; i++) {
+        FilterCacheEntry *e = &filter_cache[i];
+
+        if (!e->filter || memcmp(&e->key, key, sizeof(*key)))
+            continue;
+
+        *filterPos = av_memdup(e->filterPos, (key->dstW + 3) * sizeof(*e->filterPos));
+        *outFilter = av_memdup(e->filter, e->filterSize * (key->dstW + 3) * sizeof(*e->filter));
+        if (!*filterPos || !*outFilter) {
+            av_freep(filterPos);
+            av_freep(outFilter);
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        *outFilterSize = e->filterSize;
+        e->last_use    = ++filter_cache_clock;
+        filter_cache_hits++;
+        ret = 1;
+        break;
+    }
+    if (!ret)
+        filter_cache_misses++;
+    ff_mutex_unlock(&filter_cache_lock);
+
+    return ret;
+}
+
+static void filter_cache_evict(FilterCacheEntry *e)
+{
+    filter_cache_bytes -= e->size;
+    av_freep(&e->filter);
+    av_freep(&e->filterPos);
+    memset(e, 0, sizeof(*e));
+}
+
+/* the least recently used entry, NULL if the cache is empty */
+static FilterCacheEntry *filter_cache_oldest(void)
+{
+    FilterCacheEntry *e = NULL;
+
+    for (int i = 0; i < FILTER_CACHE_SIZE; i++)
+        if (filter_cache[i].filter && (!e || filter_cache[i].last_use < e->last_use))
+            e = &filter_cache[i];
+    return e;
+}
+
+static void filter_cache_put(const FilterCacheKey *key, const int16_t *filter,
+                             const int32_t *filterPos, int filterSize)
+{
+    const size_t filter_size = filterSize * (key->dstW + 3) * sizeof(*filter);
+    const size_t pos_size    = (key->dstW + 3) * sizeof(*filterPos);
+    const size_t size        = filter_size + pos_size;
+    int16_t *filter_copy;
+    int32_t *filterPos_copy;
+    FilterCacheEntry *e = NULL;
+
+    /* do not let a few huge filters flush everything else */
+    if (size > FILTER_CACHE_MAX_BYTES / 4)
+        return;
+
+    filter_copy    = av_memdup(filter, filter_size);
+    filterPos_copy = av_memdup(filterPos, pos_size);
+    if (!filter_copy || !filterPos_copy) {
+        av_free(filter_copy);
+        av_free(filterPos_copy);
+        return;
+    }
+
+    ff_mutex_lock(&filter_cache_lock);
+    /* evict the least recently used entries until the new one fits */
+    while (filter_cache_bytes + size > FILTER_CACHE_MAX_BYTES)
+        filter_cache_evict(filter_cache_oldest());
+
+    for (int i = 0; i < FILTER_CACHE_SIZE && !e; i++)
+        if (!filter_cache[i].filter)
+            e = &filter_cache[i];
+    if (!e) {
+        e = filter_cache_oldest();
+        filter_cache_evict(e);
+    }
+
+    e->key        = *key;
+    e->filter     = filter_copy;
+    e->filterPos  = filterPos_copy;
+    e->filterSize = filterSize;
+    e->size       = size;
+    e->last_use   = ++filter_cache_clock;
+    filter_cache_bytes += size;
+    ff_mutex_unlock(&filter_cache_lock);
+}
+
+static av_cold int initFilterCached(int16_t **outFilter, int32_t **filterPos,
+                                    int *outFilterSize, int xInc, int srcW,
+                                    int dstW, int filterAlign, int one,
+                                    int flags, int cpu_flags,
+                                    SwsVector *srcFilter, SwsVector *dstFilter,
+                                    double param[2], int srcPos, int dstPos)
+{
+    FilterCacheKey key;
+    int ret;
+
+    /* user supplied vectors are not part of the key */
+    if (srcFilter || dstFilter)
+        return initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                          filterAlign, one, flags, cpu_flags, srcFilter, dstFilter,
+                          param, srcPos, dstPos);
+
+    /* zero the padding as well, keys are compared with memcmp() */
+    memset(&key, 0, sizeof(key));
+    key.xInc        = xInc;
+    key.srcW        = srcW;
+    key.dstW        = dstW;
+    key.filterAlign = filterAlign;
+    key.one         = one;
+    key.flags       = flags;
+    key.cpu_flags   = cpu_flags;
+    key.srcPos      = srcPos;
+    key.dstPos      = dstPos;
+    key.param[0]    = param[0];
+    key.param[1]    = param[1];
+
+    ret = filter_cache_get(&key, outFilter, filterPos, outFilterSize);
+    if (ret)
+        return FFMIN(ret, 0);
+
+    ret = initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                     filterAlign, one, flags, cpu_flags, NULL, NULL,
+                     param, srcPos, dstPos);
+    if (ret >= 0)
+        filter_cache_put(&key, *outFilter, *filterPos, *outFilterSize);
+
+    return ret;
+}
+
+void sws_flush_filter_cache(void)
+{
+    ff_mutex_lock(&filter_cache_lock);
+    for (int i = 0; i < FILTER_CACHE_SIZE; i++)
+        if (filter_cache[i].filter)
+            filter_cache_evict(&filter_cache[i]);
+    ff_mutex_unlock(&filter_cache_lock);
+}
+
+void sws_get_filter_cache_stats(uint64_t *hits, uint64_t *misses)
+{
+    ff_mutex_lock(&filter_cache_lock);
+    if (hits)
+        *hits   = filter_cache_hits;
+    if (misses)
+        *misses = filter_cache_misses;
+    ff_mutex_unlock(&filter_cache_lock);
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -1818,7 +2009,7 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
                                     have_lsx(cpu_flags)    ? 8 :
                                     have_lasx(cpu_flags)   ? 8 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if ((ret = initFilterCached(&c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
@@ -1829,7 +2020,7 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
                 goto fail;
             if (ff_shuffle_filter_coefficients(c, c->hLumFilterPos, c->hLumFilterSize, c->hLumFilter, dstW) < 0)
                 goto nomem;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if ((ret = initFilterCached(&c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1849,7 +2040,7 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
                                 PPC_ALTIVEC(cpu_flags) ? 8 :
                                 have_neon(cpu_flags)   ? 2 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if ((ret = initFilterCached(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
@@ -1857,7 +2048,7 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
                        get_local_pos(c, 0, 0, 1),
                        get_local_pos(c, 0, 0, 1))) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if ((ret = initFilterCached(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -2598,8 +2789,8 @@ int ff_range_add(RangeList *rl, unsigned int start, unsigned int len)
         Range *cur  = &rl->ranges[idx];
         if (prev->start + prev->len == cur->start) {
             prev->len += cur->len;
-            memmove(rl->ranges + idx - 1, rl->ranges + idx,
-                    sizeof(*rl->ranges) * (rl->nb_ranges - idx));
+            memmove(rl->ranges + idx, rl->ranges + idx + 1,
+                    sizeof(*rl->ranges) * (rl->nb_ranges - idx - 1));
             rl->nb_ranges--;
             idx--;
         }
@@ -0,0 +1,205 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Incremental slice scaling test.
+ *
+ * The source frame is made available in bands of rows, as a decoder calling
+ * draw_horiz_band would, and every band is forwarded with sws_send_slice().
+ * Output slices are requested as soon as possible after each band. The
+ * result must be identical to scaling the complete frame at once.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/lfg.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#define SRC_W 352
+#define SRC_H 288
+#define BAND  16
+
+static const struct {
+    const char *name;
+    enum AVPixelFormat src_fmt, dst_fmt;
+    int dst_w, dst_h, flags, threads;
+} tests[] = {
+    { "downscale",       AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P, 176, 144, SWS_BICUBIC, 1 },
+    { "upscale rgb",     AV_PIX_FMT_YUV420P, AV_PIX_FMT_RGB24,   640, 480, SWS_BILINEAR, 1 },
+    { "lanczos 444",     AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV444P, 200, 150, SWS_LANCZOS, 1 },
+    { "unscaled nv12",   AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12,    SRC_W, SRC_H, SWS_BICUBIC, 1 },
+    { "downscale, threads", AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P, 176, 144, SWS_BICUBIC, 3 },
+};
+
+static struct SwsContext *alloc_scaler(int i)
+{
+    struct SwsContext *sws = sws_alloc_context();
+    if (!sws)
+        return NULL;
+
+    av_opt_set_int(sws, "srcw",       SRC_W,              0);
+    av_opt_set_int(sws, "srch",       SRC_H,              0);
+    av_opt_set_int(sws, "src_format", tests[i].src_fmt,   0);
+    av_opt_set_int(sws, "dstw",       tests[i].dst_w,     0);
+    av_opt_set_int(sws, "dsth",       tests[i].dst_h,     0);
+    av_opt_set_int(sws, "dst_format", tests[i].dst_fmt,   0);
+    av_opt_set_int(sws, "sws_flags",  tests[i].flags | SWS_ACCURATE_RND | SWS_BITEXACT, 0);
+    av_opt_set_int(sws, "threads",    tests[i].threads,   0);
+
+    if (sws_init_context(sws, NULL, NULL) < 0) {
+        sws_freeContext(sws);
+        return NULL;
+    }
+    return sws;
+}
+
+static AVFrame *alloc_frame(enum AVPixelFormat format, int w, int h)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+
+    frame->format = format;
+    frame->width  = w;
+    frame->height = h;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+    return frame;
+}
+
+static int compare_frames(const AVFrame *a, const AVFrame *b)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->format);
+    int nb_planes = av_pix_fmt_count_planes(a->format);
+
+    for (int p = 0; p < nb_planes; p++) {
+        int shift = (p == 1 || p == 2) ? desc->log2_chroma_h : 0;
+        int h = AV_CEIL_RSHIFT(a->height, shift);
+        int bytes = av_image_get_linesize(a->format, a->width, p);
+
+        for (int y = 0; y < h; y++)
+            if (memcmp(a->data[p] + y * a->linesize[p],
+                       b->data[p] + y * b->linesize[p], bytes))
+                return 1;
+    }
+    return 0;
+}
+
+static int run_test(int i, const AVFrame *src)
+{
+    struct SwsContext *sws_ref = NULL, *sws = NULL;
+    AVFrame *ref = NULL, *dst = NULL;
+    unsigned int align;
+    int dst_done = 0, dst_before_last = 0;
+    int ret;
+
+    sws_ref = alloc_scaler(i);
+    sws     = alloc_scaler(i);
+    ref     = alloc_frame(tests[i].dst_fmt, tests[i].dst_w, tests[i].dst_h);
+    dst     = alloc_frame(tests[i].dst_fmt, tests[i].dst_w, tests[i].dst_h);
+    if (!sws_ref || !sws || !ref || !dst) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = sws_scale_frame(sws_ref, ref, src);
+    if (ret < 0)
+        goto end;
+
+    ret = sws_frame_start(sws, dst, src);
+    if (ret < 0)
+        goto end;
+
+    align = sws_receive_slice_alignment(sws);
+
+    for (int y = 0; y < SRC_H; y += BAND) {
+        ret = sws_send_slice(sws, y, FFMIN(BAND, SRC_H - y));
+        if (ret < 0)
+            goto end;
+
+        if (y + BAND >= SRC_H)
+            dst_before_last = dst_done;
+
+        /* produce every output slice whose source rows are available */
+        while (dst_done < dst->height) {
+            int h = FFMIN(FFALIGN(BAND, align), dst->height - dst_done);
+
+            ret = sws_receive_slice(sws, dst_done, h);
+            if (ret == AVERROR(EAGAIN))
+                break;
+            if (ret < 0)
+                goto end;
+            dst_done += h;
+        }
+    }
+    sws_frame_end(sws);
+
+    if (dst_done != dst->height) {
+        fprintf(stderr, "%s: only %d of %d rows were produced\n",
+                tests[i].name, dst_done, dst->height);
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    if (compare_frames(ref, dst)) {
+        fprintf(stderr, "%s: mismatch\n", tests[i].name);
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    printf("%s: %d of %d rows before the last band\n",
+           tests[i].name, dst_before_last, dst->height);
+    ret = 0;
+
+end:
+    av_frame_free(&ref);
+    av_frame_free(&dst);
+    sws_freeContext(sws_ref);
+    sws_freeContext(sws);
+    return ret;
+}
+
+int main(void)
+{
+    AVFrame *src = alloc_frame(AV_PIX_FMT_YUV420P, SRC_W, SRC_H);
+    AVLFG lfg;
+    int ret = 0;
+
+    if (!src)
+        return 1;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (int p = 0; p < 3; p++) {
+        int w = p ? SRC_W / 2 : SRC_W, h = p ? SRC_H / 2 : SRC_H;
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                src->data[p][y * src->linesize[p] + x] = av_lfg_get(&lfg);
+    }
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++)
+        if (run_test(i, src) < 0)
+            ret = 1;
+
+    av_frame_free(&src);
+    return ret;
+}
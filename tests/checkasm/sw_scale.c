@@ -22,6 +22,7 @@
 #include "libavutil/common.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/pixdesc.h"
 
 #include "libswscale/swscale.h"
 #include "libswscale/swscale_internal.h"
@@ -253,6 +254,131 @@ static void check_yuv2yuvX(int accurate)
 #undef FILTER_SIZES
 }
 
+static const enum AVPixelFormat hbd_formats[] = {
+    AV_PIX_FMT_YUV420P9LE, AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_YUV420P16LE,
+};
+
+static void check_yuv2plane1_hbd(void)
+{
+    struct SwsContext *ctx;
+    const int input_sizes[] = {8, 24, 128, 144, 256, 512};
+    const int INPUT_SIZES = sizeof(input_sizes)/sizeof(input_sizes[0]);
+#define HBD_PADDING 64
+
+    declare_func(void,
+                 const int16_t *src, uint8_t *dest,
+                 int dstW, const uint8_t *dither, int offset);
+
+    LOCAL_ALIGNED_32(int32_t, src_pixels, [LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [LARGEST_INPUT_SIZE + HBD_PADDING]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [LARGEST_INPUT_SIZE + HBD_PADDING]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+
+    randomize_buffers((uint8_t*)dither, 8);
+    randomize_buffers((uint8_t*)src_pixels, LARGEST_INPUT_SIZE * sizeof(int32_t));
+
+    ctx = sws_alloc_context();
+    if (sws_init_context(ctx, NULL, NULL) < 0)
+        fail();
+
+    for (int fi = 0; fi < FF_ARRAY_ELEMS(hbd_formats); fi++) {
+        ctx->dstFormat = hbd_formats[fi];
+        ctx->dstBpc    = av_pix_fmt_desc_get(ctx->dstFormat)->comp[0].depth;
+        ff_sws_init_scale(ctx);
+        for (int isi = 0; isi < INPUT_SIZES; isi++) {
+            int dstW = input_sizes[isi];
+            if (check_func(ctx->yuv2plane1, "yuv2yuv1_%dbit_%d", ctx->dstBpc, dstW)) {
+                memset(dst0, 0, sizeof(dst0[0]) * (LARGEST_INPUT_SIZE + HBD_PADDING));
+                memset(dst1, 0, sizeof(dst1[0]) * (LARGEST_INPUT_SIZE + HBD_PADDING));
+
+                call_ref((const int16_t *)src_pixels, (uint8_t *)dst0, dstW, dither, 0);
+                call_new((const int16_t *)src_pixels, (uint8_t *)dst1, dstW, dither, 0);
+                if (memcmp(dst0, dst1, dstW * sizeof(dst0[0]))) {
+                    fail();
+                    printf("failed: yuv2yuv1_%dbit_%d\n", ctx->dstBpc, dstW);
+                    show_differences((uint8_t *)dst0, (uint8_t *)dst1, dstW * sizeof(dst0[0]));
+                }
+                if (dstW == LARGEST_INPUT_SIZE)
+                    bench_new((const int16_t *)src_pixels, (uint8_t *)dst1, dstW, dither, 0);
+            }
+        }
+    }
+    sws_freeContext(ctx);
+}
+
+static void check_yuv2planeX_hbd(void)
+{
+    struct SwsContext *ctx;
+    const int filter_sizes[] = {2, 4, 8, 16};
+    const int FILTER_SIZES = sizeof(filter_sizes)/sizeof(filter_sizes[0]);
+    const int input_sizes[] = {8, 24, 128, 144, 256, 512};
+    const int INPUT_SIZES = sizeof(input_sizes)/sizeof(input_sizes[0]);
+    const int16_t *src[LARGEST_FILTER];
+
+    declare_func(void, const int16_t *filter, int filterSize,
+                 const int16_t **src, uint8_t *dest,
+                 int dstW, const uint8_t *dither, int offset);
+
+    LOCAL_ALIGNED_32(int32_t, src_pixels, [LARGEST_FILTER * LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_16(int16_t, filter_coeff, [LARGEST_FILTER]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [LARGEST_INPUT_SIZE + HBD_PADDING]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [LARGEST_INPUT_SIZE + HBD_PADDING]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+
+    randomize_buffers((uint8_t*)dither, 8);
+
+    ctx = sws_alloc_context();
+    if (sws_init_context(ctx, NULL, NULL) < 0)
+        fail();
+
+    for (int fi = 0; fi < FF_ARRAY_ELEMS(hbd_formats); fi++) {
+        ctx->dstFormat = hbd_formats[fi];
+        ctx->dstBpc    = av_pix_fmt_desc_get(ctx->dstFormat)->comp[0].depth;
+        ff_sws_init_scale(ctx);
+
+        // The 16-bit output reads 19-bit intermediates, the others 15-bit ones.
+        for (int i = 0; i < LARGEST_FILTER * LARGEST_INPUT_SIZE; i++) {
+            if (ctx->dstBpc == 16)
+                src_pixels[i] = rnd() & ((1 << 19) - 1);
+            else
+                ((int16_t *)src_pixels)[i] = rnd() & ((1 << 15) - 1);
+        }
+
+        for (int isi = 0; isi < INPUT_SIZES; isi++) {
+            int dstW = input_sizes[isi];
+            for (int fsi = 0; fsi < FILTER_SIZES; fsi++) {
+                int fs = filter_sizes[fsi];
+
+                // Same scheme as check_yuv2yuvX(): coefficients summing to
+                // 1 << 12 with negative taps, without overflowing.
+                for (int i = 0; i < fs; i++)
+                    filter_coeff[i] = -((1 << 12) / (fs - 1));
+                filter_coeff[rnd() % fs] = (1 << 13) - 1;
+
+                for (int i = 0; i < fs; i++)
+                    src[i] = ctx->dstBpc == 16 ? (const int16_t *)&src_pixels[i * LARGEST_INPUT_SIZE]
+                                               : &((const int16_t *)src_pixels)[i * LARGEST_INPUT_SIZE];
+
+                if (check_func(ctx->yuv2planeX, "yuv2yuvX_%dbit_%d_%d", ctx->dstBpc, fs, dstW)) {
+                    memset(dst0, 0, sizeof(dst0[0]) * (LARGEST_INPUT_SIZE + HBD_PADDING));
+                    memset(dst1, 0, sizeof(dst1[0]) * (LARGEST_INPUT_SIZE + HBD_PADDING));
+
+                    call_ref(filter_coeff, fs, src, (uint8_t *)dst0, dstW, dither, 0);
+                    call_new(filter_coeff, fs, src, (uint8_t *)dst1, dstW, dither, 0);
+                    if (memcmp(dst0, dst1, dstW * sizeof(dst0[0]))) {
+                        fail();
+                        printf("failed: yuv2yuvX_%dbit_%d_%d\n", ctx->dstBpc, fs, dstW);
+                        show_differences((uint8_t *)dst0, (uint8_t *)dst1, dstW * sizeof(dst0[0]));
+                    }
+                    if (dstW == LARGEST_INPUT_SIZE)
+                        bench_new(filter_coeff, fs, src, (uint8_t *)dst1, dstW, dither, 0);
+                }
+            }
+        }
+    }
+    sws_freeContext(ctx);
+}
+
 #undef SRC_PIXELS
 #define SRC_PIXELS 512
 
@@ -368,4 +494,8 @@ void checkasm_check_sw_scale(void)
     check_yuv2yuvX(0);
     check_yuv2yuvX(1);
     report("yuv2yuvX");
+    check_yuv2plane1_hbd();
+    report("yuv2yuv1_hbd");
+    check_yuv2planeX_hbd();
+    report("yuv2yuvX_hbd");
 }
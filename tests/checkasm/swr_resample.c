@@ -0,0 +1,130 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/samplefmt.h"
+
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define DST_LEN 512
+/* enough input for DST_LEN outputs at the lowest rate ratio tested,
+ * plus the longest filter and room for reads past its end */
+#define SRC_LEN (DST_LEN * 2 + 512)
+
+static void randomize_samples(void *buf, int len, enum AVSampleFormat fmt)
+{
+    for (int i = 0; i < len; i++) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P: ((int16_t *)buf)[i] = rnd();                       break;
+        case AV_SAMPLE_FMT_S32P: ((int32_t *)buf)[i] = rnd();                       break;
+        case AV_SAMPLE_FMT_FLTP: ((float   *)buf)[i] = (rnd() & 0xFFFF) / 32768.0f - 1.0f; break;
+        case AV_SAMPLE_FMT_DBLP: ((double  *)buf)[i] = (rnd() & 0xFFFF) / 32768.0  - 1.0;  break;
+        default: break;
+        }
+    }
+}
+
+static int compare_samples(const void *ref, const void *new, int len, enum AVSampleFormat fmt)
+{
+    switch (fmt) {
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array(ref, new, 1e-5f, len);
+    case AV_SAMPLE_FMT_DBLP:
+        return !double_near_abs_eps_array(ref, new, 1e-12, len);
+    default:
+        return memcmp(ref, new, len * av_get_bytes_per_sample(fmt));
+    }
+}
+
+static void check_resample(enum AVSampleFormat fmt, int in_rate, int out_rate,
+                           int filter_size, int phase_shift, int linear)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,     [SRC_LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst_ref, [DST_LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst_new, [DST_LEN * 8]);
+    const int bps = av_get_bytes_per_sample(fmt);
+    ResampleContext *c, c_ref, c_new;
+    int (*resample)(ResampleContext *c, void *dst, const void *src, int n, int update_ctx);
+
+    declare_func(int, ResampleContext *c, void *dst, const void *src,
+                 int n, int update_ctx);
+
+    c = swri_resampler.init(NULL, out_rate, in_rate, filter_size, phase_shift,
+                            linear, 0, fmt, SWR_FILTER_TYPE_KAISER, 9, 0, 0, 1);
+    if (!c) {
+        fail();
+        return;
+    }
+    /* start in the middle of a phase to exercise the interpolation */
+    c->frac  = c->src_incr / 3;
+    c->index = c->phase_count / 2;
+
+    resample = linear ? c->dsp.resample_linear : c->dsp.resample_common;
+    if (check_func(resample, "resample_%s_%s_%d_%d_%d", linear ? "linear" : "common",
+                   av_get_sample_fmt_name(fmt), in_rate, out_rate, filter_size)) {
+        int ret_ref, ret_new;
+
+        randomize_samples(src, SRC_LEN, fmt);
+        memset(dst_ref, 0, DST_LEN * bps);
+        memset(dst_new, 0, DST_LEN * bps);
+
+        c_ref = c_new = *c;
+        ret_ref = call_ref(&c_ref, dst_ref, src, DST_LEN, 1);
+        ret_new = call_new(&c_new, dst_new, src, DST_LEN, 1);
+        if (ret_ref != ret_new || c_ref.index != c_new.index ||
+            c_ref.frac != c_new.frac ||
+            compare_samples(dst_ref, dst_new, DST_LEN, fmt))
+            fail();
+
+        c_new = *c;
+        bench_new(&c_new, dst_new, src, DST_LEN, 1);
+    }
+
+    swri_resampler.free(&c);
+}
+
+void checkasm_check_swr_resample(void)
+{
+    static const enum AVSampleFormat fmts[] = {
+        AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P,
+        AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP,
+    };
+    static const struct {
+        int in_rate, out_rate, filter_size, phase_shift;
+    } cfgs[] = {
+        { 44100, 48000, 32, 10 },
+        { 48000, 44100, 16, 10 },
+        { 96000, 48000, 64, 12 },
+        /* 16 taps fill the rows of the filter bank, 35 are padded to 40 */
+        { 44100, 48000, 16, 10 },
+        { 48000, 44100, 35, 10 },
+    };
+
+    for (int linear = 0; linear < 2; linear++) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(fmts); i++)
+            for (int j = 0; j < FF_ARRAY_ELEMS(cfgs); j++)
+                check_resample(fmts[i], cfgs[j].in_rate, cfgs[j].out_rate,
+                               cfgs[j].filter_size, cfgs[j].phase_shift, linear);
+        report(linear ? "resample_linear" : "resample_common");
+    }
+}
@@ -306,6 +306,39 @@ stream_remux(){
         run ffprobe${PROGSUF}${EXECSUF} -bitexact $ffprobe_opts $tencfile || return
 }
 
+# Probe srcfile twice with the stream info cache. The second run has to
+# restore the information from the cache and print the same as the first.
+stream_info_cache(){
+    srcfile=$1
+    cachedir="${outdir}/${test}.cache"
+    firstfile="${outdir}/${test}.first"
+    secondfile="${outdir}/${test}.second"
+    logfile="${outdir}/${test}.log"
+    test $keep -ge 1 || cleanfiles="$cleanfiles $firstfile $secondfile $logfile"
+    rm -rf $cachedir
+    probe="ffprobe${PROGSUF}${EXECSUF} -bitexact -show_streams -show_format \
+           -stream_info_cache $(target_path $cachedir) $(target_path $srcfile) \
+           -print_filename $srcfile"
+    run $probe > $firstfile || return
+    run $probe -v verbose > $secondfile 2> $logfile || return
+    grep -q "Stream info restored" $logfile || echo "stream info cache not used"
+    diff -u $firstfile $secondfile || return
+    cat $firstfile
+    test $keep -ge 1 || rm -rf $cachedir
+}
+
+# Run ffmpeg with -sched_stats and print the parts of the last update that do
+# not depend on timing: the nodes, whether they are running and the capacity
+# of their input queues.
+sched_stats(){
+    statsfile="${outdir}/${test}.stats"
+    test $keep -ge 1 || cleanfiles="$cleanfiles $statsfile"
+    ffmpeg -sched_stats $(target_path $statsfile) "$@" -f null - || return
+    tail -n 1 $statsfile | tr '{' '\n' | sed -n \
+        -e 's/^"type":"\([a-z]*\)","index":\([0-9]*\),"running":\([0-9]*\),.*/\1 \2 running:\3/p' \
+        -e 's/^"capacity":\([0-9]*\),.*/    queue capacity:\1/p'
+}
+
 # this function is for testing external encoders,
 # where the precise output is not controlled by us
 # we can still test e.g. that the output can be decoded correctly
@@ -22,6 +22,10 @@ fate-lavf-flv: KEEP_FILES ?= 1
 fate-api-seek: CMD = run $(APITESTSDIR)/api-seek-test$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.flv 0 720
 fate-api-seek: CMP = null
 
+FATE_API_LIBSWSCALE-yes += fate-api-sws-slice
+fate-api-sws-slice: $(APITESTSDIR)/api-sws-slice-test$(EXESUF)
+fate-api-sws-slice: CMD = run $(APITESTSDIR)/api-sws-slice-test$(EXESUF)
+
 FATE_API-$(HAVE_THREADS) += fate-api-threadmessage
 fate-api-threadmessage: $(APITESTSDIR)/api-threadmessage-test$(EXESUF)
 fate-api-threadmessage: CMD = run $(APITESTSDIR)/api-threadmessage-test$(EXESUF) 3 10 30 50 2 20 40
@@ -35,6 +39,7 @@ endif
 
 FATE_API-$(CONFIG_AVCODEC) += $(FATE_API_LIBAVCODEC-yes)
 FATE_API-$(CONFIG_AVFORMAT) += $(FATE_API_LIBAVFORMAT-yes)
+FATE_API-$(CONFIG_SWSCALE) += $(FATE_API_LIBSWSCALE-yes)
 FATE_API = $(FATE_API-yes)
 
 FATE-yes += $(FATE_API) $(FATE_API_SAMPLES)
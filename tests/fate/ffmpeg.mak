@@ -23,6 +23,49 @@ fate-force_key_frames: CMD = enc_dec \
   avi "-c mpeg4 -g 240 -qscale 10 -force_key_frames 0.5,0:00:01.5" \
   framecrc "" "-skip_frame nokey"
 
+# Decode and encode with buffers from an arena that holds all the frames in
+# flight, and from one that is too small even for the decoder's reference
+# frames, so that it allocates beyond its size target. Both must give the
+# same output as without arena.
+FATE_FFMPEG_BUFFER_ARENA = fate-ffmpeg-buffer-arena fate-ffmpeg-buffer-arena-overflow
+FATE_FFMPEG-$(call ENCDEC2, MPEG4, RAWVIDEO, AVI, RAWVIDEO_DEMUXER RAWVIDEO_MUXER) += $(FATE_FFMPEG_BUFFER_ARENA)
+fate-ffmpeg-buffer-arena:          ARENA_SIZE = 16777216
+fate-ffmpeg-buffer-arena-overflow: ARENA_SIZE = 131072
+$(FATE_FFMPEG_BUFFER_ARENA): tests/data/vsynth1.yuv
+$(FATE_FFMPEG_BUFFER_ARENA): CMD = enc_dec \
+  "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv \
+  avi "-c mpeg4 -bf 2 -qscale 10 -frames:v 10" rawvideo "" "-buffer_arena_size $(ARENA_SIZE)"
+
+# an mpeg4 file with B-frames, for the tests below that have to decode
+tests/data/mpeg4-bframes.avi: TAG = GEN
+tests/data/mpeg4-bframes.avi: tests/data/vsynth1.yuv
+tests/data/mpeg4-bframes.avi: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+        -flags +bitexact -fflags +bitexact -idct simple -dct fastint -threads 1 \
+        -c:v mpeg4 -qscale 10 -bf 2 -frames:v 20 \
+        -y $(TARGET_PATH)/tests/data/mpeg4-bframes.avi 2>/dev/null
+
+# frame threads limited to one frame of delay must decode like one thread
+FATE_FFMPEG_THREAD_MAX_DELAY = fate-ffmpeg-mpeg4-decode fate-ffmpeg-thread-max-delay
+FATE_FFMPEG-$(call FRAMECRC, AVI, MPEG4, RAWVIDEO_DEMUXER MPEG4_ENCODER AVI_MUXER) += $(FATE_FFMPEG_THREAD_MAX_DELAY)
+$(FATE_FFMPEG_THREAD_MAX_DELAY): tests/data/mpeg4-bframes.avi
+fate-ffmpeg-mpeg4-decode: CMD = framecrc -i $(TARGET_PATH)/tests/data/mpeg4-bframes.avi -c:v rawvideo
+fate-ffmpeg-thread-max-delay: CMD = threads=4 thread_type=frame framecrc -thread_max_delay 1 -i $(TARGET_PATH)/tests/data/mpeg4-bframes.avi -c:v rawvideo
+fate-ffmpeg-thread-max-delay: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-mpeg4-decode
+
+# a memory budget far too small for any packet or frame throttles the input
+# all the time, but must not stall or change the output
+FATE_FFMPEG-$(call FRAMECRC, AVI, MPEG4, RAWVIDEO_DEMUXER MPEG4_ENCODER AVI_MUXER) += fate-ffmpeg-sched-mem-budget
+fate-ffmpeg-sched-mem-budget: tests/data/mpeg4-bframes.avi
+fate-ffmpeg-sched-mem-budget: CMD = framecrc -sched_mem_budget 1 -i $(TARGET_PATH)/tests/data/mpeg4-bframes.avi -c:v rawvideo
+fate-ffmpeg-sched-mem-budget: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-mpeg4-decode
+
+# only the parts of the scheduler statistics that do not depend on timing
+FATE_FFMPEG-$(call FRAMECRC, AVI, MPEG4, RAWVIDEO_DEMUXER MPEG4_ENCODER AVI_MUXER NULL_MUXER) += fate-ffmpeg-sched-stats
+fate-ffmpeg-sched-stats: tests/data/mpeg4-bframes.avi
+fate-ffmpeg-sched-stats: CMD = sched_stats -i $(TARGET_PATH)/tests/data/mpeg4-bframes.avi -c:v rawvideo
+
 # test -force_key_frames source with and without framerate conversion
 # * we don't care about the actual video content, so replace it with
 #   a 2x2 black square to speed up encoding
@@ -43,6 +43,16 @@ fate-ffprobe_xsd: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xsd: CMD = run $(FFPROBE_COMMAND) -noprivate -of xml=q=1:x=1 | \
 	xmllint --schema $(SRC_PATH)/doc/ffprobe.xsd -
 
+FATE_FFPROBE-$(call ALLYES, AVDEVICE ARESAMPLE_FILTER) += fate-ffprobe_stream_info_cache
+fate-ffprobe_stream_info_cache: $(FFPROBE_TEST_FILE)
+fate-ffprobe_stream_info_cache: CMD = stream_info_cache $(FFPROBE_TEST_FILE)
+
+# decoding the streams in parallel during analysis must not change the result
+FATE_FFPROBE-$(call ALLYES, AVDEVICE ARESAMPLE_FILTER) += fate-ffprobe_analyze_threads
+fate-ffprobe_analyze_threads: $(FFPROBE_TEST_FILE)
+fate-ffprobe_analyze_threads: CMD = run $(FFPROBE_COMMAND) -analyze_threads 3 -of compact
+fate-ffprobe_analyze_threads: REF = $(SRC_PATH)/tests/ref/fate/ffprobe_compact
+
 FATE_FFPROBE-$(HAVE_XMLLINT) += $(FATE_FFPROBE_SCHEMA-yes)
 FATE_FFPROBE += $(FATE_FFPROBE-yes)
 
@@ -0,0 +1,21 @@
+# Asynchronous I/O must read and write the same bytes as synchronous I/O.
+# The chunks are much smaller than the packets, so most requests are only
+# partly consumed and the request queue wraps many times.
+FATE_FILE-$(call TRANSCODE, RAWVIDEO, NUT, RAWVIDEO_DEMUXER) += fate-file-aio-threads
+fate-file-aio-threads: tests/data/vsynth1.yuv
+fate-file-aio-threads: CMD = transcode rawvideo tests/data/vsynth1.yuv nut \
+  "-c copy -aio threads -aio_depth 3 -aio_chunk_size 65536" "-c copy" "" "" \
+  "-aio threads -aio_depth 2 -aio_chunk_size 4096" \
+  "-s 352x288 -pix_fmt yuv420p -aio threads -aio_depth 4 -aio_chunk_size 12288"
+
+# io_uring if available, direct reads where the file system allows them,
+# and a seek in the asynchronously read output.
+FATE_FILE-$(call TRANSCODE, RAWVIDEO, NUT, RAWVIDEO_DEMUXER) += fate-file-aio-auto
+fate-file-aio-auto: tests/data/vsynth1.yuv
+fate-file-aio-auto: CMD = transcode rawvideo tests/data/vsynth1.yuv nut \
+  "-c copy -aio auto -aio_chunk_size 8192" "-c copy" "" "" \
+  "-aio auto -aio_chunk_size 16384 -direct 1 -ss 1" \
+  "-s 352x288 -pix_fmt yuv420p -aio auto -aio_depth 8 -aio_chunk_size 4096 -direct 1"
+
+FATE_FFMPEG += $(FATE_FILE-yes)
+fate-file: $(FATE_FILE-yes)
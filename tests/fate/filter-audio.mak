@@ -124,6 +124,12 @@ fate-filter-extrastereo: tests/data/asynth-44100-2.wav
 fate-filter-extrastereo: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
 fate-filter-extrastereo: CMD = framecrc -i $(SRC) -frames:a 20 -af aresample,extrastereo=m=2,aresample
 
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, EXTRASTEREO ARESAMPLE, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-extrastereo-frame-threads
+fate-filter-extrastereo-frame-threads: tests/data/asynth-44100-2.wav
+fate-filter-extrastereo-frame-threads: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+fate-filter-extrastereo-frame-threads: CMD = framecrc -filter_threads 4 -filter_frame_threads -i $(SRC) -frames:a 20 -af aresample,extrastereo=m=2,aresample
+fate-filter-extrastereo-frame-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-extrastereo
+
 FATE_AFILTER-$(call FILTERDEMDECENCMUX, FIREQUALIZER ATRIM VOLUME ARESAMPLE, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-firequalizer
 fate-filter-firequalizer: tests/data/asynth-44100-2.wav
 fate-filter-firequalizer: tests/data/filtergraphs/firequalizer
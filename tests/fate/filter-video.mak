@@ -82,6 +82,14 @@ fate-filter-lavd-life: CMD = framecrc -f lavfi -i life=s=40x40:r=5:seed=42:mold=
 FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC, LAVFI_INDEV) += fate-filter-lavd-testsrc
 fate-filter-lavd-testsrc: CMD = framecrc -f lavfi -i testsrc=r=7:n=2:d=10
 
+SCALE_MULTI_GRAPH = testsrc=s=320x240:r=25:d=0.2,scale_multi=sizes=160x120|352x288|64x48:formats=yuv420p|yuvj444p|gray:flags=+accurate_rnd+bitexact[out0][out1][out2]
+
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC SCALE_MULTI, LAVFI_INDEV) += fate-filter-scale_multi
+fate-filter-scale_multi: CMD = framecrc -f lavfi -i "$(SCALE_MULTI_GRAPH)" -map 0
+
+FATE_FILTER_FFPROBE-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SCALE_MULTI_FILTER) += fate-filter-scale_multi-props
+fate-filter-scale_multi-props: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -of compact=p=0 -show_entries frame=stream_index,width,height,pix_fmt,sample_aspect_ratio,color_range,color_space -bitexact -f lavfi "$(SCALE_MULTI_GRAPH)"
+
 FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2) += $(addprefix fate-filter-testsrc2-, yuv420p yuv444p rgb24 rgba)
 fate-filter-testsrc2-%: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt $(word 4, $(subst -, ,$(@)))
 
@@ -128,6 +136,36 @@ FATE_FILTER-$(call FILTERFRAMECRC, MINTERPOLATE TESTSRC2) += fate-filter-minterp
 fate-filter-minterpolate-up: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolate=fps=10 -t 1
 fate-filter-minterpolate-down: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolate=fps=1 -t 1
 
+FATE_FILTER-$(call FILTERFRAMECRC, MINTERPOLATE TESTSRC2) += fate-filter-minterpolate-ds
+fate-filter-minterpolate-ds: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolate=fps=10:me=ds -t 1
+
+FATE_FILTER-$(call FILTERFRAMECRC, MINTERPOLATE TESTSRC2) += fate-filter-minterpolate-umh
+fate-filter-minterpolate-umh: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolate=fps=10:me=umh:me_mode=bilat -t 1
+
+FATE_FILTER-$(call FILTERFRAMECRC, DESHAKE TESTSRC2) += fate-filter-deshake-testsrc2
+fate-filter-deshake-testsrc2: CMD = framecrc -lavfi testsrc2=r=5:d=2,deshake
+
+FATE_FILTER-$(call FILTERFRAMECRC, PALETTEGEN PALETTEUSE SPLIT TESTSRC2) += fate-filter-palette-testsrc2
+fate-filter-palette-testsrc2: CMD = framecrc -lavfi "testsrc2=r=5:d=1,split[a][b];[b]palettegen=stats_mode=diff[p];[a][p]paletteuse=sierra2_4a"
+
+# slice threaded filters must give the same output as with a single thread
+FATE_FILTER-$(call FILTERFRAMECRC, MINTERPOLATE TESTSRC2) += fate-filter-minterpolate-up-threads fate-filter-minterpolate-ds-threads
+fate-filter-minterpolate-up-threads: CMD = framecrc -filter_complex_threads 4 -lavfi testsrc2=r=2:d=10,minterpolate=fps=10 -t 1
+fate-filter-minterpolate-up-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-up
+fate-filter-minterpolate-ds-threads: CMD = framecrc -filter_complex_threads 4 -lavfi testsrc2=r=2:d=10,minterpolate=fps=10:me=ds -t 1
+fate-filter-minterpolate-ds-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-ds
+FATE_FILTER-$(call FILTERFRAMECRC, MINTERPOLATE TESTSRC2) += fate-filter-minterpolate-umh-threads
+fate-filter-minterpolate-umh-threads: CMD = framecrc -filter_complex_threads 4 -lavfi testsrc2=r=2:d=10,minterpolate=fps=10:me=umh:me_mode=bilat -t 1
+fate-filter-minterpolate-umh-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-umh
+
+FATE_FILTER-$(call FILTERFRAMECRC, DESHAKE TESTSRC2) += fate-filter-deshake-testsrc2-threads
+fate-filter-deshake-testsrc2-threads: CMD = framecrc -filter_complex_threads 4 -lavfi testsrc2=r=5:d=2,deshake
+fate-filter-deshake-testsrc2-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-deshake-testsrc2
+
+FATE_FILTER-$(call FILTERFRAMECRC, PALETTEGEN PALETTEUSE SPLIT TESTSRC2) += fate-filter-palette-testsrc2-threads
+fate-filter-palette-testsrc2-threads: CMD = framecrc -filter_complex_threads 4 -lavfi "testsrc2=r=5:d=1,split[a][b];[b]palettegen=stats_mode=diff[p];[a][p]paletteuse=sierra2_4a"
+fate-filter-palette-testsrc2-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-palette-testsrc2
+
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_BOXBLUR_FILTER) += fate-filter-boxblur
 fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf boxblur=2:1
 
@@ -330,9 +368,25 @@ fate-filter-untile-yuv422p: CMD = framecrc -lavfi testsrc2=d=1:r=2,format=yuv422
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_UNSHARP_FILTER) += fate-filter-unsharp
 fate-filter-unsharp: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf unsharp=11:11:-1.5:11:11:-1.5
 
+# the frame-threaded filters of the chain must give the same output when they
+# run on worker threads
+FATE_FILTER_FRAME_THREADS = fate-filter-frame-threads-serial fate-filter-frame-threads
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, YADIF_FILTER SCALE_FILTER UNSHARP_FILTER HQDN3D_FILTER) += $(FATE_FILTER_FRAME_THREADS)
+$(FATE_FILTER_FRAME_THREADS): FRAME_THREADS_CHAIN = yadif,scale=176:144:flags=bicubic+accurate_rnd+bitexact,unsharp,hqdn3d
+fate-filter-frame-threads-serial: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf $(FRAME_THREADS_CHAIN)
+fate-filter-frame-threads: CMD = framecrc -filter_threads 4 -filter_frame_threads -c:v pgmyuv -i $(SRC) -vf $(FRAME_THREADS_CHAIN)
+fate-filter-frame-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-frame-threads-serial
+
 FATE_FILTER_VSYNTH-$(call FILTERFRAMECRC, TESTSRC2 SCALE UNSHARP) += fate-filter-unsharp-yuv420p10
 fate-filter-unsharp-yuv420p10: CMD = framecrc -lavfi testsrc2=r=2:d=10,scale,format=yuv420p10,unsharp=11:11:-1.5:11:11:-1.5,scale -pix_fmt yuv420p10le -flags +bitexact -sws_flags +accurate_rnd+bitexact
 
+# bt2390 and gamma are interpolated from a lut, the others are evaluated directly
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 SCALE FORMAT EXPOSURE TONEMAP) += $(addprefix fate-filter-tonemap-, bt2390 gamma hable)
+fate-filter-tonemap-%: CMD = framecrc -lavfi testsrc2=r=2:d=1,scale,format=gbrpf32le,exposure=3,tonemap=$(@:fate-filter-tonemap-%=%):peak=8:desat=0,scale -pix_fmt gbrp -flags +bitexact -sws_flags +accurate_rnd+bitexact
+
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 SCALE FORMAT EXPOSURE TONEMAP) += fate-filter-tonemap-desat
+fate-filter-tonemap-desat: CMD = framecrc -lavfi testsrc2=r=2:d=1,scale,format=gbrpf32le,exposure=3,tonemap=hable:peak=8,scale -pix_fmt gbrp -flags +bitexact -sws_flags +accurate_rnd+bitexact
+
 FATE_FILTER_SAMPLES-$(call FILTERDEMDEC, PERMS HQDN3D, SMJPEG, MJPEG) += fate-filter-hqdn3d-sample
 fate-filter-hqdn3d-sample: tests/data/filtergraphs/hqdn3d
 fate-filter-hqdn3d-sample: CMD = framecrc -idct simple -i $(TARGET_SAMPLES)/smjpeg/scenwin.mjpg -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/hqdn3d -an
@@ -754,9 +808,10 @@ FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SPLIT_FILTER AVGBLUR_FILTER        \
                            PIPE_PROTOCOL) += $(FATE_FILTER_REFCMP_METADATA-yes)
 
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
+FATE_FFPROBE += $(FATE_FILTER_FFPROBE-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
 
-fate-vfilter: $(FATE_FILTER-yes) $(FATE_FILTER_SAMPLES-yes) $(FATE_FILTER_VSYNTH-yes)
+fate-vfilter: $(FATE_FILTER-yes) $(FATE_FILTER_FFPROBE-yes) $(FATE_FILTER_SAMPLES-yes) $(FATE_FILTER_VSYNTH-yes)
 
 fate-filter: fate-afilter fate-vfilter $(FATE_METADATA_FILTER-yes)
@@ -227,6 +227,21 @@ fate-hevc-bsf-mp4toannexb: REF = 73019329ed7f81c24f9af67c34c640c0
 fate-hevc-skiploopfilter: CMD = framemd5 -skip_loop_filter nokey -i $(TARGET_SAMPLES)/hevc-conformance/SAO_D_Samsung_5.bit -sws_flags bitexact
 FATE_HEVC-$(call FRAMEMD5, HEVC, HEVC, HEVC_PARSER) += fate-hevc-skiploopfilter
 
+# with more than MAX_AUTO_THREADS threads, every frame thread also decodes
+# the WPP rows of its picture on the shared slice threads; the output must
+# match the conformance references
+HEVC_SAMPLES_FRAME_SLICE_THREADS =  \
+    WPP_A_ericsson_MAIN_2           \
+    WPP_B_ericsson_MAIN_2           \
+    WPP_C_ericsson_MAIN_2           \
+    WPP_D_ericsson_MAIN_2           \
+    WPP_E_ericsson_MAIN_2           \
+    WPP_F_ericsson_MAIN_2           \
+
+FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER) += $(HEVC_SAMPLES_FRAME_SLICE_THREADS:%=fate-hevc-frame-slice-threads-%)
+fate-hevc-frame-slice-threads-%: CMD = threads=32 thread_type=frame+slice framecrc -flags unaligned -i $(TARGET_SAMPLES)/hevc-conformance/$(@:fate-hevc-frame-slice-threads-%=%).bit -pix_fmt yuv420p
+fate-hevc-frame-slice-threads-%: REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(@:fate-hevc-frame-slice-threads-%=%)
+
 # this sample has two stsd entries and needs to reload extradata
 FATE_HEVC-$(call FRAMEMD5, MOV, HEVC, SCALE_FILTER) += fate-hevc-extradata-reload
 fate-hevc-extradata-reload: CMD = framemd5 -i $(TARGET_SAMPLES)/hevc/extradata-reload-multi-stsd.mov -sws_flags bitexact
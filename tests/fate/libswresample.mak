@@ -1085,6 +1085,14 @@ $(call CROSS_TEST,$(SAMPLERATES_LITE),ARESAMPLE_EXACT_LIN_ASYNC,dblp,f64le,s16)
 FATE_SWR_RESAMPLE-$(call FILTERDEMDEC, ARESAMPLE ASETPTS ATRIM SINE, , PCM_S16LE, LAVFI_INDEV) += fate-swr-async-firstpts
 fate-swr-async-firstpts: CMD = framecrc -auto_conversion_filters -copyts -f lavfi -i "sine=r=1000:samples_per_frame=100,asetpts=PTS+S+S*floor(ld(1)/4)+st(1\,ld(1)+1)*0,atrim=end=2" -filter:a aresample=async=300:first_pts=0
 
+# channel-parallel resampling and rematrixing must match the single-threaded
+# output; the frames are large enough to be split between the threads
+SWR_THREADS_SRC = aevalsrc=sin(440*2*PI*t)|sin(550*2*PI*t)|sin(660*2*PI*t)|sin(770*2*PI*t)|sin(880*2*PI*t)|sin(990*2*PI*t)|sin(1100*2*PI*t)|sin(1210*2*PI*t):c=7.1:s=48000:n=16384:d=1
+FATE_SWR_THREADS-$(call FILTERDEMDEC, AEVALSRC ARESAMPLE AFORMAT, , , LAVFI_INDEV PCM_F32LE_ENCODER) += $(addprefix fate-swr-threads-, 1 4)
+fate-swr-threads-%: CMD = framecrc -filter_threads $(@:fate-swr-threads-%=%) -f lavfi -i "$(SWR_THREADS_SRC)" -af aresample=44100:ochl=5.1:filter_size=64,aformat=flt -c:a pcm_f32le
+fate-swr-threads-4: REF = $(SRC_PATH)/tests/ref/fate/swr-threads-1
+FATE_SWR += $(FATE_SWR_THREADS-yes)
+
 FATE_SWR_RESAMPLE-$(call FILTERDEMDECENCMUX, ARESAMPLE, WAV, PCM_S16LE, PCM_S16LE, WAV) += $(FATE_SWR_RESAMPLE)
 fate-swr-resample: $(FATE_SWR_RESAMPLE-yes)
 FATE_SWR += $(FATE_SWR_RESAMPLE-yes)
@@ -257,6 +257,21 @@ fate-mov-mp4-iamf-ambisonic_1: CMD = transcode wav $(SRC) mp4 "-auto_conversion_
   -streamid 0:0 -streamid 1:1 -streamid 2:2 -streamid 3:3 -map [MONO0] -map [MONO1] -map [MONO2] -map [MONO3] -c:a flac -t 1" "-c:a copy -map 0" \
   "-show_entries stream_group=index,id,nb_streams,type:stream_group_components:stream_group_disposition:stream_group_tags:stream_group_stream=index,id:stream_group_stream_disposition"
 
+# The lazy index must return the same packets as the full index. The file
+# is read through the async protocol, as the I/O buffers are only sized for
+# the interleaving of the tracks with protocols that are not local.
+FATE_MOV_LAZY_INDEX-$(call FRAMECRC, MOV, , ASYNC_PROTOCOL) += fate-mov-lazy-index fate-mov-lazy-index-full
+fate-mov-lazy-index:      CMD = framecrc -ignore_editlist 1 -lazy_index 1 -i async:$(TARGET_PATH)/tests/data/lavf/lavf.mov -c copy
+fate-mov-lazy-index-full: CMD = framecrc -ignore_editlist 1 -i async:$(TARGET_PATH)/tests/data/lavf/lavf.mov -c copy
+fate-mov-lazy-index-full: REF = $(SRC_PATH)/tests/ref/fate/mov-lazy-index
+# building the track indexes in parallel must give the same index as well
+FATE_MOV_LAZY_INDEX-$(call FRAMECRC, MOV, , ASYNC_PROTOCOL) += fate-mov-index-threads
+fate-mov-index-threads:   CMD = framecrc -ignore_editlist 1 -index_threads 2 -i async:$(TARGET_PATH)/tests/data/lavf/lavf.mov -c copy
+fate-mov-index-threads:   REF = $(SRC_PATH)/tests/ref/fate/mov-lazy-index
+$(FATE_MOV_LAZY_INDEX-yes): fate-lavf-mov
+fate-lavf-mov: KEEP_FILES ?= 1
+FATE_MOV_FFMPEG-yes += $(if $(filter fate-lavf-mov, $(FATE_LAVF_CONTAINER)), $(FATE_MOV_LAZY_INDEX-yes))
+
 FATE_FFMPEG += $(FATE_MOV_FFMPEG-yes)
 FATE_FFMPEG_FFPROBE += $(FATE_MOV_FFMPEG_FFPROBE-yes)
 
@@ -40,6 +40,8 @@ typedef struct PrivData {
     AVLFG        lfg;
 
     struct SwsContext *scaler;
+    /* bitexact, so that any output slice partitioning gives the same result */
+    struct SwsContext *scaler_exact;
 
     int v_shift_dst, h_shift_dst;
     int v_shift_src, h_shift_src;
@@ -48,6 +50,74 @@ typedef struct PrivData {
     AVFrame *frame_dst;
 } PrivData;
 
+static int compare_frames(DecodeContext *dc, const char *what)
+{
+    PrivData *pd = dc->opaque;
+
+    for (int i = 0; i < 4 && pd->frame_ref->data[i]; i++) {
+        int shift = (i == 1 || i == 2) ? pd->v_shift_dst : 0;
+
+        if (memcmp(pd->frame_ref->data[i], pd->frame_dst->data[i],
+                   pd->frame_ref->linesize[i] * (pd->frame_ref->height >> shift))) {
+            fprintf(stderr, "%s mismatch frame %"PRId64" seed %u\n", what,
+                    dc->decoder->frame_num - 1, pd->random_seed);
+            return AVERROR(EINVAL);
+        }
+    }
+
+    return 0;
+}
+
+/* make the input available in slices of random heights with
+ * sws_send_slice(), receiving every output slice as soon as possible */
+static int scale_incremental(DecodeContext *dc, AVFrame *frame)
+{
+    PrivData *pd = dc->opaque;
+    unsigned int align = sws_receive_slice_alignment(pd->scaler_exact);
+    int slice_start = 0, dst_done = 0;
+    int ret;
+
+    for (int i = 0; i < 4 && pd->frame_dst->data[i]; i++) {
+        int shift = (i == 1 || i == 2) ? pd->v_shift_dst : 0;
+        memset(pd->frame_dst->data[i], 0,
+               pd->frame_dst->linesize[i] * (pd->frame_dst->height >> shift));
+    }
+
+    ret = sws_frame_start(pd->scaler_exact, pd->frame_dst, frame);
+    if (ret < 0)
+        return ret;
+
+    while (dst_done < pd->frame_dst->height) {
+        if (slice_start < frame->height) {
+            int slice_height = av_lfg_get(&pd->lfg) % (frame->height - slice_start);
+            slice_height = FFMIN(FFALIGN(FFMAX(1, slice_height), 1 << pd->v_shift_src),
+                                 frame->height - slice_start);
+
+            ret = sws_send_slice(pd->scaler_exact, slice_start, slice_height);
+            if (ret < 0)
+                goto end;
+            slice_start += slice_height;
+        }
+
+        while (dst_done < pd->frame_dst->height) {
+            int h = FFALIGN(av_lfg_get(&pd->lfg) % 32 + 1, align);
+            h = FFMIN(h, pd->frame_dst->height - dst_done);
+
+            ret = sws_receive_slice(pd->scaler_exact, dst_done, h);
+            if (ret == AVERROR(EAGAIN) && slice_start < frame->height)
+                break;
+            if (ret < 0)
+                goto end;
+            dst_done += h;
+        }
+    }
+    ret = 0;
+
+end:
+    sws_frame_end(pd->scaler_exact);
+    return ret;
+}
+
 static int process_frame(DecodeContext *dc, AVFrame *frame)
 {
     PrivData *pd = dc->opaque;
@@ -64,6 +134,14 @@ static int process_frame(DecodeContext *dc, AVFrame *frame)
         if (!pd->scaler)
             return AVERROR(ENOMEM);
 
+        pd->scaler_exact = sws_getContext(frame->width, frame->height, frame->format,
+                                          pd->frame_ref->width, pd->frame_ref->height,
+                                          pd->frame_ref->format,
+                                          SWS_BICUBIC | SWS_ACCURATE_RND | SWS_BITEXACT,
+                                          NULL, NULL, NULL);
+        if (!pd->scaler_exact)
+            return AVERROR(ENOMEM);
+
         av_pix_fmt_get_chroma_sub_sample(frame->format, &pd->h_shift_src, &pd->v_shift_src);
     }
 
@@ -95,18 +173,19 @@ static int process_frame(DecodeContext *dc, AVFrame *frame)
     }
 
     /* compare the two results */
-    for (int i = 0; i < 4 && pd->frame_ref->data[i]; i++) {
-        int shift = (i == 1 || i == 2) ? pd->v_shift_dst : 0;
+    ret = compare_frames(dc, "sws_scale() slice");
+    if (ret < 0)
+        return ret;
 
-        if (memcmp(pd->frame_ref->data[i], pd->frame_dst->data[i],
-                   pd->frame_ref->linesize[i] * (pd->frame_ref->height >> shift))) {
-            fprintf(stderr, "mismatch frame %"PRId64" seed %u\n",
-                    dc->decoder->frame_num - 1, pd->random_seed);
-            return AVERROR(EINVAL);
-        }
-    }
+    ret = sws_scale_frame(pd->scaler_exact, pd->frame_ref, frame);
+    if (ret < 0)
+        return ret;
 
-    return 0;
+    ret = scale_incremental(dc, frame);
+    if (ret < 0)
+        return ret;
+
+    return compare_frames(dc, "sws_send_slice()");
 }
 
 int main(int argc, char **argv)
@@ -185,6 +264,7 @@ int main(int argc, char **argv)
     av_frame_free(&pd.frame_dst);
     av_frame_free(&pd.frame_ref);
     sws_freeContext(pd.scaler);
+    sws_freeContext(pd.scaler_exact);
     ds_free(&dc);
     return ret;
 }